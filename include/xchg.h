@@ -53,6 +53,7 @@ struct xchg_message
     char *data;  ///< @private
     size_t length;  ///< @private
     size_t position;  ///< @private
+    size_t streaming;  ///< @private
     char *error;  ///< @private
 };
 
@@ -770,6 +771,35 @@ bool xchg_message_write_float64(struct xchg_message *message, double_t value);
 ///
 bool xchg_message_write_float64_list(struct xchg_message *message, const double_t list[], uint64_t sz_list);
 
+/// Writes a byte order marker to <tt>message</tt> and advances the underlying buffer position.
+///
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> structure
+/// @return
+///   <tt>true</tt> if a byte order marker was written, otherwise <tt>false</tt>
+/// @note
+///   Values are always written in the native byte order of the producer. Writing a byte order marker before them
+///   allows a consumer on an architecture of the opposite endianness to decode them via
+///   <tt>xchg_message_read_byte_order</tt>, e.g. when messages are persisted and replayed elsewhere.
+/// @memberof xchg_message
+///
+bool xchg_message_write_byte_order(struct xchg_message *message);
+
+/// Reads a byte order marker from <tt>message</tt> and advances the underlying buffer position. If the marker
+/// indicates a foreign byte order, every subsequent value in <tt>message</tt> is first converted to native byte
+/// order in place.
+///
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> structure
+/// @return
+///   <tt>true</tt> if a byte order marker was read, otherwise <tt>false</tt>
+/// @note
+///   When the marker matches the native byte order, this function only skips over it. Otherwise the conversion
+///   rewrites the marker, so reading it again is also cheap.
+/// @memberof xchg_message
+///
+bool xchg_message_read_byte_order(struct xchg_message *message);
+
 /// Represents a lock-free SPSC ring.
 ///
 /// @note
@@ -785,7 +815,19 @@ struct xchg_ring
     char *data;  ///< @private
     size_t sz_data;  ///< @private
     size_t sz_message;  ///< @private
+    size_t sz_header;  ///< @private
     size_t mask;  ///< @private
+    size_t offset;  ///< @private
+    size_t prefetch;  ///< @private
+    size_t batch;  ///< @private
+    size_t nr_unpublished;  ///< @private
+    size_t streaming;  ///< @private
+    uint64_t sequence;  ///< @private
+    struct xchg_ring_shared *shared;  ///< @private
+    uint64_t generation;  ///< @private
+    uint64_t sample_start;  ///< @private
+    size_t sample_countdown;  ///< @private
+    bool held;  ///< @private
 };
 
 /// Represents a lock-free communication device backed by shared memory buffers which can be manipulated using the
@@ -798,9 +840,53 @@ struct xchg_channel
 {
     struct xchg_ring ingress;  ///< @private
     struct xchg_ring egress;  ///< @private
+    uint32_t flags;  ///< @private
+    volatile uint64_t *notify;  ///< @private
+    uint64_t notify_mask;  ///< @private
+    struct xchg_sampler *sampler;  ///< @private
+    size_t sample_period;  ///< @private
     char *error;  ///< @private
 };
 
+/// Represents the set of optional behaviors which can be enabled on an <tt>xchg_channel</tt> via
+/// <tt>xchg_channel_init_ex</tt>.
+///
+/// @note
+///   Flags which change the layout of ring slots must be configured identically by the producer and the consumer
+///   of each ring.
+///
+enum xchg_channel_flag
+{
+    xchg_channel_flag_checksum = 1u << 0u,  ///< Store a CRC32C of each message payload in its slot and verify it on receive
+    xchg_channel_flag_header = 1u << 1u,  ///< Store an <tt>xchg_header</tt> in front of each message payload
+    xchg_channel_flag_length = 1u << 2u,  ///< Store the written length of each message payload in its slot
+    xchg_channel_flag_liveness = 1u << 3u,  ///< Track the process id and heartbeat of each ring's producer and consumer
+    xchg_channel_flag_any_size = 1u << 4u,  ///< Allow message and ring sizes which are not powers of two
+    xchg_channel_flag_statistics = 1u << 5u,  ///< Maintain traffic counters in each ring header, see <tt>xchg_statistics</tt>
+};
+
+/// Size, in bytes, of the ring header at the start of each buffer provided to an <tt>xchg_channel</tt> configured
+/// with <tt>xchg_channel_flag_liveness</tt>, which replaces the 2*sizeof(void *) bytes of ring accounting overhead.
+///
+#define XCHG_RING_HEADER_SIZE 256u
+
+/// Version of the ring header layout written by <tt>xchg_channel_create</tt> and required by
+/// <tt>xchg_channel_attach</tt>.
+///
+#define XCHG_RING_VERSION 1u
+
+/// Represents the per-message header which precedes each message payload in the slots of an <tt>xchg_channel</tt>
+/// configured with <tt>xchg_channel_flag_header</tt>.
+///
+struct xchg_header
+{
+    uint32_t length;  ///< Number of payload bytes written by the producer
+    uint32_t checksum;  ///< CRC32C of the payload, if the channel was configured with <tt>xchg_channel_flag_checksum</tt>
+    uint32_t type;  ///< User-defined message type provided to <tt>xchg_channel_send_typed</tt>
+    uint32_t reserved;  ///< @private
+    uint64_t sequence;  ///< Position of the message in the stream of messages sent into the ring, starting from zero
+};
+
 /// Configures <tt>channel</tt> to use <tt>ingress</tt> of size <tt>sz_ingress</tt> and <tt>egress</tt>
 /// of size <tt>sz_egress</tt> as underlying shared memory for receiving and sending messages
 /// of size <tt>sz_message</tt>.
@@ -835,6 +921,107 @@ struct xchg_channel
 bool xchg_channel_init(struct xchg_channel *channel,
                        size_t sz_message, char *ingress, size_t sz_ingress, char *egress, size_t sz_egress);
 
+/// Configures <tt>channel</tt> exactly like <tt>xchg_channel_init</tt>, additionally enabling the optional behaviors
+/// described by <tt>flags</tt>.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] flags
+///   bitwise-or of <tt>xchg_channel_flag</tt> values
+/// @param [in] sz_message
+///   maximum size, in bytes, of messages that are consumed or produced by this channel
+/// @param [in] ingress
+///   pointer to the shared memory buffer containing messages to be consumed by this channel
+/// @param [in] sz_ingress
+///   size, in bytes, of the <tt>ingress</tt> memory buffer
+/// @param [in] egress
+///   pointer to the shared memory buffer into which messages can be produced by this channel
+/// @param [in] sz_egress
+///   size, in bytes, of the <tt>egress</tt> memory buffer
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_channel</tt> was initialized, or <tt>false</tt> if invalid arguments
+///   were provided
+/// @note
+///   When <tt>xchg_channel_flag_checksum</tt> or <tt>xchg_channel_flag_length</tt> is set, the first 8 bytes of
+///   every <tt>sz_message</tt> slot are reserved for the written length and CRC32C of the message, so messages
+///   provided by <tt>xchg_channel_prepare</tt> and <tt>xchg_channel_receive</tt> are 8 bytes shorter than
+///   <tt>sz_message</tt>.
+/// @note
+///   When <tt>xchg_channel_flag_header</tt> is set, the first <tt>sizeof(struct xchg_header)</tt> bytes of every
+///   slot are reserved for an <tt>xchg_header</tt> instead.
+/// @note
+///   When <tt>xchg_channel_flag_liveness</tt> is set, the <tt>sz_ingress</tt> and <tt>sz_egress</tt> parameters
+///   must be a power-of-two plus <tt>XCHG_RING_HEADER_SIZE</tt> bytes, and this channel registers itself as the
+///   consumer of <tt>ingress</tt> and the producer of <tt>egress</tt>, as if by <tt>xchg_channel_heartbeat</tt>.
+///   Re-initializing a channel over the same buffers resumes each ring from its current position. If a buffer was
+///   set up by <tt>xchg_channel_create</tt>, its ring header must agree with the provided flags and sizes.
+/// @note
+///   When <tt>xchg_channel_flag_any_size</tt> is set, <tt>sz_message</tt> may be any size, and the ring sizes only
+///   need to be a multiple of <tt>sz_message</tt> plus the ring accounting overhead. Slots are then located by
+///   advancing and wrapping an offset rather than by masking, which costs a compare per message.
+/// @note
+///   When <tt>xchg_channel_flag_statistics</tt> is set, <tt>xchg_channel_flag_liveness</tt> must also be set. Each
+///   end of a ring then counts its traffic in the ring header cache line which it already owns, so the counters
+///   add no cache line transfers between producer and consumer.
+/// @memberof xchg_channel
+///
+bool xchg_channel_init_ex(struct xchg_channel *channel, uint32_t flags,
+                          size_t sz_message, char *ingress, size_t sz_ingress, char *egress, size_t sz_egress);
+
+/// Configures <tt>channel</tt> exactly like <tt>xchg_channel_init_ex</tt>, after resetting <tt>ingress</tt> and
+/// <tt>egress</tt> to empty rings whose headers describe their own format version and geometry, so that a peer can
+/// open the channel from the shared memory alone via <tt>xchg_channel_attach</tt>.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] flags
+///   bitwise-or of <tt>xchg_channel_flag</tt> values, to which <tt>xchg_channel_flag_liveness</tt> is always added
+/// @param [in] sz_message
+///   maximum size, in bytes, of messages that are consumed or produced by this channel
+/// @param [in] ingress
+///   pointer to the shared memory buffer containing messages to be consumed by this channel
+/// @param [in] sz_ingress
+///   size, in bytes, of the <tt>ingress</tt> memory buffer, which must be a power-of-two plus
+///   <tt>XCHG_RING_HEADER_SIZE</tt> bytes
+/// @param [in] egress
+///   pointer to the shared memory buffer into which messages can be produced by this channel
+/// @param [in] sz_egress
+///   size, in bytes, of the <tt>egress</tt> memory buffer, which must be a power-of-two plus
+///   <tt>XCHG_RING_HEADER_SIZE</tt> bytes
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_channel</tt> was initialized, or <tt>false</tt> if invalid arguments
+///   were provided
+/// @note
+///   Any messages already in the buffers are discarded, so peers must not be attached while this is called.
+/// @memberof xchg_channel
+///
+bool xchg_channel_create(struct xchg_channel *channel, uint32_t flags,
+                         size_t sz_message, char *ingress, size_t sz_ingress, char *egress, size_t sz_egress);
+
+/// Configures <tt>channel</tt> to use <tt>ingress</tt> and <tt>egress</tt>, which were previously set up by
+/// <tt>xchg_channel_create</tt>, taking the channel flags and message size from their ring headers.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] ingress
+///   pointer to the shared memory buffer containing messages to be consumed by this channel
+/// @param [in] sz_ingress
+///   size, in bytes, of the <tt>ingress</tt> memory buffer
+/// @param [in] egress
+///   pointer to the shared memory buffer into which messages can be produced by this channel
+/// @param [in] sz_egress
+///   size, in bytes, of the <tt>egress</tt> memory buffer
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_channel</tt> was initialized, or <tt>false</tt> if a buffer has no
+///   valid ring header, was created with a different format version, does not match its provided size, or
+///   disagrees with the other buffer about the channel flags or message size
+/// @note
+///   A buffer whose ring header is not yet complete is reported as missing, so attaching may be retried while
+///   the creator is still starting up.
+/// @memberof xchg_channel
+///
+bool xchg_channel_attach(struct xchg_channel *channel, char *ingress, size_t sz_ingress, char *egress, size_t sz_egress);
+
 /// Prepares <tt>message</tt> with writable backing memory from <tt>channel</tt>, allowing the caller to construct
 /// a message payload and then send it into the channel via <tt>xchg_channel_send</tt>.
 ///
@@ -860,6 +1047,24 @@ bool xchg_channel_prepare(struct xchg_channel *channel, struct xchg_message *mes
 ///
 bool xchg_channel_send(struct xchg_channel *channel, const struct xchg_message *message);
 
+/// Sends <tt>message</tt> (previously initialized via <tt>xchg_channel_prepare</tt>) into <tt>channel</tt>, tagging
+/// it with the user-defined message <tt>type</tt>.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_channel_prepare</tt>
+/// @param [in] type
+///   user-defined message type which the consumer can retrieve via <tt>xchg_channel_header</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was sent, otherwise <tt>false</tt>
+/// @note
+///   The <tt>type</tt> is only recorded if <tt>channel</tt> was configured with <tt>xchg_channel_flag_header</tt>.
+///   <tt>xchg_channel_send</tt> is equivalent to calling this function with a <tt>type</tt> of zero.
+/// @memberof xchg_channel
+///
+bool xchg_channel_send_typed(struct xchg_channel *channel, const struct xchg_message *message, uint32_t type);
+
 /// Receives the next available message from <tt>channel</tt> into <tt>message</tt>, allowing the caller to
 /// read the message payload and then return it to the channel via <tt>xchg_channel_return</tt>.
 ///
@@ -869,10 +1074,33 @@ bool xchg_channel_send(struct xchg_channel *channel, const struct xchg_message *
 ///   pointer to an <tt>xchg_message</tt> to be initialized
 /// @return
 ///   <tt>true</tt> if a message was received into the provided <tt>xchg_message</tt>, otherwise <tt>false</tt>
+/// @note
+///   If <tt>channel</tt> was configured with <tt>xchg_channel_flag_checksum</tt> and the next message fails
+///   verification, then <tt>message</tt> is still initialized but <tt>false</tt> is returned. The caller may inspect
+///   the corrupt message and must discard it via <tt>xchg_channel_return</tt> before receiving the next one.
+/// @note
+///   If <tt>channel</tt> was configured with <tt>xchg_channel_flag_length</tt>, <tt>xchg_channel_flag_checksum</tt>
+///   or <tt>xchg_channel_flag_header</tt>, then the length of <tt>message</tt> is limited to the number of bytes
+///   that were written by the producer, so leftover bytes from earlier messages in the same slot are never read.
 /// @memberof xchg_channel
 ///
 bool xchg_channel_receive(struct xchg_channel *channel, struct xchg_message *message);
 
+/// Provides the header of <tt>message</tt> (previously initialized via <tt>xchg_channel_receive</tt>), allowing the
+/// caller to dispatch on its type and detect gaps in its sequence without decoding its payload.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure configured with <tt>xchg_channel_flag_header</tt>
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_channel_receive</tt>
+/// @param [out] header
+///   pointer to storage for an <tt>xchg_header</tt>
+/// @return
+///   <tt>true</tt> if the header argument was filled, otherwise <tt>false</tt>
+/// @memberof xchg_channel
+///
+bool xchg_channel_header(struct xchg_channel *channel, const struct xchg_message *message, struct xchg_header *header);
+
 /// Returns the backing memory of <tt>message</tt> (previously initialized via <tt>xchg_channel_receive</tt>)
 /// to <tt>channel</tt>.
 ///
@@ -886,6 +1114,112 @@ bool xchg_channel_receive(struct xchg_channel *channel, struct xchg_message *mes
 ///
 bool xchg_channel_return(struct xchg_channel *channel, const struct xchg_message *message);
 
+/// Records the calling process and the current time as the consumer of <tt>channel</tt>'s ingress and the producer
+/// of its egress, so that the peer on the other end of each ring can tell that this end is still alive.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure configured with <tt>xchg_channel_flag_liveness</tt>
+/// @return
+///   <tt>true</tt> if the heartbeat was recorded, otherwise <tt>false</tt>
+/// @memberof xchg_channel
+///
+bool xchg_channel_heartbeat(struct xchg_channel *channel);
+
+/// Checks whether the peers on the other end of <tt>channel</tt>'s rings are alive, meaning that they have
+/// attached, that their processes still exist, and that they have recorded a heartbeat within
+/// <tt>timeout_ns</tt> nanoseconds.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure configured with <tt>xchg_channel_flag_liveness</tt>
+/// @param [in] timeout_ns
+///   maximum age, in nanoseconds, of a peer's last heartbeat, or zero to only check that the peer process exists
+/// @return
+///   <tt>true</tt> if every peer is alive, otherwise <tt>false</tt>, in which case
+///   <tt>xchg_channel_strerror</tt> describes which check failed
+/// @note
+///   Heartbeats use <tt>CLOCK_MONOTONIC</tt>, so both ends must run on the same host.
+/// @memberof xchg_channel
+///
+bool xchg_channel_peer_alive(struct xchg_channel *channel, uint64_t timeout_ns);
+
+/// Detaches a dead peer from <tt>channel</tt>'s rings by advancing their generation, so that a replacement peer
+/// can attach via <tt>xchg_channel_init_ex</tt> and resume where the dead peer stopped.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure configured with <tt>xchg_channel_flag_liveness</tt>
+/// @param [in] discard
+///   if <tt>true</tt>, messages which were sent but not yet received are dropped from both rings, otherwise they
+///   are kept for the replacement peer
+/// @return
+///   <tt>true</tt> if the channel was recovered, otherwise <tt>false</tt>
+/// @note
+///   This must only be called after <tt>xchg_channel_peer_alive</tt> has reported a dead peer. It fails without
+///   changing anything if a peer process still exists, including one whose heartbeat has merely expired, or if a
+///   replacement peer has attached to either ring since that check.
+/// @note
+///   Messages are only ever published once fully written, so a peer which died mid-message never leaves a
+///   partial message in the ring.
+/// @memberof xchg_channel
+///
+bool xchg_channel_recover(struct xchg_channel *channel, bool discard);
+
+/// Configures how far ahead <tt>channel</tt> prefetches ring slots. On each <tt>xchg_channel_receive</tt> the slot
+/// <tt>distance</tt> messages ahead is prefetched for reading if it has already been published, and on each
+/// <tt>xchg_channel_prepare</tt> the slot <tt>distance</tt> messages ahead is prefetched for writing if it is free.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] distance
+///   number of messages to prefetch ahead, or zero to disable prefetching
+/// @return
+///   <tt>true</tt> if the prefetch distance was configured, or <tt>false</tt> if it is not smaller than the number
+///   of slots in each ring
+/// @note
+///   Prefetching is disabled by default. Whether it helps depends on where the producer and consumer run, which
+///   the <tt>stream</tt> benchmark of <tt>xchg_bench</tt> measures for each CPU placement.
+/// @memberof xchg_channel
+///
+bool xchg_channel_set_prefetch(struct xchg_channel *channel, size_t distance);
+
+/// Configures <tt>channel</tt> to publish its read position to the producer of its ingress at most once per
+/// <tt>batch</tt> calls to <tt>xchg_channel_return</tt>, so that the producer's cached copy of it, and the cache line
+/// which holds it, are refreshed less often.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] batch
+///   number of returned messages per publication, where 1 publishes every return
+/// @return
+///   <tt>true</tt> if the refresh batch was configured, or <tt>false</tt> if it is zero or larger than the number of
+///   slots in the ingress ring
+/// @note
+///   The read position is always published when this channel has returned every message it has seen, so a
+///   consumer which keeps receiving never leaves the producer waiting on it. Returned slots are only reused by the
+///   producer once published, so a consumer which stops mid-batch holds up to <tt>batch - 1</tt> slots.
+/// @note
+///   Channels publish every return by default. The <tt>stream</tt> benchmark of <tt>xchg_bench</tt> compares batch
+///   sizes for each CPU placement.
+/// @memberof xchg_channel
+///
+bool xchg_channel_set_refresh_batch(struct xchg_channel *channel, size_t batch);
+
+/// Configures <tt>channel</tt> to write values of at least <tt>threshold</tt> bytes into messages provided by
+/// <tt>xchg_channel_prepare</tt> using non-temporal stores, which bypass the producer's cache so that the consumer
+/// reads them from memory instead of snooping them out of the producer's cache one line at a time.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure with an egress buffer
+/// @param [in] threshold
+///   minimum size, in bytes, of a value written with non-temporal stores, or zero to always use ordinary stores
+/// @return
+///   <tt>true</tt> if the threshold was configured, otherwise <tt>false</tt>
+/// @note
+///   Non-temporal stores are only used on x86-64. Elsewhere this setting has no effect. Small values are best left
+///   to ordinary stores, since the consumer then finds them in the shared last-level cache.
+/// @memberof xchg_channel
+///
+bool xchg_channel_set_streaming(struct xchg_channel *channel, size_t threshold);
+
 /// Provides a static string describing the error that occurred during the last operation on <tt>channel</tt>
 ///
 /// @param [in] channel
@@ -896,6 +1230,1478 @@ bool xchg_channel_return(struct xchg_channel *channel, const struct xchg_message
 ///
 const char *xchg_channel_strerror(const struct xchg_channel *channel);
 
+/// Represents a point-in-time view of a ring header, as read by <tt>xchg_statistics_read</tt> from the shared memory
+/// buffer of a channel set up by <tt>xchg_channel_create</tt>.
+///
+/// @note
+///   Each field is read atomically, but the fields are not read together, so counters maintained by the producer
+///   and the consumer may be a few messages apart.
+///
+struct xchg_statistics
+{
+    uint32_t flags;  ///< Bitwise-or of the <tt>xchg_channel_flag</tt> values the ring was created with
+    size_t sz_message;  ///< Size, in bytes, of each ring slot
+    size_t sz_data;  ///< Size, in bytes, of the ring excluding its header
+    uint64_t read_sequence;  ///< Number of messages returned by the consumer and published to the producer
+    uint64_t write_sequence;  ///< Number of messages sent by the producer
+    uint64_t nr_pending;  ///< Number of messages sent but not yet returned
+    uint64_t producer_pid;  ///< Process id of the producer, or zero if none has attached
+    uint64_t producer_heartbeat;  ///< <tt>CLOCK_MONOTONIC</tt> time, in nanoseconds, of the producer's last heartbeat
+    uint64_t consumer_pid;  ///< Process id of the consumer, or zero if none has attached
+    uint64_t consumer_heartbeat;  ///< <tt>CLOCK_MONOTONIC</tt> time, in nanoseconds, of the consumer's last heartbeat
+    uint64_t nr_sent;  ///< Number of messages sent, if <tt>xchg_channel_flag_statistics</tt> is set
+    uint64_t sz_sent;  ///< Number of payload bytes written into sent messages, if <tt>xchg_channel_flag_statistics</tt> is set
+    uint64_t nr_full;  ///< Number of times <tt>xchg_channel_prepare</tt> found the ring full, if <tt>xchg_channel_flag_statistics</tt> is set
+    uint64_t nr_high_water;  ///< Largest number of pending messages seen by the producer, if <tt>xchg_channel_flag_statistics</tt> is set
+    uint64_t nr_received;  ///< Number of messages returned, if <tt>xchg_channel_flag_statistics</tt> is set
+    uint64_t sz_received;  ///< Number of payload bytes in returned messages, if <tt>xchg_channel_flag_statistics</tt> is set
+    uint64_t nr_empty;  ///< Number of times <tt>xchg_channel_receive</tt> found the ring empty, if <tt>xchg_channel_flag_statistics</tt> is set
+    char *error;  ///< @private
+};
+
+/// Reads the header of <tt>ring</tt>, a shared memory buffer of size <tt>sz_ring</tt> set up by
+/// <tt>xchg_channel_create</tt>, into <tt>statistics</tt> without modifying it, so that a monitor can observe a live
+/// channel through a read-only mapping.
+///
+/// @param [in] statistics
+///   pointer to an <tt>xchg_statistics</tt> structure to be filled
+/// @param [in] ring
+///   pointer to the shared memory buffer of one ring, either the ingress or the egress of a channel
+/// @param [in] sz_ring
+///   size, in bytes, of the <tt>ring</tt> memory buffer
+/// @return
+///   <tt>true</tt> if the ring header was read, or <tt>false</tt> if the buffer has no valid ring header
+/// @note
+///   <tt>nr_high_water</tt> is measured by the producer against the consumer's published read position, so it may
+///   overstate the true occupancy by the messages a consumer has returned but not yet published, see
+///   <tt>xchg_channel_set_refresh_batch</tt>.
+///   <tt>sz_received</tt> counts whole slot payloads unless the ring stores message lengths.
+/// @memberof xchg_statistics
+///
+bool xchg_statistics_read(struct xchg_statistics *statistics, const char *ring, size_t sz_ring);
+
+/// Copies the payload of the pending message numbered <tt>sequence</tt> out of <tt>ring</tt> into <tt>buffer</tt>,
+/// without modifying the ring, so that a monitor can decode messages the consumer has not yet returned.
+///
+/// @param [in] statistics
+///   pointer to an <tt>xchg_statistics</tt> structure which was previously filled by <tt>xchg_statistics_read</tt>
+///   from <tt>ring</tt>
+/// @param [in] ring
+///   pointer to the shared memory buffer of the ring
+/// @param [in] sequence
+///   sequence number of the message, from <tt>read_sequence</tt> up to but excluding <tt>write_sequence</tt>
+/// @param [out] buffer
+///   pointer to a memory buffer which receives the message payload
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt> memory buffer, which must hold a whole slot payload
+/// @param [out] length
+///   pointer to storage for the number of payload bytes copied, which is the written length of the message if the
+///   ring stores message lengths, otherwise the whole slot payload
+/// @return
+///   <tt>true</tt> if the message was copied, or <tt>false</tt> if it was not pending before or after the copy, in
+///   which case the copy may be torn and must not be decoded
+/// @note
+///   The copy can then be decoded via <tt>xchg_message_init</tt> and <tt>xchg_message_peek</tt>.
+/// @memberof xchg_statistics
+///
+bool xchg_statistics_peek(struct xchg_statistics *statistics, const char *ring, uint64_t sequence,
+                          char *buffer, size_t sz_buffer, size_t *length);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>statistics</tt>
+///
+/// @param [in] statistics
+///   pointer to an <tt>xchg_statistics</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>statistics</tt>
+/// @memberof xchg_statistics
+///
+const char *xchg_statistics_strerror(const struct xchg_statistics *statistics);
+
+/// Represents the interval measured by an <tt>xchg_sample</tt>.
+///
+enum xchg_sample_kind
+{
+    xchg_sample_prepare_send,  ///< From the end of <tt>xchg_channel_prepare</tt> to the end of <tt>xchg_channel_send</tt>
+    xchg_sample_receive_return,  ///< From the end of <tt>xchg_channel_receive</tt> to the end of <tt>xchg_channel_return</tt>
+};
+
+/// Represents one sampled interval, recorded by a channel into its <tt>xchg_sampler</tt>.
+///
+struct xchg_sample
+{
+    uint64_t ticks;  ///< Length of the interval, in ticks of the cpu timestamp counter
+    uint32_t kind;  ///< <tt>xchg_sample_kind</tt> of the interval
+    uint32_t reserved;  ///< @private
+};
+
+/// Represents a lock-free log of sampled intervals, written by the one thread which operates the channels attached
+/// to it via <tt>xchg_channel_set_sampler</tt>, and drained by any one other thread via <tt>xchg_sampler_drain</tt>.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_sampler
+{
+    struct xchg_sample *samples;  ///< @private
+    size_t mask;  ///< @private
+    size_t w;  ///< @private
+    size_t r;  ///< @private
+    uint64_t nr_dropped;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Number of buckets in an <tt>xchg_histogram</tt>, which records values to within about 3%.
+///
+#define XCHG_HISTOGRAM_BUCKETS 1920u
+
+/// Represents a log-linear histogram of sampled intervals, into which an <tt>xchg_sampler</tt> is drained.
+///
+/// @note
+///   A zero-initialized histogram is empty.
+///
+struct xchg_histogram
+{
+    uint64_t counts[XCHG_HISTOGRAM_BUCKETS];  ///< @private
+    uint64_t count;  ///< Number of recorded values
+    uint64_t max;  ///< Largest recorded value
+};
+
+/// Configures <tt>sampler</tt> to log intervals into <tt>samples</tt>, an array of <tt>nr_samples</tt> entries.
+///
+/// @param [in] sampler
+///   pointer to an <tt>xchg_sampler</tt> structure
+/// @param [in] samples
+///   pointer to an array of <tt>xchg_sample</tt> structures
+/// @param [in] nr_samples
+///   number of entries in <tt>samples</tt>, which must be a power-of-two
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_sampler</tt> was initialized, or <tt>false</tt> if invalid arguments were
+///   provided
+/// @note
+///   Samples recorded while the log is full are dropped and counted, see <tt>xchg_sampler_dropped</tt>.
+/// @memberof xchg_sampler
+///
+bool xchg_sampler_init(struct xchg_sampler *sampler, struct xchg_sample *samples, size_t nr_samples);
+
+/// Configures <tt>channel</tt> to sample one in every <tt>period</tt> messages it prepares and receives, recording
+/// how long each sampled message was held before being sent or returned into <tt>sampler</tt>.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure
+/// @param [in] sampler
+///   pointer to an <tt>xchg_sampler</tt> structure, or <tt>NULL</tt> to stop sampling
+/// @param [in] period
+///   number of messages per sample in each direction, where 1 samples every message
+/// @return
+///   <tt>true</tt> if sampling was configured, otherwise <tt>false</tt>
+/// @note
+///   Unsampled messages only pay for a countdown, and sampled ones for two reads of the cpu timestamp counter, so
+///   periods of a thousand or more keep the overhead well under 1%.
+/// @note
+///   Several channels may share a sampler as long as they are all operated by the same thread.
+/// @memberof xchg_channel
+///
+bool xchg_channel_set_sampler(struct xchg_channel *channel, struct xchg_sampler *sampler, size_t period);
+
+/// Drains every sample logged in <tt>sampler</tt> into the histogram for its kind.
+///
+/// @param [in] sampler
+///   pointer to an <tt>xchg_sampler</tt> structure
+/// @param [in] prepare_send
+///   optional pointer to an <tt>xchg_histogram</tt> which receives <tt>xchg_sample_prepare_send</tt> samples
+/// @param [in] receive_return
+///   optional pointer to an <tt>xchg_histogram</tt> which receives <tt>xchg_sample_receive_return</tt> samples
+/// @param [out] nr_drained
+///   optional pointer to storage for the number of samples drained
+/// @return
+///   <tt>true</tt> if the sampler was drained, otherwise <tt>false</tt>
+/// @memberof xchg_sampler
+///
+bool xchg_sampler_drain(struct xchg_sampler *sampler,
+                        struct xchg_histogram *prepare_send, struct xchg_histogram *receive_return, size_t *nr_drained);
+
+/// @param [in] sampler
+///   pointer to an <tt>xchg_sampler</tt> structure
+/// @return
+///   number of samples dropped so far because the log was full
+/// @memberof xchg_sampler
+///
+uint64_t xchg_sampler_dropped(const struct xchg_sampler *sampler);
+
+/// Measures how many ticks of the cpu timestamp counter used by <tt>xchg_sample</tt> elapse per nanosecond, by
+/// comparing it against <tt>CLOCK_MONOTONIC</tt> over about ten milliseconds.
+///
+/// @param [out] ticks_per_ns
+///   pointer to storage for the tick rate
+/// @return
+///   <tt>true</tt> if the tick rate was measured, otherwise <tt>false</tt>
+/// @note
+///   Where no usable timestamp counter exists, ticks are nanoseconds and the rate is 1.
+/// @memberof xchg_sampler
+///
+bool xchg_sampler_calibrate(double *ticks_per_ns);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>sampler</tt>
+///
+/// @param [in] sampler
+///   pointer to an <tt>xchg_sampler</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>sampler</tt>
+/// @memberof xchg_sampler
+///
+const char *xchg_sampler_strerror(const struct xchg_sampler *sampler);
+
+/// Provides the smallest value which at least <tt>percentile</tt> percent of the values in <tt>histogram</tt> are
+/// less than or equal to.
+///
+/// @param [in] histogram
+///   pointer to an <tt>xchg_histogram</tt> structure
+/// @param [in] percentile
+///   percentile to look up, from 0 to 100
+/// @param [out] value
+///   pointer to storage for the value, which is rounded up to the end of its bucket but never exceeds the largest
+///   recorded value
+/// @return
+///   <tt>true</tt> if the value was provided, or <tt>false</tt> if the histogram is empty or the percentile is out
+///   of range
+/// @memberof xchg_histogram
+///
+bool xchg_histogram_percentile(const struct xchg_histogram *histogram, double percentile, uint64_t *value);
+
+/// Adds every value recorded in <tt>source</tt> to <tt>histogram</tt>, so that the samples of several threads can
+/// be aggregated.
+///
+/// @param [in] histogram
+///   pointer to an <tt>xchg_histogram</tt> structure
+/// @param [in] source
+///   pointer to an <tt>xchg_histogram</tt> structure
+/// @return
+///   <tt>true</tt> if the histograms were merged, otherwise <tt>false</tt>
+/// @memberof xchg_histogram
+///
+bool xchg_histogram_merge(struct xchg_histogram *histogram, const struct xchg_histogram *source);
+
+/// Maximum number of priority lanes in an <tt>xchg_lanes</tt> channel.
+///
+#define XCHG_LANES_MAX 4
+
+/// Represents a lane of an <tt>xchg_lanes</tt> channel, padded to its own cache lines.
+///
+/// @private
+///
+struct __attribute__((aligned(64))) xchg_lane
+{
+    struct xchg_channel channel;  ///< @private
+};
+
+/// Represents a lock-free communication device with up to <tt>XCHG_LANES_MAX</tt> priority lanes, each backed by
+/// its own pair of shared memory buffers, which can be manipulated using the <tt>xchg_lanes_*</tt> family of
+/// functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_lanes
+{
+    struct xchg_lane lanes[XCHG_LANES_MAX];  ///< @private
+    size_t nr_lanes;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>lanes</tt> to use <tt>nr_lanes</tt> pairs of <tt>ingress</tt> and <tt>egress</tt> shared memory
+/// buffers for receiving and sending messages of size <tt>sz_message</tt>, with lane zero having the highest
+/// priority.
+///
+/// @param [in] lanes
+///   pointer to an <tt>xchg_lanes</tt> structure
+/// @param [in] flags
+///   bitwise-or of <tt>xchg_channel_flag</tt> values, applied to every lane
+/// @param [in] nr_lanes
+///   number of lanes, at most <tt>XCHG_LANES_MAX</tt>
+/// @param [in] sz_message
+///   maximum size, in bytes, of messages that are consumed or produced by every lane
+/// @param [in] ingress
+///   optional array of <tt>nr_lanes</tt> pointers to shared memory buffers containing messages to be consumed
+/// @param [in] sz_ingress
+///   optional array of <tt>nr_lanes</tt> sizes, in bytes, of the <tt>ingress</tt> memory buffers
+/// @param [in] egress
+///   optional array of <tt>nr_lanes</tt> pointers to shared memory buffers into which messages can be produced
+/// @param [in] sz_egress
+///   optional array of <tt>nr_lanes</tt> sizes, in bytes, of the <tt>egress</tt> memory buffers
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_lanes</tt> was initialized, or <tt>false</tt> if invalid arguments
+///   were provided
+/// @note
+///   Each lane is an independent ring with the same constraints as described for <tt>xchg_channel_init</tt>, so
+///   a small ring can be used for urgent messages alongside a large ring for bulk messages.
+/// @memberof xchg_lanes
+///
+bool xchg_lanes_init(struct xchg_lanes *lanes, uint32_t flags, size_t nr_lanes, size_t sz_message,
+                     char *ingress[], size_t sz_ingress[], char *egress[], size_t sz_egress[]);
+
+/// Prepares <tt>message</tt> with writable backing memory from lane <tt>priority</tt> of <tt>lanes</tt>, allowing
+/// the caller to construct a message payload and then send it via <tt>xchg_lanes_send</tt>.
+///
+/// @param [in] lanes
+///   pointer to an <tt>xchg_lanes</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [in] priority
+///   lane to send the message on, where zero is the highest priority
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was prepared, otherwise <tt>false</tt>
+/// @memberof xchg_lanes
+///
+bool xchg_lanes_prepare(struct xchg_lanes *lanes, struct xchg_message *message, size_t priority);
+
+/// Sends <tt>message</tt> (previously initialized via <tt>xchg_lanes_prepare</tt>) on its lane of <tt>lanes</tt>.
+///
+/// @param [in] lanes
+///   pointer to an <tt>xchg_lanes</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_lanes_prepare</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was sent, otherwise <tt>false</tt>
+/// @memberof xchg_lanes
+///
+bool xchg_lanes_send(struct xchg_lanes *lanes, const struct xchg_message *message);
+
+/// Receives the next available message from the highest-priority non-empty lane of <tt>lanes</tt> into
+/// <tt>message</tt>, allowing the caller to read the message payload and then return it via
+/// <tt>xchg_lanes_return</tt>.
+///
+/// @param [in] lanes
+///   pointer to an <tt>xchg_lanes</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [out] priority
+///   optional pointer to storage for the lane from which <tt>message</tt> was received
+/// @return
+///   <tt>true</tt> if a message was received into the provided <tt>xchg_message</tt>, otherwise <tt>false</tt>
+/// @memberof xchg_lanes
+///
+bool xchg_lanes_receive(struct xchg_lanes *lanes, struct xchg_message *message, size_t *priority);
+
+/// Returns the backing memory of <tt>message</tt> (previously initialized via <tt>xchg_lanes_receive</tt>) to its
+/// lane of <tt>lanes</tt>.
+///
+/// @param [in] lanes
+///   pointer to an <tt>xchg_lanes</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_lanes_receive</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was returned, otherwise <tt>false</tt>
+/// @memberof xchg_lanes
+///
+bool xchg_lanes_return(struct xchg_lanes *lanes, const struct xchg_message *message);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>lanes</tt>
+///
+/// @param [in] lanes
+///   pointer to an <tt>xchg_lanes</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>lanes</tt>
+/// @memberof xchg_lanes
+///
+const char *xchg_lanes_strerror(const struct xchg_lanes *lanes);
+
+/// Represents a lock-free, last-value-cache communication device backed by a shared memory buffer, which keeps only
+/// the most recently sent message for each key and can be manipulated using the <tt>xchg_conflator_*</tt> family of
+/// functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_conflator
+{
+    volatile uint64_t *r;  ///< @private
+    uint64_t cr;  ///< @private
+    volatile uint64_t *w;  ///< @private
+    uint64_t cw;  ///< @private
+    volatile uint32_t *keys;  ///< @private
+    size_t mask;  ///< @private
+    char *slots;  ///< @private
+    size_t sz_slot;  ///< @private
+    size_t nr_keys;  ///< @private
+    size_t sz_message;  ///< @private
+    size_t key;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Provides the size, in bytes, of the shared memory buffer required by an <tt>xchg_conflator</tt> with
+/// <tt>nr_keys</tt> keys and messages of size <tt>sz_message</tt>.
+///
+/// @param [in] nr_keys
+///   number of distinct keys
+/// @param [in] sz_message
+///   maximum size, in bytes, of messages
+/// @return
+///   size, in bytes, of the required shared memory buffer, or zero if invalid arguments were provided
+/// @memberof xchg_conflator
+///
+size_t xchg_conflator_size(size_t nr_keys, size_t sz_message);
+
+/// Configures <tt>conflator</tt> to use <tt>buffer</tt> of size <tt>sz_buffer</tt> as underlying shared memory for
+/// conflating messages of size <tt>sz_message</tt> by <tt>nr_keys</tt> distinct keys.
+///
+/// @param [in] conflator
+///   pointer to an <tt>xchg_conflator</tt> structure
+/// @param [in] nr_keys
+///   number of distinct keys, which are numbered from zero
+/// @param [in] sz_message
+///   maximum size, in bytes, of messages that are consumed or produced by this conflator
+/// @param [in] buffer
+///   pointer to the shared memory buffer, which must be zero-filled before first use and 64-byte aligned
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt>, which must be at least <tt>xchg_conflator_size(nr_keys, sz_message)</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_conflator</tt> was initialized, or <tt>false</tt> if invalid arguments
+///   were provided
+/// @memberof xchg_conflator
+///
+bool xchg_conflator_init(struct xchg_conflator *conflator, size_t nr_keys, size_t sz_message,
+                         char *buffer, size_t sz_buffer);
+
+/// Prepares <tt>message</tt> with writable backing memory for <tt>key</tt> from <tt>conflator</tt>, allowing the
+/// caller to construct a message payload which replaces any pending message for the same key once it is sent via
+/// <tt>xchg_conflator_send</tt>.
+///
+/// @param [in] conflator
+///   pointer to an <tt>xchg_conflator</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [in] key
+///   key of the message
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was prepared, otherwise <tt>false</tt>
+/// @note
+///   The message is written in place under a sequence lock, so the producer must not block between
+///   <tt>xchg_conflator_prepare</tt> and <tt>xchg_conflator_send</tt>.
+/// @memberof xchg_conflator
+///
+bool xchg_conflator_prepare(struct xchg_conflator *conflator, struct xchg_message *message, size_t key);
+
+/// Sends <tt>message</tt> (previously initialized via <tt>xchg_conflator_prepare</tt>) into <tt>conflator</tt>.
+///
+/// @param [in] conflator
+///   pointer to an <tt>xchg_conflator</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_conflator_prepare</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was sent, otherwise <tt>false</tt>
+/// @memberof xchg_conflator
+///
+bool xchg_conflator_send(struct xchg_conflator *conflator, const struct xchg_message *message);
+
+/// Receives the latest message for the next updated key of <tt>conflator</tt> by copying it into <tt>buffer</tt>
+/// and initializing <tt>message</tt> with it.
+///
+/// @param [in] conflator
+///   pointer to an <tt>xchg_conflator</tt> structure
+/// @param [out] key
+///   pointer to storage for the key of the received message
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [in] buffer
+///   pointer to a memory buffer which will hold a copy of the message
+/// @param [in] sz_buffer
+///   size of the <tt>buffer</tt>, which must be at least <tt>sz_message</tt>
+/// @return
+///   <tt>true</tt> if a message was received into the provided <tt>xchg_message</tt>, otherwise <tt>false</tt>
+/// @note
+///   Each key is delivered at most once per batch of updates, so consumer work is bounded by the number of
+///   distinct keys rather than by the rate of updates.
+/// @note
+///   If the producer is in the middle of an update when the read begins, or is still updating after a bounded
+///   number of retries, the read fails instead of waiting and the key is delivered by a later call.
+/// @memberof xchg_conflator
+///
+bool xchg_conflator_receive(struct xchg_conflator *conflator, size_t *key, struct xchg_message *message,
+                            char *buffer, size_t sz_buffer);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>conflator</tt>
+///
+/// @param [in] conflator
+///   pointer to an <tt>xchg_conflator</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>conflator</tt>
+/// @memberof xchg_conflator
+///
+const char *xchg_conflator_strerror(const struct xchg_conflator *conflator);
+
+/// Represents a single shared message, guarded by a sequence lock, which one writer publishes in place and any
+/// number of readers copy out. It can be manipulated using the <tt>xchg_snapshot_*</tt> family of functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_snapshot
+{
+    volatile uint64_t *sequence;  ///< @private
+    volatile uint64_t *length;  ///< @private
+    char *data;  ///< @private
+    size_t sz_message;  ///< @private
+    bool writing;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>snapshot</tt> to use <tt>buffer</tt> of size <tt>sz_buffer</tt> as underlying shared memory.
+///
+/// @param [in] snapshot
+///   pointer to an <tt>xchg_snapshot</tt> structure
+/// @param [in] buffer
+///   pointer to the shared memory buffer, which must be zero-filled before first use and 8-byte aligned
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_snapshot</tt> was initialized, or <tt>false</tt> if invalid arguments
+///   were provided
+/// @note
+///   The first 64 bytes of <tt>buffer</tt> are reserved for the sequence lock, and the remainder holds the message.
+/// @memberof xchg_snapshot
+///
+bool xchg_snapshot_init(struct xchg_snapshot *snapshot, char *buffer, size_t sz_buffer);
+
+/// Prepares <tt>message</tt> with writable backing memory from <tt>snapshot</tt>, allowing the writer to construct
+/// a new message payload in place and then publish it via <tt>xchg_snapshot_publish</tt>.
+///
+/// @param [in] snapshot
+///   pointer to an <tt>xchg_snapshot</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was prepared, otherwise <tt>false</tt>
+/// @note
+///   Readers cannot read the snapshot until it is published, so the writer must not block in between.
+/// @memberof xchg_snapshot
+///
+bool xchg_snapshot_prepare(struct xchg_snapshot *snapshot, struct xchg_message *message);
+
+/// Publishes <tt>message</tt> (previously initialized via <tt>xchg_snapshot_prepare</tt>) as the current value of
+/// <tt>snapshot</tt>.
+///
+/// @param [in] snapshot
+///   pointer to an <tt>xchg_snapshot</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_snapshot_prepare</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was published, otherwise <tt>false</tt>
+/// @memberof xchg_snapshot
+///
+bool xchg_snapshot_publish(struct xchg_snapshot *snapshot, const struct xchg_message *message);
+
+/// Reads the current value of <tt>snapshot</tt> by copying it into <tt>buffer</tt> and initializing
+/// <tt>message</tt> with it.
+///
+/// @param [in] snapshot
+///   pointer to an <tt>xchg_snapshot</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [in] buffer
+///   pointer to a memory buffer which will hold a copy of the message
+/// @param [in] sz_buffer
+///   size of the <tt>buffer</tt>, which must be at least the size of the snapshot's message
+/// @param [out] version
+///   optional pointer to storage for the number of times the snapshot has been published
+/// @return
+///   <tt>true</tt> if the snapshot was read into the provided <tt>xchg_message</tt>, otherwise <tt>false</tt>
+/// @note
+///   The copy is retried until it is consistent. If the writer is in the middle of publishing when the read
+///   begins, or is still publishing after a bounded number of retries, the read fails instead of waiting.
+/// @memberof xchg_snapshot
+///
+bool xchg_snapshot_read(struct xchg_snapshot *snapshot, struct xchg_message *message,
+                        char *buffer, size_t sz_buffer, uint64_t *version);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>snapshot</tt>
+///
+/// @param [in] snapshot
+///   pointer to an <tt>xchg_snapshot</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>snapshot</tt>
+/// @memberof xchg_snapshot
+///
+const char *xchg_snapshot_strerror(const struct xchg_snapshot *snapshot);
+
+/// Callback invoked by <tt>xchg_rpc_dispatch</tt> when the response to a call arrives.
+///
+/// @param [in] context
+///   the opaque pointer which was provided to <tt>xchg_rpc_call</tt>
+/// @param [in] response
+///   pointer to the response <tt>xchg_message</tt>, positioned after its correlation id, which is only valid for
+///   the duration of the callback
+///
+typedef void (*xchg_rpc_callback)(void *context, struct xchg_message *response);
+
+/// Represents a completion slot for one in-flight call issued via <tt>xchg_rpc_call</tt>.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_rpc_call
+{
+    uint64_t id;  ///< @private
+    xchg_rpc_callback callback;  ///< @private
+    void *context;  ///< @private
+};
+
+/// Represents one end of a request/response exchange over an <tt>xchg_channel</tt>, where every message begins
+/// with a correlation id that the server echoes back in its response. It can be manipulated using the
+/// <tt>xchg_rpc_*</tt> family of functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_rpc
+{
+    struct xchg_channel *channel;  ///< @private
+    struct xchg_rpc_call *calls;  ///< @private
+    size_t mask;  ///< @private
+    uint64_t next_id;  ///< @private
+    size_t nr_pending;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>rpc</tt> to exchange requests and responses over <tt>channel</tt>, tracking up to
+/// <tt>nr_calls</tt> in-flight calls in the <tt>calls</tt> table.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] channel
+///   pointer to an initialized <tt>xchg_channel</tt> with both ingress and egress
+/// @param [in] calls
+///   pointer to a table of <tt>xchg_rpc_call</tt> completion slots, or <tt>NULL</tt> if this end only serves calls
+/// @param [in] nr_calls
+///   number of entries in <tt>calls</tt>, which must be a power of two, or zero if this end only serves calls
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_rpc</tt> was initialized, or <tt>false</tt> if invalid arguments were
+///   provided
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_init(struct xchg_rpc *rpc, struct xchg_channel *channel, struct xchg_rpc_call *calls, size_t nr_calls);
+
+/// Prepares <tt>message</tt> as the next request, stamping it with a fresh correlation id. The caller then writes
+/// the request arguments and issues it via <tt>xchg_rpc_call</tt>.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was prepared, otherwise <tt>false</tt>
+/// @note
+///   This fails if the completion slot for the next correlation id is still awaiting its response.
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_prepare(struct xchg_rpc *rpc, struct xchg_message *message);
+
+/// Sends the request <tt>message</tt> (previously initialized via <tt>xchg_rpc_prepare</tt>) without waiting for
+/// its response, which will be passed to <tt>callback</tt> by a later <tt>xchg_rpc_dispatch</tt>.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_rpc_prepare</tt>
+/// @param [in] callback
+///   function to be invoked with the response
+/// @param [in] context
+///   opaque pointer to be passed to <tt>callback</tt>
+/// @param [out] id
+///   optional pointer to storage for the correlation id of the call
+/// @return
+///   <tt>true</tt> if the request was sent, otherwise <tt>false</tt>
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_call(struct xchg_rpc *rpc, const struct xchg_message *message,
+                   xchg_rpc_callback callback, void *context, uint64_t *id);
+
+/// Receives all pending responses and invokes the completion callback of each corresponding call.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [out] nr_completed
+///   optional pointer to storage for the number of calls which were completed
+/// @return
+///   <tt>true</tt> if every pending response was dispatched, otherwise <tt>false</tt>
+/// @note
+///   A response which does not match an in-flight call is discarded and causes this to fail.
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_dispatch(struct xchg_rpc *rpc, size_t *nr_completed);
+
+/// Provides the number of calls which have been sent but have not yet been completed.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @return
+///   number of in-flight calls
+/// @memberof xchg_rpc
+///
+size_t xchg_rpc_pending(const struct xchg_rpc *rpc);
+
+/// Receives the next request into <tt>message</tt>, positioned after its correlation id.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [out] id
+///   pointer to storage for the correlation id, which must be passed to <tt>xchg_rpc_reply_prepare</tt>
+/// @return
+///   <tt>true</tt> if a request was received, otherwise <tt>false</tt>
+/// @note
+///   The request must be released via <tt>xchg_rpc_return</tt>, even if it has no valid correlation id.
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_receive(struct xchg_rpc *rpc, struct xchg_message *message, uint64_t *id);
+
+/// Returns the request <tt>message</tt> (previously initialized via <tt>xchg_rpc_receive</tt>) to <tt>rpc</tt>.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_rpc_receive</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was returned, otherwise <tt>false</tt>
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_return(struct xchg_rpc *rpc, const struct xchg_message *message);
+
+/// Prepares <tt>message</tt> as the response to the request with correlation id <tt>id</tt>.
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @param [in] id
+///   correlation id of the request, as provided by <tt>xchg_rpc_receive</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was prepared, otherwise <tt>false</tt>
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_reply_prepare(struct xchg_rpc *rpc, struct xchg_message *message, uint64_t id);
+
+/// Sends the response <tt>message</tt> (previously initialized via <tt>xchg_rpc_reply_prepare</tt>).
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_rpc_reply_prepare</tt>
+/// @return
+///   <tt>true</tt> if the response was sent, otherwise <tt>false</tt>
+/// @memberof xchg_rpc
+///
+bool xchg_rpc_reply(struct xchg_rpc *rpc, const struct xchg_message *message);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>rpc</tt>
+///
+/// @param [in] rpc
+///   pointer to an <tt>xchg_rpc</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>rpc</tt>
+/// @memberof xchg_rpc
+///
+const char *xchg_rpc_strerror(const struct xchg_rpc *rpc);
+
+/// Maximum number of channels which can be serviced by a single <tt>xchg_poller</tt>.
+///
+#define XCHG_POLLER_MAX 512
+
+/// Size, in bytes, of the shared memory buffer backing the readiness bitmap of an <tt>xchg_poller</tt>.
+///
+#define XCHG_POLLER_SIZE (XCHG_POLLER_MAX / 8)
+
+/// Represents the order in which an <tt>xchg_poller</tt> services its ready channels.
+///
+enum xchg_poller_policy
+{
+    xchg_poller_policy_fair,  ///< Service ready channels round-robin, one message at a time
+    xchg_poller_policy_priority,  ///< Always service the ready channel with the lowest index first
+};
+
+/// Represents a selector which receives messages from many <tt>xchg_channel</tt>s using a shared readiness bitmap,
+/// so that a single cache line read identifies which of them have messages available.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_poller
+{
+    volatile uint64_t *bitmap;  ///< @private
+    struct xchg_channel **channels;  ///< @private
+    size_t nr_channels;  ///< @private
+    enum xchg_poller_policy policy;  ///< @private
+    size_t cursor;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>channel</tt> to mark bit <tt>index</tt> of the shared readiness <tt>bitmap</tt> whenever it sends
+/// a message, so that the consuming <tt>xchg_poller</tt> learns that the peer channel has messages available.
+///
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure with an egress buffer
+/// @param [in] bitmap
+///   pointer to the shared memory buffer backing the readiness bitmap, or <tt>NULL</tt> to stop notifying
+/// @param [in] sz_bitmap
+///   size, in bytes, of the <tt>bitmap</tt> memory buffer
+/// @param [in] index
+///   index of the peer channel in the <tt>channels</tt> array of the consuming <tt>xchg_poller</tt>
+/// @return
+///   <tt>true</tt> if notifications were configured, or <tt>false</tt> if invalid arguments were provided
+/// @note
+///   The <tt>bitmap</tt> buffer must be 8-byte aligned and at least <tt>XCHG_POLLER_SIZE</tt> bytes long.
+/// @memberof xchg_channel
+///
+bool xchg_channel_set_notify(struct xchg_channel *channel, char *bitmap, size_t sz_bitmap, size_t index);
+
+/// Configures <tt>poller</tt> to service the ingress rings of <tt>nr_channels</tt> <tt>channels</tt> according to
+/// <tt>policy</tt>, using <tt>bitmap</tt> of size <tt>sz_bitmap</tt> as the shared readiness bitmap.
+///
+/// @param [in] poller
+///   pointer to an <tt>xchg_poller</tt> structure
+/// @param [in] policy
+///   order in which ready channels are serviced
+/// @param [in] bitmap
+///   pointer to the shared memory buffer backing the readiness bitmap
+/// @param [in] sz_bitmap
+///   size, in bytes, of the <tt>bitmap</tt> memory buffer
+/// @param [in] channels
+///   array of pointers to <tt>xchg_channel</tt> structures with ingress buffers
+/// @param [in] nr_channels
+///   number of entries in <tt>channels</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_poller</tt> was initialized, or <tt>false</tt> if invalid arguments
+///   were provided
+/// @note
+///   The <tt>channels</tt> array is referenced, not copied, and must outlive <tt>poller</tt>.
+/// @note
+///   The bits of all <tt>nr_channels</tt> channels are initially set, so that messages sent before the producers were configured via
+///   <tt>xchg_channel_set_notify</tt> are not missed.
+/// @memberof xchg_poller
+///
+bool xchg_poller_init(struct xchg_poller *poller, enum xchg_poller_policy policy,
+                      char *bitmap, size_t sz_bitmap, struct xchg_channel *channels[], size_t nr_channels);
+
+/// Receives the next available message from any of the channels of <tt>poller</tt> into <tt>message</tt>.
+///
+/// @param [in] poller
+///   pointer to an <tt>xchg_poller</tt> structure
+/// @param [out] channel
+///   pointer to storage for a pointer to the <tt>xchg_channel</tt> from which <tt>message</tt> was received
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @return
+///   <tt>true</tt> if a message was received into the provided <tt>xchg_message</tt>, otherwise <tt>false</tt>
+/// @note
+///   The caller must return <tt>message</tt> to <tt>*channel</tt> via <tt>xchg_channel_return</tt>. If
+///   <tt>xchg_channel_receive</tt> fails on a ready channel, <tt>*channel</tt> is still provided so the caller can
+///   inspect its error.
+/// @memberof xchg_poller
+///
+bool xchg_poller_receive(struct xchg_poller *poller, struct xchg_channel **channel, struct xchg_message *message);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>poller</tt>
+///
+/// @param [in] poller
+///   pointer to an <tt>xchg_poller</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>poller</tt>
+/// @memberof xchg_poller
+///
+const char *xchg_poller_strerror(const struct xchg_poller *poller);
+
+/// Size, in bytes, of the header at the start of a recording buffer written by an <tt>xchg_recorder</tt>.
+///
+#define XCHG_RECORDING_HEADER_SIZE 64u
+
+/// Version of the recording layout written by <tt>xchg_recorder</tt> and required by <tt>xchg_replayer</tt>.
+///
+#define XCHG_RECORDING_VERSION 1u
+
+/// Represents the metadata stored in front of each message payload in a recording. Records are laid out back to
+/// back after the recording header, each padded to a multiple of 8 bytes.
+///
+struct xchg_record
+{
+    uint64_t timestamp;  ///< <tt>CLOCK_REALTIME</tt> time, in nanoseconds, at which the message was recorded
+    uint64_t sequence;  ///< Position of the record in the recording, starting from zero
+    uint32_t length;  ///< Number of payload bytes which follow the record
+    uint32_t type;  ///< User-defined message type, if the message was received from a channel with message headers
+};
+
+/// Represents an append-only capture of messages, written into a shared memory buffer which is typically a
+/// <tt>MAP_SHARED</tt> mapping of a file, and manipulated using the <tt>xchg_recorder_*</tt> family of functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_recorder
+{
+    char *buffer;  ///< @private
+    size_t sz_buffer;  ///< @private
+    size_t position;  ///< @private
+    uint64_t sequence;  ///< @private
+    struct xchg_index *index;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>recorder</tt> to append records to <tt>buffer</tt> of size <tt>sz_buffer</tt>.
+///
+/// @param [in] recorder
+///   pointer to an <tt>xchg_recorder</tt> structure
+/// @param [in] buffer
+///   pointer to a memory buffer aligned to 8 bytes
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt> memory buffer, which must be larger than
+///   <tt>XCHG_RECORDING_HEADER_SIZE</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_recorder</tt> was initialized, otherwise <tt>false</tt>
+/// @note
+///   If <tt>buffer</tt> already holds a recording, new records are appended after its last complete record, so a
+///   recorder which was restarted continues the same capture. If it holds no recording header at all, a new, empty
+///   recording is started. A recording header which fails validation is left untouched and reported as an error.
+/// @memberof xchg_recorder
+///
+bool xchg_recorder_init(struct xchg_recorder *recorder, char *buffer, size_t sz_buffer);
+
+/// Appends the payload of <tt>message</tt>, which was received from a channel, to the recording, along with the
+/// current time and <tt>type</tt>.
+///
+/// @param [in] recorder
+///   pointer to an <tt>xchg_recorder</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> whose payload is recorded up to its length
+/// @param [in] type
+///   user-defined message type to store with the record
+/// @return
+///   <tt>true</tt> if the message was recorded, or <tt>false</tt> if the recording is full
+/// @note
+///   Each record only becomes visible to an <tt>xchg_replayer</tt> reading the same buffer once it is complete.
+/// @memberof xchg_recorder
+///
+bool xchg_recorder_record(struct xchg_recorder *recorder, const struct xchg_message *message, uint32_t type);
+
+/// Receives every message available on <tt>channel</tt>, records it, and returns it to the channel, so that a
+/// channel dedicated to the recorder acts as a tap on the traffic fed into it.
+///
+/// @param [in] recorder
+///   pointer to an <tt>xchg_recorder</tt> structure
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure with an ingress buffer
+/// @param [out] nr_recorded
+///   optional pointer to storage for the number of messages recorded
+/// @return
+///   <tt>true</tt> if the channel was drained, otherwise <tt>false</tt>, in which case
+///   <tt>xchg_recorder_strerror</tt> describes the failure
+/// @note
+///   Messages with a user-defined type keep it if <tt>channel</tt> was configured with
+///   <tt>xchg_channel_flag_header</tt>. A message which does not fit into the recording is left in the channel.
+/// @memberof xchg_recorder
+///
+bool xchg_recorder_drain(struct xchg_recorder *recorder, struct xchg_channel *channel, size_t *nr_recorded);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>recorder</tt>
+///
+/// @param [in] recorder
+///   pointer to an <tt>xchg_recorder</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>recorder</tt>
+/// @memberof xchg_recorder
+///
+const char *xchg_recorder_strerror(const struct xchg_recorder *recorder);
+
+/// Represents a cursor over a recording written by an <tt>xchg_recorder</tt>, which can read its records or feed
+/// them back into an <tt>xchg_channel</tt> using the <tt>xchg_replayer_*</tt> family of functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_replayer
+{
+    const char *buffer;  ///< @private
+    size_t sz_buffer;  ///< @private
+    size_t position;  ///< @private
+    uint64_t origin;  ///< @private
+    uint64_t start;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>replayer</tt> to read the recording in <tt>buffer</tt> of size <tt>sz_buffer</tt> from its first
+/// record.
+///
+/// @param [in] replayer
+///   pointer to an <tt>xchg_replayer</tt> structure
+/// @param [in] buffer
+///   pointer to a memory buffer holding a recording, which may be a read-only mapping
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt> memory buffer
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_replayer</tt> was initialized, or <tt>false</tt> if the buffer holds no
+///   recording of a supported version
+/// @note
+///   A recording may be replayed while it is still being written, in which case the replayer picks up records as
+///   they are completed.
+/// @memberof xchg_replayer
+///
+bool xchg_replayer_init(struct xchg_replayer *replayer, const char *buffer, size_t sz_buffer);
+
+/// Reads the next record of the recording and advances past it.
+///
+/// @param [in] replayer
+///   pointer to an <tt>xchg_replayer</tt> structure
+/// @param [out] record
+///   pointer to storage for an <tt>xchg_record</tt>
+/// @param [out] payload
+///   pointer to storage for a pointer to the <tt>record->length</tt> payload bytes within the recording
+/// @return
+///   <tt>true</tt> if a record was read, or <tt>false</tt> if no more complete records are available
+/// @memberof xchg_replayer
+///
+bool xchg_replayer_read(struct xchg_replayer *replayer, struct xchg_record *record, const char **payload);
+
+/// Sends the recorded messages which are due into <tt>channel</tt>, for as long as it has free space.
+///
+/// @param [in] replayer
+///   pointer to an <tt>xchg_replayer</tt> structure
+/// @param [in] channel
+///   pointer to an <tt>xchg_channel</tt> structure with an egress buffer
+/// @param [in] speed
+///   replay speed relative to the recording, where 1 keeps the original spacing between messages, 2 halves it, and
+///   0 sends every message as soon as the channel has room
+/// @param [out] nr_sent
+///   optional pointer to storage for the number of messages sent
+/// @return
+///   <tt>true</tt> if the recording has messages left, or <tt>false</tt> once every message has been sent or if a
+///   message could not be sent, in which case <tt>xchg_replayer_strerror</tt> describes the failure
+/// @note
+///   This never blocks, so it is meant to be called in a loop. Timing starts at the first call after
+///   initialization or <tt>xchg_replayer_rewind</tt>, and messages which fell behind schedule are sent back to back.
+/// @memberof xchg_replayer
+///
+bool xchg_replayer_send(struct xchg_replayer *replayer, struct xchg_channel *channel, double speed, size_t *nr_sent);
+
+/// Moves <tt>replayer</tt> back to the first record and restarts its timing, so that a recording can be replayed
+/// in a loop, for example as a load generator.
+///
+/// @param [in] replayer
+///   pointer to an <tt>xchg_replayer</tt> structure
+/// @return
+///   <tt>true</tt> if the replayer was rewound, otherwise <tt>false</tt>
+/// @memberof xchg_replayer
+///
+bool xchg_replayer_rewind(struct xchg_replayer *replayer);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>replayer</tt>
+///
+/// @param [in] replayer
+///   pointer to an <tt>xchg_replayer</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>replayer</tt>
+/// @memberof xchg_replayer
+///
+const char *xchg_replayer_strerror(const struct xchg_replayer *replayer);
+
+/// Represents one end of an append-only journal of messages, stored as a series of segments which are typically
+/// <tt>MAP_SHARED</tt> mappings of files, and manipulated using the <tt>xchg_journal_*</tt> family of functions.
+/// A writer constructs messages in place in the current segment, and any number of readers tail the segments with
+/// cursors of their own, so that persisting a stream never copies it.
+///
+/// @note
+///   Each segment uses the recording layout, so a complete segment can also be read by an <tt>xchg_replayer</tt>.
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_journal
+{
+    char *segment;  ///< @private
+    size_t sz_segment;  ///< @private
+    size_t position;  ///< @private
+    uint64_t segment_index;  ///< @private
+    uint64_t sequence;  ///< @private
+    bool writable;  ///< @private
+    struct xchg_index *index;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>journal</tt> as the writer of a journal whose current segment is <tt>segment</tt>.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [in] segment
+///   pointer to a memory buffer aligned to 8 bytes
+/// @param [in] sz_segment
+///   size, in bytes, of the <tt>segment</tt> memory buffer, which must be larger than
+///   <tt>XCHG_RECORDING_HEADER_SIZE</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_journal</tt> was initialized, otherwise <tt>false</tt>
+/// @note
+///   If <tt>segment</tt> already holds a journal segment, new messages are appended after its last complete
+///   message, so a writer which was restarted over the newest segment continues the same journal. If it holds no
+///   segment header at all, the first segment of a new journal is started. A segment header which fails validation
+///   is left untouched and reported as an error.
+/// @note
+///   A writer which crashed while rolling over may find the newest segment already sealed. It can then only roll
+///   over via <tt>xchg_journal_roll</tt>, which starts the next segment with the index and sequence that follow.
+/// @memberof xchg_journal
+///
+bool xchg_journal_init(struct xchg_journal *journal, char *segment, size_t sz_segment);
+
+/// Configures <tt>journal</tt> as a reader of the journal segment <tt>segment</tt>, positioned at its first message.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [in] segment
+///   pointer to a memory buffer holding a journal segment, which may be a read-only mapping
+/// @param [in] sz_segment
+///   size, in bytes, of the <tt>segment</tt> memory buffer
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_journal</tt> was initialized, or <tt>false</tt> if the buffer holds no
+///   journal segment of a supported version
+/// @memberof xchg_journal
+///
+bool xchg_journal_open(struct xchg_journal *journal, const char *segment, size_t sz_segment);
+
+/// Moves <tt>journal</tt> on to <tt>segment</tt>, the segment which follows its current one.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [in] segment
+///   pointer to a memory buffer aligned to 8 bytes, which must hold the next journal segment if <tt>journal</tt>
+///   is a reader
+/// @param [in] sz_segment
+///   size, in bytes, of the <tt>segment</tt> memory buffer
+/// @return
+///   <tt>true</tt> if <tt>journal</tt> moved on to <tt>segment</tt>, otherwise <tt>false</tt>
+/// @note
+///   A writer seals its current segment and starts a new one in <tt>segment</tt>, which is overwritten, and should
+///   roll over once <tt>xchg_journal_prepare</tt> reports that the segment is full or sealed. A reader may only roll
+///   over once it has received every message of a sealed segment, and <tt>segment</tt> must be the one which the
+///   writer started next.
+/// @memberof xchg_journal
+///
+bool xchg_journal_roll(struct xchg_journal *journal, char *segment, size_t sz_segment);
+
+/// Prepares <tt>message</tt> with writable backing memory in the current segment of <tt>journal</tt>, allowing the
+/// caller to construct a message payload in place and then append it via <tt>xchg_journal_send</tt>.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure which was initialized via <tt>xchg_journal_init</tt>
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was prepared, otherwise <tt>false</tt>
+/// @note
+///   The message spans the rest of the segment, and only the bytes written to it are appended. A message whose
+///   payload does not fit is abandoned by not sending it, and can be rebuilt after <tt>xchg_journal_roll</tt>.
+/// @memberof xchg_journal
+///
+bool xchg_journal_prepare(struct xchg_journal *journal, struct xchg_message *message);
+
+/// Appends <tt>message</tt> (previously initialized via <tt>xchg_journal_prepare</tt>) to <tt>journal</tt>,
+/// tagging it with the user-defined message <tt>type</tt>.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_journal_prepare</tt>
+/// @param [in] type
+///   user-defined message type which readers can retrieve via <tt>xchg_journal_record</tt>
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_message</tt> was appended, otherwise <tt>false</tt>
+/// @note
+///   The message only becomes visible to readers once it is complete.
+/// @memberof xchg_journal
+///
+bool xchg_journal_send(struct xchg_journal *journal, const struct xchg_message *message, uint32_t type);
+
+/// Receives the message at the cursor of <tt>journal</tt> into <tt>message</tt>, allowing the caller to read the
+/// message payload in place and then advance past it via <tt>xchg_journal_return</tt>.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure which was initialized via <tt>xchg_journal_open</tt>
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> to be initialized
+/// @return
+///   <tt>true</tt> if a message was received into the provided <tt>xchg_message</tt>, otherwise <tt>false</tt>
+/// @note
+///   Once every message of a sealed segment has been received, this fails with an error saying so, and the reader
+///   should move on to the next segment via <tt>xchg_journal_roll</tt>.
+/// @memberof xchg_journal
+///
+bool xchg_journal_receive(struct xchg_journal *journal, struct xchg_message *message);
+
+/// Provides the record stored in front of <tt>message</tt> (previously initialized via
+/// <tt>xchg_journal_receive</tt>), holding the time at which it was appended, its sequence, and its type.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_journal_receive</tt>
+/// @param [out] record
+///   pointer to storage for an <tt>xchg_record</tt>
+/// @return
+///   <tt>true</tt> if the record argument was filled, otherwise <tt>false</tt>
+/// @note
+///   Sequences continue across segments, so they number every message in the journal.
+/// @memberof xchg_journal
+///
+bool xchg_journal_record(struct xchg_journal *journal, const struct xchg_message *message,
+                         struct xchg_record *record);
+
+/// Advances the cursor of <tt>journal</tt> past <tt>message</tt> (previously initialized via
+/// <tt>xchg_journal_receive</tt>).
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [in] message
+///   pointer to an <tt>xchg_message</tt> which was previously initialized by <tt>xchg_journal_receive</tt>
+/// @return
+///   <tt>true</tt> if the cursor was advanced, otherwise <tt>false</tt>
+/// @note
+///   Messages are never removed from the journal, so they remain available to other readers and to later replays.
+/// @memberof xchg_journal
+///
+bool xchg_journal_return(struct xchg_journal *journal, const struct xchg_message *message);
+
+/// Provides the position of <tt>journal</tt>, which for a writer is where its next message will be appended, and for
+/// a reader is its cursor.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @param [out] segment
+///   optional pointer to storage for the index of the current segment, starting from zero
+/// @param [out] offset
+///   optional pointer to storage for the byte offset within the current segment
+/// @param [out] sequence
+///   optional pointer to storage for the sequence of the message at that offset
+/// @return
+///   <tt>true</tt> if the position was provided, otherwise <tt>false</tt>
+/// @memberof xchg_journal
+///
+bool xchg_journal_tell(const struct xchg_journal *journal, uint64_t *segment, size_t *offset, uint64_t *sequence);
+
+/// Moves the cursor of <tt>journal</tt> to <tt>offset</tt> within its current segment, so that a reader which was
+/// restarted, or which is replaying, can resume from a position it saved via <tt>xchg_journal_tell</tt>.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure which was initialized via <tt>xchg_journal_open</tt>
+/// @param [in] offset
+///   byte offset within the current segment of a message boundary, as provided by <tt>xchg_journal_tell</tt>
+/// @param [in] sequence
+///   sequence of the message at <tt>offset</tt>, as provided by <tt>xchg_journal_tell</tt>
+/// @return
+///   <tt>true</tt> if the cursor was moved, otherwise <tt>false</tt>
+/// @note
+///   An offset at the end of the written messages is valid, in which case the reader waits for the next message.
+/// @memberof xchg_journal
+///
+bool xchg_journal_seek(struct xchg_journal *journal, size_t offset, uint64_t sequence);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>journal</tt>
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>journal</tt>
+/// @memberof xchg_journal
+///
+const char *xchg_journal_strerror(const struct xchg_journal *journal);
+
+/// Size, in bytes, of the header at the start of an index buffer written by an <tt>xchg_index</tt>.
+///
+#define XCHG_INDEX_HEADER_SIZE 64u
+
+/// Version of the index layout written and read by <tt>xchg_index</tt>.
+///
+#define XCHG_INDEX_VERSION 1u
+
+/// Represents one entry of an <tt>xchg_index</tt>, locating a message within a recording or a journal. Entries are
+/// laid out back to back after the index header, in the order the messages were written.
+///
+struct xchg_index_entry
+{
+    uint64_t sequence;  ///< Sequence of the message, see <tt>xchg_record</tt>
+    uint64_t timestamp;  ///< Time at which the message was written, see <tt>xchg_record</tt>, never less than that of the previous entry
+    uint64_t segment;  ///< Index of the journal segment holding the message, always zero for a recording
+    uint64_t offset;  ///< Byte offset of the message's record within its recording or journal segment
+};
+
+/// Represents a sparse index over a recording or a journal, which maps the sequence and time of every
+/// <tt>interval</tt>-th message to its position, so that a reader can start from any point without scanning the
+/// messages before it. The index is written into a separate buffer, typically a <tt>MAP_SHARED</tt> mapping of a
+/// file, and manipulated using the <tt>xchg_index_*</tt> family of functions.
+///
+/// @note
+///   This type should be treated as opaque.
+///
+struct xchg_index
+{
+    char *buffer;  ///< @private
+    size_t sz_buffer;  ///< @private
+    uint64_t interval;  ///< @private
+    size_t nr_entries;  ///< @private
+    bool writable;  ///< @private
+    char *error;  ///< @private
+};
+
+/// Configures <tt>index</tt> to append entries to <tt>buffer</tt> of size <tt>sz_buffer</tt>, one for every
+/// <tt>interval</tt>-th message.
+///
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure
+/// @param [in] buffer
+///   pointer to a memory buffer aligned to 8 bytes
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt> memory buffer, which must have room for at least one entry after
+///   <tt>XCHG_INDEX_HEADER_SIZE</tt>
+/// @param [in] interval
+///   number of messages per entry, where 1 indexes every message
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_index</tt> was initialized, otherwise <tt>false</tt>
+/// @note
+///   If <tt>buffer</tt> already holds an index with the same interval, new entries are appended after its last
+///   one, so an index can be restarted along with the recorder or journal that feeds it. If it holds no index
+///   header at all, a new, empty index is started. An index header which fails validation is left untouched and
+///   reported as an error.
+/// @memberof xchg_index
+///
+bool xchg_index_init(struct xchg_index *index, char *buffer, size_t sz_buffer, uint64_t interval);
+
+/// Configures <tt>index</tt> to search the index in <tt>buffer</tt> of size <tt>sz_buffer</tt>.
+///
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure
+/// @param [in] buffer
+///   pointer to a memory buffer holding an index, which may be a read-only mapping
+/// @param [in] sz_buffer
+///   size, in bytes, of the <tt>buffer</tt> memory buffer
+/// @return
+///   <tt>true</tt> if the provided <tt>xchg_index</tt> was initialized, or <tt>false</tt> if the buffer holds no
+///   index of a supported version
+/// @note
+///   An index may be searched while it is still being written, in which case every search sees the entries
+///   which were complete when it began.
+/// @memberof xchg_index
+///
+bool xchg_index_open(struct xchg_index *index, const char *buffer, size_t sz_buffer);
+
+/// Adds an entry for the message described by <tt>record</tt> to <tt>index</tt>, if its sequence falls on the
+/// index interval.
+///
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure which was initialized via <tt>xchg_index_init</tt>
+/// @param [in] record
+///   pointer to the <tt>xchg_record</tt> of the message
+/// @param [in] segment
+///   index of the journal segment holding the message, or zero for a recording
+/// @param [in] offset
+///   byte offset of the message's record within its recording or journal segment
+/// @return
+///   <tt>true</tt> if the message was indexed or skipped, or <tt>false</tt> if the index is full
+/// @note
+///   Recorders and journals call this as they write, see <tt>xchg_recorder_set_index</tt> and
+///   <tt>xchg_journal_set_index</tt>. Calling it directly allows an index to be built for an existing capture.
+/// @note
+///   Record timestamps come from <tt>CLOCK_REALTIME</tt>, which may be stepped back. An entry's timestamp is raised
+///   to that of the previous entry when needed, so that entry timestamps never decrease.
+/// @memberof xchg_index
+///
+bool xchg_index_add(struct xchg_index *index, const struct xchg_record *record, uint64_t segment, size_t offset);
+
+/// Finds the last entry of <tt>index</tt> at or before the message with sequence <tt>sequence</tt>.
+///
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure
+/// @param [in] sequence
+///   sequence of the message to seek to
+/// @param [out] entry
+///   pointer to storage for an <tt>xchg_index_entry</tt>, from which at most <tt>interval - 1</tt> messages must be
+///   skipped to reach the target
+/// @return
+///   <tt>true</tt> if an entry was found, or <tt>false</tt> if every entry is after the target
+/// @note
+///   This is a binary search, so it takes microseconds even over an index of millions of entries.
+/// @memberof xchg_index
+///
+bool xchg_index_seek_sequence(struct xchg_index *index, uint64_t sequence, struct xchg_index_entry *entry);
+
+/// Finds the last entry of <tt>index</tt> for a message written at or before <tt>timestamp</tt>.
+///
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure
+/// @param [in] timestamp
+///   <tt>CLOCK_REALTIME</tt> time, in nanoseconds, to seek to
+/// @param [out] entry
+///   pointer to storage for an <tt>xchg_index_entry</tt>
+/// @return
+///   <tt>true</tt> if an entry was found, or <tt>false</tt> if every entry is after the target
+/// @note
+///   Entry timestamps never decrease, see <tt>xchg_index_add</tt>. If the realtime clock was stepped back while the
+///   messages were written, the entry found may be up to that step away from the target.
+/// @memberof xchg_index
+///
+bool xchg_index_seek_time(struct xchg_index *index, uint64_t timestamp, struct xchg_index_entry *entry);
+
+/// Provides a static string describing the error that occurred during the last operation on <tt>index</tt>
+///
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure
+/// @return
+///   pointer to a static string describing the error that occurred during the last operation on <tt>index</tt>
+/// @memberof xchg_index
+///
+const char *xchg_index_strerror(const struct xchg_index *index);
+
+/// Configures <tt>recorder</tt> to add every message it records to <tt>index</tt>.
+///
+/// @param [in] recorder
+///   pointer to an <tt>xchg_recorder</tt> structure
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure which was initialized via <tt>xchg_index_init</tt>, or
+///   <tt>NULL</tt> to stop indexing
+/// @return
+///   <tt>true</tt> if indexing was configured, otherwise <tt>false</tt>
+/// @note
+///   Once the index is full, messages are still recorded but no longer indexed, and <tt>xchg_index_strerror</tt>
+///   says so.
+/// @memberof xchg_recorder
+///
+bool xchg_recorder_set_index(struct xchg_recorder *recorder, struct xchg_index *index);
+
+/// Configures <tt>journal</tt>, which must be a writer, to add every message it appends to <tt>index</tt>.
+///
+/// @param [in] journal
+///   pointer to an <tt>xchg_journal</tt> structure which was initialized via <tt>xchg_journal_init</tt>
+/// @param [in] index
+///   pointer to an <tt>xchg_index</tt> structure which was initialized via <tt>xchg_index_init</tt>, or
+///   <tt>NULL</tt> to stop indexing
+/// @return
+///   <tt>true</tt> if indexing was configured, otherwise <tt>false</tt>
+/// @note
+///   Once the index is full, messages are still appended but no longer indexed, and <tt>xchg_index_strerror</tt>
+///   says so.
+/// @memberof xchg_journal
+///
+bool xchg_journal_set_index(struct xchg_journal *journal, struct xchg_index *index);
+
+/// Moves <tt>replayer</tt> to the record at <tt>offset</tt>, typically found via <tt>xchg_index_seek_sequence</tt>
+/// or <tt>xchg_index_seek_time</tt>, and restarts its timing.
+///
+/// @param [in] replayer
+///   pointer to an <tt>xchg_replayer</tt> structure
+/// @param [in] offset
+///   byte offset of a record within the recording
+/// @param [in] sequence
+///   sequence of the record at <tt>offset</tt>, which guards against an offset from a different recording
+/// @return
+///   <tt>true</tt> if the replayer was moved, otherwise <tt>false</tt>
+/// @note
+///   An offset at the end of the recorded records is valid, in which case the replayer has no more records until
+///   more are recorded.
+/// @memberof xchg_replayer
+///
+bool xchg_replayer_seek(struct xchg_replayer *replayer, size_t offset, uint64_t sequence);
+
 #ifdef __cplusplus
 }
 #endif
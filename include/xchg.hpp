@@ -0,0 +1,343 @@
+/* xchg.hpp
+ * Copyright (c) 2019 Alex Forster
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "xchg.h"
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+
+namespace xchg
+{
+
+/// Represents a suspended channel operation which a <tt>scheduler</tt> holds until the operation can complete.
+///
+/// @note
+///   Waiters are owned by the awaiting coroutine's frame, so scheduling one never allocates.
+///
+class waiter
+{
+public:
+    /// Attempts to complete the channel operation without blocking.
+    ///
+    /// @return
+    ///   <tt>true</tt> if the operation completed and the coroutine may be resumed, otherwise <tt>false</tt>
+    ///
+    virtual bool try_complete() = 0;
+
+    std::coroutine_handle<> handle;  ///< coroutine to be resumed once <tt>try_complete</tt> succeeds
+    waiter *next = nullptr;  ///< intrusive link for use by a <tt>scheduler</tt>
+
+protected:
+    ~waiter() = default;
+};
+
+/// Represents an executor that resumes coroutines once their channel operations can complete. Implement this to
+/// drive channel awaitables from an existing event loop.
+///
+class scheduler
+{
+public:
+    virtual ~scheduler() = default;
+
+    /// Parks <tt>waiter</tt> until its <tt>try_complete</tt> succeeds, after which the scheduler must resume
+    /// <tt>waiter.handle</tt> exactly once.
+    ///
+    /// @param [in] waiter
+    ///   the suspended operation, which remains valid until it is resumed
+    ///
+    virtual void wait(waiter &waiter) = 0;
+};
+
+/// Single-threaded <tt>scheduler</tt> which resumes coroutines from <tt>poll</tt> or <tt>run</tt> on the calling
+/// thread, allowing any number of coroutines to share a few channels with no thread per channel.
+///
+class poll_executor final : public scheduler
+{
+public:
+    void wait(waiter &waiter) override
+    {
+        waiter.next = nullptr;
+        if(tail != nullptr)
+        {
+            tail->next = &waiter;
+        }
+        else
+        {
+            head = &waiter;
+        }
+        tail = &waiter;
+    }
+
+    /// Attempts every parked operation once, in the order they were parked, resuming those which complete.
+    ///
+    /// @return
+    ///   number of coroutines which were resumed
+    ///
+    size_t poll()
+    {
+        // operations parked by the coroutines resumed here are attempted on the next pass, not this one
+
+        waiter *pending = head;
+        head = tail = nullptr;
+
+        size_t nr_resumed = 0;
+        while(pending != nullptr)
+        {
+            waiter *current = pending;
+            pending = current->next;
+
+            if(current->try_complete())
+            {
+                nr_resumed += 1;
+                current->handle.resume();
+            }
+            else
+            {
+                wait(*current);
+            }
+        }
+
+        return nr_resumed;
+    }
+
+    /// Polls until no operations remain parked.
+    ///
+    /// @note
+    ///   This busy-polls while the parked operations depend on another thread.
+    ///
+    void run()
+    {
+        while(!empty())
+        {
+            poll();
+        }
+    }
+
+    /// @return
+    ///   <tt>true</tt> if no operations are parked, otherwise <tt>false</tt>
+    ///
+    bool empty() const
+    {
+        return head == nullptr;
+    }
+
+private:
+    waiter *head = nullptr;
+    waiter *tail = nullptr;
+};
+
+/// Awaitable returned by <tt>channel::receive</tt>, which resumes with a message received from the channel.
+///
+/// @note
+///   If the message was received but failed validation, <tt>xchg_channel_strerror</tt> describes the failure, and
+///   the message must still be returned via <tt>xchg_channel_return</tt>.
+/// @note
+///   While a received message has not yet been returned, the awaitable stays parked, so a coroutine must return its
+///   message before receiving the next one from the same channel.
+///
+class receive_awaitable final : private waiter
+{
+public:
+    receive_awaitable(xchg_channel *target, scheduler *executor) : channel(target), sched(executor)
+    {
+    }
+
+    bool await_ready()
+    {
+        return try_complete();
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        handle = awaiting;
+        sched->wait(*this);
+    }
+
+    xchg_message await_resume() const
+    {
+        return message;
+    }
+
+private:
+    bool try_complete() override
+    {
+        // the ring hands out the same slot until it is returned, so wait for whoever holds it
+
+        if(channel->ingress.held)
+        {
+            return false;
+        }
+
+        // receive only initializes the message when one was consumed, even if it then failed validation
+
+        message = {};
+        return xchg_channel_receive(channel, &message) || message.data != nullptr || channel->ingress.data == nullptr;
+    }
+
+    xchg_channel *channel;
+    scheduler *sched;
+    xchg_message message = {};
+};
+
+/// Awaitable returned by <tt>channel::prepare</tt>, which resumes with a message prepared on the channel.
+///
+/// @note
+///   If the channel has no egress the awaitable resumes immediately, and <tt>xchg_channel_strerror</tt> describes
+///   the failure.
+/// @note
+///   While a prepared message has not yet been sent, the awaitable stays parked, so a coroutine must send its
+///   message before preparing the next one on the same channel.
+///
+class prepare_awaitable final : private waiter
+{
+public:
+    prepare_awaitable(xchg_channel *target, scheduler *executor) : channel(target), sched(executor)
+    {
+    }
+
+    bool await_ready()
+    {
+        return try_complete();
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        handle = awaiting;
+        sched->wait(*this);
+    }
+
+    xchg_message await_resume() const
+    {
+        return message;
+    }
+
+private:
+    bool try_complete() override
+    {
+        if(channel->egress.held)
+        {
+            return false;
+        }
+
+        message = {};
+        return xchg_channel_prepare(channel, &message) || channel->egress.data == nullptr;
+    }
+
+    xchg_channel *channel;
+    scheduler *sched;
+    xchg_message message = {};
+};
+
+/// Binds an initialized <tt>xchg_channel</tt> to a <tt>scheduler</tt>, providing awaitable counterparts to
+/// <tt>xchg_channel_receive</tt> and <tt>xchg_channel_prepare</tt>. Sending and returning messages never wait, so
+/// those are provided as plain calls.
+///
+class channel
+{
+public:
+    channel(xchg_channel *target, scheduler &executor) : raw(target), sched(&executor)
+    {
+    }
+
+    /// @return
+    ///   awaitable which resumes with the next message received from the channel
+    ///
+    receive_awaitable receive()
+    {
+        return receive_awaitable(raw, sched);
+    }
+
+    /// @return
+    ///   awaitable which resumes with a message prepared on the channel once it has free space
+    ///
+    prepare_awaitable prepare()
+    {
+        return prepare_awaitable(raw, sched);
+    }
+
+    /// @see xchg_channel_send
+    ///
+    bool send(const xchg_message &message)
+    {
+        return xchg_channel_send(raw, &message);
+    }
+
+    /// @see xchg_channel_return
+    ///
+    bool release(const xchg_message &message)
+    {
+        return xchg_channel_return(raw, &message);
+    }
+
+    /// @see xchg_channel_strerror
+    ///
+    const char *strerror() const
+    {
+        return xchg_channel_strerror(raw);
+    }
+
+    /// @return
+    ///   the underlying <tt>xchg_channel</tt>
+    ///
+    xchg_channel *get() const
+    {
+        return raw;
+    }
+
+private:
+    xchg_channel *raw;
+    scheduler *sched;
+};
+
+/// Fire-and-forget coroutine type, which starts running immediately and frees itself when it finishes.
+///
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+}  // namespace xchg
+
+#endif
@@ -14,15 +14,51 @@
  * limitations under the License.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <errno.h>
+#include <signal.h>
 #include <string.h>
 #include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#include <tmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#if defined(XCHG_USDT)
+#include <sys/sdt.h>
+#endif
 
 #include "xchg.h"
 
 #define likely(x) __builtin_expect(!!(x), true)
 #define unlikely(x) __builtin_expect(!!(x), false)
 
+// USDT static tracepoints under the "xchg" provider, compiled in only when XCHG_USDT is defined. Each is a single
+// nop until a tracer attaches. Every probe carries the address of the ring's slot data, which identifies a ring
+// within one process, and the sequence number of the message, which is the same in the producer and the consumer:
+//
+//   xchg:message_send(ring, sequence, length)     message published by the producer
+//   xchg:message_receive(ring, sequence, length)  message handed to the consumer
+//   xchg:message_return(ring, sequence, length)   message given back by the consumer
+//   xchg:message_invalid(ring, sequence, error)   message rejected by length or checksum validation on receive
+//   xchg:ring_full(ring, sequence)                xchg_channel_prepare found no free slot
+//   xchg:ring_empty(ring, sequence)               xchg_channel_receive found no published message
+
+#if defined(XCHG_USDT)
+#define XCHG_PROBE2(name, a, b) DTRACE_PROBE2(xchg, name, a, b)
+#define XCHG_PROBE3(name, a, b, c) DTRACE_PROBE3(xchg, name, a, b, c)
+#else
+#define XCHG_PROBE2(name, a, b) do {} while(0)
+#define XCHG_PROBE3(name, a, b, c) do {} while(0)
+#endif
+
 static size_t flp2(size_t x)
 {
     size_t y = (size_t)1 << (size_t)63;
@@ -43,6 +79,49 @@ static uint8_t lsz_to_nr_bytes(uint8_t lsz)
     return (lsz == 0) ? 0 : (lsz == 1) ? 1 : (lsz == 2) ? 2 : 8;
 }
 
+static uint64_t sz_list_load(const char *data, uint8_t nr_bytes)
+{
+    uint8_t u8;
+    uint16_t u16;
+    uint64_t u64;
+
+    switch(nr_bytes)
+    {
+    case 1:
+        memcpy(&u8, data, sizeof(u8));
+        return u8;
+    case 2:
+        memcpy(&u16, data, sizeof(u16));
+        return u16;
+    case 8:
+        memcpy(&u64, data, sizeof(u64));
+        return u64;
+    default:
+        return 0;
+    }
+}
+
+static void sz_list_store(char *data, uint64_t sz_list, uint8_t nr_bytes)
+{
+    uint8_t u8 = (uint8_t)sz_list;
+    uint16_t u16 = (uint16_t)sz_list;
+
+    switch(nr_bytes)
+    {
+    case 1:
+        memcpy(data, &u8, sizeof(u8));
+        break;
+    case 2:
+        memcpy(data, &u16, sizeof(u16));
+        break;
+    case 8:
+        memcpy(data, &sz_list, sizeof(sz_list));
+        break;
+    default:
+        break;
+    }
+}
+
 struct __attribute__((packed, aligned(1))) xchg_tag
 {
     enum xchg_type type : 4;
@@ -51,6 +130,109 @@ struct __attribute__((packed, aligned(1))) xchg_tag
     bool null : 1;
 };
 
+static const uint32_t crc32c_table[256] = {
+    0x00000000, 0xF26B8303, 0xE13B70F7, 0x1350F3F4, 0xC79A971F, 0x35F1141C, 0x26A1E7E8, 0xD4CA64EB,
+    0x8AD958CF, 0x78B2DBCC, 0x6BE22838, 0x9989AB3B, 0x4D43CFD0, 0xBF284CD3, 0xAC78BF27, 0x5E133C24,
+    0x105EC76F, 0xE235446C, 0xF165B798, 0x030E349B, 0xD7C45070, 0x25AFD373, 0x36FF2087, 0xC494A384,
+    0x9A879FA0, 0x68EC1CA3, 0x7BBCEF57, 0x89D76C54, 0x5D1D08BF, 0xAF768BBC, 0xBC267848, 0x4E4DFB4B,
+    0x20BD8EDE, 0xD2D60DDD, 0xC186FE29, 0x33ED7D2A, 0xE72719C1, 0x154C9AC2, 0x061C6936, 0xF477EA35,
+    0xAA64D611, 0x580F5512, 0x4B5FA6E6, 0xB93425E5, 0x6DFE410E, 0x9F95C20D, 0x8CC531F9, 0x7EAEB2FA,
+    0x30E349B1, 0xC288CAB2, 0xD1D83946, 0x23B3BA45, 0xF779DEAE, 0x05125DAD, 0x1642AE59, 0xE4292D5A,
+    0xBA3A117E, 0x4851927D, 0x5B016189, 0xA96AE28A, 0x7DA08661, 0x8FCB0562, 0x9C9BF696, 0x6EF07595,
+    0x417B1DBC, 0xB3109EBF, 0xA0406D4B, 0x522BEE48, 0x86E18AA3, 0x748A09A0, 0x67DAFA54, 0x95B17957,
+    0xCBA24573, 0x39C9C670, 0x2A993584, 0xD8F2B687, 0x0C38D26C, 0xFE53516F, 0xED03A29B, 0x1F682198,
+    0x5125DAD3, 0xA34E59D0, 0xB01EAA24, 0x42752927, 0x96BF4DCC, 0x64D4CECF, 0x77843D3B, 0x85EFBE38,
+    0xDBFC821C, 0x2997011F, 0x3AC7F2EB, 0xC8AC71E8, 0x1C661503, 0xEE0D9600, 0xFD5D65F4, 0x0F36E6F7,
+    0x61C69362, 0x93AD1061, 0x80FDE395, 0x72966096, 0xA65C047D, 0x5437877E, 0x4767748A, 0xB50CF789,
+    0xEB1FCBAD, 0x197448AE, 0x0A24BB5A, 0xF84F3859, 0x2C855CB2, 0xDEEEDFB1, 0xCDBE2C45, 0x3FD5AF46,
+    0x7198540D, 0x83F3D70E, 0x90A324FA, 0x62C8A7F9, 0xB602C312, 0x44694011, 0x5739B3E5, 0xA55230E6,
+    0xFB410CC2, 0x092A8FC1, 0x1A7A7C35, 0xE811FF36, 0x3CDB9BDD, 0xCEB018DE, 0xDDE0EB2A, 0x2F8B6829,
+    0x82F63B78, 0x709DB87B, 0x63CD4B8F, 0x91A6C88C, 0x456CAC67, 0xB7072F64, 0xA457DC90, 0x563C5F93,
+    0x082F63B7, 0xFA44E0B4, 0xE9141340, 0x1B7F9043, 0xCFB5F4A8, 0x3DDE77AB, 0x2E8E845F, 0xDCE5075C,
+    0x92A8FC17, 0x60C37F14, 0x73938CE0, 0x81F80FE3, 0x55326B08, 0xA759E80B, 0xB4091BFF, 0x466298FC,
+    0x1871A4D8, 0xEA1A27DB, 0xF94AD42F, 0x0B21572C, 0xDFEB33C7, 0x2D80B0C4, 0x3ED04330, 0xCCBBC033,
+    0xA24BB5A6, 0x502036A5, 0x4370C551, 0xB11B4652, 0x65D122B9, 0x97BAA1BA, 0x84EA524E, 0x7681D14D,
+    0x2892ED69, 0xDAF96E6A, 0xC9A99D9E, 0x3BC21E9D, 0xEF087A76, 0x1D63F975, 0x0E330A81, 0xFC588982,
+    0xB21572C9, 0x407EF1CA, 0x532E023E, 0xA145813D, 0x758FE5D6, 0x87E466D5, 0x94B49521, 0x66DF1622,
+    0x38CC2A06, 0xCAA7A905, 0xD9F75AF1, 0x2B9CD9F2, 0xFF56BD19, 0x0D3D3E1A, 0x1E6DCDEE, 0xEC064EED,
+    0xC38D26C4, 0x31E6A5C7, 0x22B65633, 0xD0DDD530, 0x0417B1DB, 0xF67C32D8, 0xE52CC12C, 0x1747422F,
+    0x49547E0B, 0xBB3FFD08, 0xA86F0EFC, 0x5A048DFF, 0x8ECEE914, 0x7CA56A17, 0x6FF599E3, 0x9D9E1AE0,
+    0xD3D3E1AB, 0x21B862A8, 0x32E8915C, 0xC083125F, 0x144976B4, 0xE622F5B7, 0xF5720643, 0x07198540,
+    0x590AB964, 0xAB613A67, 0xB831C993, 0x4A5A4A90, 0x9E902E7B, 0x6CFBAD78, 0x7FAB5E8C, 0x8DC0DD8F,
+    0xE330A81A, 0x115B2B19, 0x020BD8ED, 0xF0605BEE, 0x24AA3F05, 0xD6C1BC06, 0xC5914FF2, 0x37FACCF1,
+    0x69E9F0D5, 0x9B8273D6, 0x88D28022, 0x7AB90321, 0xAE7367CA, 0x5C18E4C9, 0x4F48173D, 0xBD23943E,
+    0xF36E6F75, 0x0105EC76, 0x12551F82, 0xE03E9C81, 0x34F4F86A, 0xC69F7B69, 0xD5CF889D, 0x27A40B9E,
+    0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E, 0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351,
+};
+
+static uint32_t crc32c_sw(uint32_t crc, const char *data, size_t sz_data)
+{
+    for(size_t i = 0; i < sz_data; i++)
+    {
+        crc = crc32c_table[(crc ^ (uint8_t)data[i]) & 0xFFu] ^ (crc >> 8u);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2"))) static uint32_t crc32c_hw(uint32_t crc, const char *data, size_t sz_data)
+{
+    uint64_t crc64 = crc;
+    while(sz_data >= sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(uint64_t));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += sizeof(uint64_t);
+        sz_data -= sizeof(uint64_t);
+    }
+    crc = (uint32_t)crc64;
+    while(sz_data > 0)
+    {
+        crc = _mm_crc32_u8(crc, (uint8_t)*data);
+        data += 1;
+        sz_data -= 1;
+    }
+    return crc;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+static uint32_t crc32c_hw(uint32_t crc, const char *data, size_t sz_data)
+{
+    while(sz_data >= sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(uint64_t));
+        crc = __crc32cd(crc, word);
+        data += sizeof(uint64_t);
+        sz_data -= sizeof(uint64_t);
+    }
+    while(sz_data > 0)
+    {
+        crc = __crc32cb(crc, (uint8_t)*data);
+        data += 1;
+        sz_data -= 1;
+    }
+    return crc;
+}
+
+#endif
+
+static uint32_t crc32c(const char *data, size_t sz_data)
+{
+#if defined(__x86_64__)
+    if(likely(__builtin_cpu_supports("sse4.2")))
+    {
+        return ~crc32c_hw(~0u, data, sz_data);
+    }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    return ~crc32c_hw(~0u, data, sz_data);
+#endif
+    return ~crc32c_sw(~0u, data, sz_data);
+}
+
 struct xchg_value
 {
     enum xchg_type type;
@@ -61,6 +243,44 @@ struct xchg_value
     size_t sz_data;
 };
 
+// copies large values with non-temporal stores, which must be ordered by an sfence before the message is published
+
+static void stream_copy(char *destination, const char *source, size_t sz)
+{
+#if defined(__x86_64__)
+    size_t head = (16u - ((uintptr_t)destination & 15u)) & 15u;
+
+    if(head > sz)
+    {
+        head = sz;
+    }
+
+    memcpy(destination, source, head);
+    destination += head;
+    source += head;
+    sz -= head;
+
+    for(; sz >= 64; sz -= 64, destination += 64, source += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(source + 0));
+        __m128i b = _mm_loadu_si128((const __m128i *)(source + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(source + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(source + 48));
+        _mm_stream_si128((__m128i *)(destination + 0), a);
+        _mm_stream_si128((__m128i *)(destination + 16), b);
+        _mm_stream_si128((__m128i *)(destination + 32), c);
+        _mm_stream_si128((__m128i *)(destination + 48), d);
+    }
+
+    for(; sz >= 16; sz -= 16, destination += 16, source += 16)
+    {
+        _mm_stream_si128((__m128i *)destination, _mm_loadu_si128((const __m128i *)source));
+    }
+#endif
+
+    memcpy(destination, source, sz);
+}
+
 bool xchg_message_init(struct xchg_message *message, char *data, size_t sz_data)
 {
     if(unlikely(message == NULL || data == NULL || sz_data == 0))
@@ -71,6 +291,7 @@ bool xchg_message_init(struct xchg_message *message, char *data, size_t sz_data)
     message->data = data;
     message->length = sz_data;
     message->position = 0;
+    message->streaming = 0;
     message->error = NULL;
 
     return true;
@@ -152,7 +373,7 @@ bool xchg_message_peek(struct xchg_message *message, enum xchg_type *type, bool
             return false;
         }
 
-        memcpy(&_sz_list, &((uint8_t *)message->data)[position], nr_bytes);
+        _sz_list = sz_list_load(&message->data[position], nr_bytes);
         position += nr_bytes;
     }
 
@@ -272,7 +493,7 @@ bool xchg_message_read(struct xchg_message *message, struct xchg_value *value)
             return false;
         }
 
-        memcpy(&sz_list, &((uint8_t *)message->data)[position], nr_bytes);
+        sz_list = sz_list_load(&message->data[position], nr_bytes);
         position += nr_bytes;
     }
 
@@ -566,11 +787,18 @@ bool xchg_message_write(struct xchg_message *message, const struct xchg_value *v
 
     if(nr_bytes > 0)
     {
-        memcpy(&((uint8_t *)message->data)[message->position], (uint8_t *)&value->sz_list, nr_bytes);
+        sz_list_store(&message->data[message->position], value->sz_list, nr_bytes);
         message->position += nr_bytes;
     }
 
-    memcpy(&((uint8_t *)message->data)[message->position], (uint8_t *)value->data, sz_data);
+    if(message->streaming != 0 && sz_data >= message->streaming)
+    {
+        stream_copy(&message->data[message->position], value->data, sz_data);
+    }
+    else
+    {
+        memcpy(&((uint8_t *)message->data)[message->position], (uint8_t *)value->data, sz_data);
+    }
     message->position += sz_data;
 
     message->error = NULL;
@@ -662,236 +890,3988 @@ XCHG_MESSAGE_WRITE_HELPERS(float64, double_t)
 
 #undef XCHG_MESSAGE_WRITE_HELPERS
 
-static size_t nr_used(struct xchg_ring *ring, size_t wanted)
+#define XCHG_BYTE_ORDER_NATIVE ((uint16_t)0xFEFFu)
+#define XCHG_BYTE_ORDER_FOREIGN ((uint16_t)0xFFFEu)
+
+static size_t type_to_sz_value(enum xchg_type type)
 {
-    if(unlikely(ring == NULL))
+    switch(type)
     {
-        return false;
+    case xchg_type_bool:
+        return sizeof(bool);
+    case xchg_type_int8:
+        return sizeof(int8_t);
+    case xchg_type_uint8:
+        return sizeof(uint8_t);
+    case xchg_type_int16:
+        return sizeof(int16_t);
+    case xchg_type_uint16:
+        return sizeof(uint16_t);
+    case xchg_type_int32:
+        return sizeof(int32_t);
+    case xchg_type_uint32:
+        return sizeof(uint32_t);
+    case xchg_type_int64:
+        return sizeof(int64_t);
+    case xchg_type_uint64:
+        return sizeof(uint64_t);
+    case xchg_type_float32:
+        return sizeof(float_t);
+    case xchg_type_float64:
+        return sizeof(double_t);
+    default:
+        return 0;
     }
+}
 
-    size_t used = ring->cw - ring->cr;
+static uint8_t tag_from_foreign(uint8_t byte)
+{
+    // compilers allocate bit-fields starting from the least significant bit on little-endian targets and from the
+    // most significant bit on big-endian targets, so the fields of a foreign tag must be repacked
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return (uint8_t)((byte >> 4u) | (((byte >> 2u) & 0x3u) << 4u) | (((byte >> 1u) & 0x1u) << 6u) | ((byte & 0x1u) << 7u));
+#else
+    return (uint8_t)(((byte & 0xFu) << 4u) | (((byte >> 4u) & 0x3u) << 2u) | (((byte >> 6u) & 0x1u) << 1u) | (byte >> 7u));
+#endif
+}
 
-    if(used < wanted)
+static void bswap_values_sw(char *data, size_t nr_values, size_t sz_value)
+{
+    for(size_t i = 0; i < nr_values; i++, data += sz_value)
     {
-        ring->cw = *ring->w;
-        used = ring->cw - ring->cr;
+        if(sz_value == sizeof(uint16_t))
+        {
+            uint16_t v;
+            memcpy(&v, data, sizeof(v));
+            v = __builtin_bswap16(v);
+            memcpy(data, &v, sizeof(v));
+        }
+        else if(sz_value == sizeof(uint32_t))
+        {
+            uint32_t v;
+            memcpy(&v, data, sizeof(v));
+            v = __builtin_bswap32(v);
+            memcpy(data, &v, sizeof(v));
+        }
+        else if(sz_value == sizeof(uint64_t))
+        {
+            uint64_t v;
+            memcpy(&v, data, sizeof(v));
+            v = __builtin_bswap64(v);
+            memcpy(data, &v, sizeof(v));
+        }
+        else
+        {
+            for(size_t lo = 0, hi = sz_value - 1; lo < hi; lo++, hi--)
+            {
+                char c = data[lo];
+                data[lo] = data[hi];
+                data[hi] = c;
+            }
+        }
     }
-
-    return used;
 }
 
-static size_t nr_free(struct xchg_ring *ring, size_t wanted)
+#if defined(__x86_64__)
+
+__attribute__((target("ssse3"))) static size_t bswap_values_hw(char *data, size_t nr_values, size_t sz_value)
 {
-    if(unlikely(ring == NULL))
+    __m128i shuffle;
+
+    switch(sz_value)
     {
-        return false;
+    case sizeof(uint16_t):
+        shuffle = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        break;
+    case sizeof(uint32_t):
+        shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        break;
+    case sizeof(uint64_t):
+        shuffle = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        break;
+    default:
+        return 0;
     }
 
-    size_t free = ring->cr - ring->cw;
+    size_t nr_per_vector = sizeof(__m128i) / sz_value;
+    size_t nr_swapped = 0;
 
-    if(free < wanted)
+    for(; nr_values - nr_swapped >= nr_per_vector; nr_swapped += nr_per_vector, data += sizeof(__m128i))
     {
-        ring->cr = *ring->r + ring->sz_data;
-        free = ring->cr - ring->cw;
+        __m128i v = _mm_loadu_si128((const __m128i *)data);
+        _mm_storeu_si128((__m128i *)data, _mm_shuffle_epi8(v, shuffle));
     }
 
-    return free;
+    return nr_swapped;
 }
 
-bool xchg_channel_init(struct xchg_channel *channel,
-                       size_t sz_message,
-                       char *ingress, size_t sz_ingress,
-                       char *egress, size_t sz_egress)
+#endif
+
+static void bswap_values(char *data, size_t nr_values, size_t sz_value)
 {
-    if(unlikely(channel == NULL || (ingress == NULL && egress == NULL)))
+    if(sz_value <= 1)
     {
-        return false;
+        return;
     }
 
-    if(flp2(sz_message) != sz_message)
+#if defined(__x86_64__)
+    if(likely(__builtin_cpu_supports("ssse3")))
     {
-        channel->error = "message size is invalid";
-        return false;
+        size_t nr_swapped = bswap_values_hw(data, nr_values, sz_value);
+        data += nr_swapped * sz_value;
+        nr_values -= nr_swapped;
     }
+#endif
 
-    size_t sz_ingress_data = sz_ingress - sizeof(size_t) - sizeof(size_t);
+    bswap_values_sw(data, nr_values, sz_value);
+}
 
-    if(ingress != NULL && (flp2(sz_ingress_data) != sz_ingress_data || sz_ingress_data % sz_message != 0))
+bool xchg_message_write_byte_order(struct xchg_message *message)
+{
+    if(unlikely(message == NULL))
     {
-        channel->error = "ingress size is invalid";
         return false;
     }
 
-    size_t sz_egress_data = sz_egress - sizeof(size_t) - sizeof(size_t);
+    uint16_t marker = XCHG_BYTE_ORDER_NATIVE;
 
-    if(egress != NULL && (flp2(sz_egress_data) != sz_egress_data || sz_egress_data % sz_message != 0))
+    if(unlikely((message->position + sizeof(marker)) > message->length))
     {
-        channel->error = "egress size is invalid";
+        message->error = "the message is not large enough to write the specified value";
         return false;
     }
 
-    if(ingress != NULL)
-    {
-        struct xchg_ring *ring = &channel->ingress;
-
-        ring->r = (volatile size_t *)(ingress + (sizeof(size_t) * 0));
-        ring->cr = *ring->r;
-        ring->w = (volatile size_t *)(ingress + (sizeof(size_t) * 1));
-        ring->cw = *ring->w;
-        ring->data = ingress + (sizeof(size_t) * 2);
-        ring->sz_data = sz_ingress_data;
-        ring->sz_message = sz_message;
-        ring->mask = sz_ingress_data - 1;
-    }
-
-    if(egress != NULL)
-    {
-        struct xchg_ring *ring = &channel->egress;
-
-        ring->r = (volatile size_t *)(egress + (sizeof(size_t) * 0));
-        ring->cr = *ring->r;
-        ring->w = (volatile size_t *)(egress + (sizeof(size_t) * 1));
-        ring->cw = *ring->w;
-        ring->data = egress + (sizeof(size_t) * 2);
-        ring->sz_data = sz_egress_data;
-        ring->sz_message = sz_message;
-        ring->mask = sz_egress_data - 1;
-    }
+    memcpy(&message->data[message->position], &marker, sizeof(marker));
+    message->position += sizeof(marker);
 
-    channel->error = NULL;
+    message->error = NULL;
     return true;
 }
 
-bool xchg_channel_prepare(struct xchg_channel *channel, struct xchg_message *message)
+bool xchg_message_read_byte_order(struct xchg_message *message)
 {
-    if(unlikely(channel == NULL || message == NULL))
+    if(unlikely(message == NULL))
     {
         return false;
     }
 
-    struct xchg_ring *ring = &channel->egress;
+    uint16_t marker = 0;
 
-    if(unlikely(ring->data == NULL))
+    if(unlikely((message->position + sizeof(marker)) > message->length))
     {
-        channel->error = "channel has no egress";
+        message->error = "the message has no more data left to read";
         return false;
     }
 
-    if(unlikely(nr_free(ring, ring->sz_message) < ring->sz_message))
+    memcpy(&marker, &message->data[message->position], sizeof(marker));
+
+    if(likely(marker == XCHG_BYTE_ORDER_NATIVE))
     {
-        channel->error = "channel is full";
-        return false;
+        message->position += sizeof(marker);
+        message->error = NULL;
+        return true;
     }
 
-    size_t data_offset = ring->cw & ring->mask;
-    char *data = ring->data + data_offset;
-
-    xchg_message_init(message, data, ring->sz_message);
-
-    channel->error = NULL;
-    return true;
-}
-
-bool xchg_channel_send(struct xchg_channel *channel, const struct xchg_message *message)
-{
-    if(unlikely(channel == NULL || message == NULL))
+    if(unlikely(marker != XCHG_BYTE_ORDER_FOREIGN))
     {
+        message->error = "the message has no byte order marker";
         return false;
     }
 
-    struct xchg_ring *ring = &channel->egress;
+    // convert every value following the marker to native byte order in place, stopping at the first byte which
+    // does not begin a complete value (normally the unwritten remainder of the message)
 
-    if(unlikely(ring->data == NULL))
+    size_t position = message->position + sizeof(marker);
+
+    while(position + sizeof(struct xchg_tag) <= message->length)
     {
-        channel->error = "channel has no egress";
-        return false;
-    }
+        uint8_t byte = tag_from_foreign((uint8_t)message->data[position]);
 
-    size_t data_offset = ring->cw & ring->mask;
-    char *data = ring->data + data_offset;
+        struct xchg_tag tag;
+        memcpy(&tag, &byte, sizeof(struct xchg_tag));
 
-    if(unlikely(message->length != ring->sz_message || data != message->data))
-    {
-        channel->error = "message is invalid";
-        return false;
-    }
+        size_t sz_value = type_to_sz_value(tag.type);
 
-    ring->cw += ring->sz_message;
-    atomic_thread_fence(memory_order_release);
-    *ring->w += ring->sz_message;
+        if(sz_value == 0)
+        {
+            break;
+        }
 
-    channel->error = NULL;
-    return true;
-}
+        uint8_t nr_bytes = (!tag.null && tag.list) ? lsz_to_nr_bytes(tag.lsz) : 0;
+        size_t sz_list = 0;
 
-bool xchg_channel_receive(struct xchg_channel *channel, struct xchg_message *message)
-{
-    if(unlikely(channel == NULL || message == NULL))
-    {
-        return false;
-    }
+        if(position + sizeof(struct xchg_tag) + nr_bytes > message->length)
+        {
+            break;
+        }
 
-    struct xchg_ring *ring = &channel->ingress;
+        if(nr_bytes > 0)
+        {
+            bswap_values(&message->data[position + sizeof(struct xchg_tag)], 1, nr_bytes);
+            sz_list = sz_list_load(&message->data[position + sizeof(struct xchg_tag)], nr_bytes);
+        }
 
-    if(unlikely(ring->data == NULL))
-    {
-        channel->error = "channel has no ingress";
-        return false;
-    }
+        size_t nr_values = tag.null ? 0 : tag.list ? sz_list : 1;
 
-    if(unlikely(nr_used(ring, ring->sz_message) < ring->sz_message))
-    {
-        channel->error = "channel is empty";
-        return false;
-    }
+        // the list length comes from the foreign message, so it is bounded by the remaining space before being
+        // multiplied, which would otherwise wrap and let the swap below run past the end of the message
 
-    size_t data_offset = ring->cr & ring->mask;
-    char *data = ring->data + data_offset;
+        if(nr_values > (message->length - position - sizeof(struct xchg_tag) - nr_bytes) / sz_value)
+        {
+            if(nr_bytes > 0)
+            {
+                bswap_values(&message->data[position + sizeof(struct xchg_tag)], 1, nr_bytes);
+            }
+            break;
+        }
 
-    xchg_message_init(message, data, ring->sz_message);
+        size_t sz_data = nr_values * sz_value;
 
-    channel->error = NULL;
+        message->data[position] = (char)byte;
+        position += sizeof(struct xchg_tag) + nr_bytes;
+
+        bswap_values(&message->data[position], nr_values, sz_value);
+        position += sz_data;
+    }
+
+    marker = XCHG_BYTE_ORDER_NATIVE;
+    memcpy(&message->data[message->position], &marker, sizeof(marker));
+    message->position += sizeof(marker);
+
+    message->error = NULL;
     return true;
 }
 
-bool xchg_channel_return(struct xchg_channel *channel, const struct xchg_message *message)
+static size_t nr_used(struct xchg_ring *ring, size_t wanted)
 {
-    if(unlikely(channel == NULL || message == NULL))
+    if(unlikely(ring == NULL))
     {
         return false;
     }
 
-    struct xchg_ring *ring = &channel->ingress;
+    size_t used = ring->cw - ring->cr;
 
-    if(unlikely(ring->data == NULL))
+    if(used < wanted)
     {
-        channel->error = "channel has no ingress";
-        return false;
+        ring->cw = *ring->w;
+        used = ring->cw - ring->cr;
     }
 
-    size_t data_offset = ring->cr & ring->mask;
-    char *data = ring->data + data_offset;
+    return used;
+}
 
-    if(unlikely(message->length != ring->sz_message || data != message->data))
+static size_t nr_free(struct xchg_ring *ring, size_t wanted)
+{
+    if(unlikely(ring == NULL))
     {
-        channel->error = "message is invalid";
         return false;
     }
 
-    ring->cr += ring->sz_message;
-    atomic_thread_fence(memory_order_acquire);
-    *ring->r += ring->sz_message;
+    size_t free = ring->cr - ring->cw;
 
-    channel->error = NULL;
-    return true;
+    if(free < wanted)
+    {
+        ring->cr = *ring->r + ring->sz_data;
+        free = ring->cr - ring->cw;
+    }
+
+    return free;
 }
 
-const char *xchg_channel_strerror(const struct xchg_channel *channel)
+// shared ring header used by channels configured with xchg_channel_flag_liveness, where the consumer-owned and
+// producer-owned fields are kept in separate cache lines. The statistics counters share those lines, which each end
+// already holds exclusively, and were carved out of padding that earlier headers always left zeroed
+
+struct xchg_ring_shared
 {
-    if(unlikely(channel == NULL))
-    {
-        return false;
-    }
+    size_t r;
+    uint64_t consumer_pid;
+    uint64_t consumer_heartbeat;
+    uint64_t nr_received;
+    uint64_t sz_received;
+    uint64_t nr_empty;
+    char consumer_padding[64 - (sizeof(size_t) + (5 * sizeof(uint64_t)))];
+    size_t w;
+    uint64_t producer_pid;
+    uint64_t producer_heartbeat;
+    uint64_t nr_sent;
+    uint64_t sz_sent;
+    uint64_t nr_full;
+    uint64_t nr_high_water;
+    char producer_padding[64 - (sizeof(size_t) + (6 * sizeof(uint64_t)))];
+    uint64_t generation;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t sz_message;
+    uint64_t sz_data;
+};
 
-    return channel->error;
+#define XCHG_RING_MAGIC 0x47484358u  // "XCHG"
+
+// flags which change the layout of ring slots, and so must match between the creator and every attaching peer
+
+#define XCHG_RING_LAYOUT_FLAGS (xchg_channel_flag_checksum | xchg_channel_flag_header | xchg_channel_flag_length | \
+                                xchg_channel_flag_liveness | xchg_channel_flag_any_size | xchg_channel_flag_statistics)
+
+static_assert(sizeof(struct xchg_ring_shared) <= XCHG_RING_HEADER_SIZE, "ring header is too large");
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+// number of bytes at the start of each ring slot which hold the message length, checksum and header, if any
+
+static size_t slot_header_size(uint32_t flags)
+{
+    return (flags & xchg_channel_flag_header) ? sizeof(struct xchg_header)
+         : (flags & (xchg_channel_flag_checksum | xchg_channel_flag_length)) ? offsetof(struct xchg_header, type)
+         : 0;
+}
+
+static bool process_alive(uint64_t pid)
+{
+    return pid != 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+// each statistics counter has a single writer, so it is advanced with a plain load and an untorn store rather than
+// a locked read-modify-write
+
+static inline void statistic_add(uint64_t *counter, uint64_t value)
+{
+    atomic_store_explicit((_Atomic uint64_t *)counter, *counter + value, memory_order_relaxed);
+}
+
+// cheapest available timestamp for sampled intervals, which is not serializing and so may be reordered by a few
+// instructions; sampled intervals span a whole caller's message construction, so this is well within their noise
+
+static inline uint64_t ticks(void)
+{
+#if defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return monotonic_ns();
+#endif
+}
+
+static void sampler_record(struct xchg_sampler *sampler, enum xchg_sample_kind kind, uint64_t interval)
+{
+    size_t w = sampler->w;
+
+    if(w - atomic_load_explicit((_Atomic size_t *)&sampler->r, memory_order_acquire) > sampler->mask)
+    {
+        statistic_add(&sampler->nr_dropped, 1);
+        return;
+    }
+
+    struct xchg_sample *sample = &sampler->samples[w & sampler->mask];
+    sample->ticks = interval;
+    sample->kind = (uint32_t)kind;
+    sample->reserved = 0;
+
+    atomic_store_explicit((_Atomic size_t *)&sampler->w, w + 1, memory_order_release);
+}
+
+static inline void ring_sample_start(struct xchg_channel *channel, struct xchg_ring *ring)
+{
+    if(channel->sampler != NULL && --ring->sample_countdown == 0)
+    {
+        ring->sample_countdown = channel->sample_period;
+        ring->sample_start = ticks();
+    }
+}
+
+static inline void ring_sample_end(struct xchg_channel *channel, struct xchg_ring *ring, enum xchg_sample_kind kind)
+{
+    if(ring->sample_start != 0)
+    {
+        sampler_record(channel->sampler, kind, ticks() - ring->sample_start);
+        ring->sample_start = 0;
+    }
+}
+
+// rings whose sizes are not powers of two have a zero mask, and instead track the offset of the next slot used by
+// their end of the ring, wrapping it with a compare as it advances
+
+static inline size_t ring_offset(const struct xchg_ring *ring, size_t position)
+{
+    return likely(ring->mask != 0) ? position & ring->mask : ring->offset;
+}
+
+static inline void ring_advance(struct xchg_ring *ring)
+{
+    if(ring->mask == 0)
+    {
+        ring->offset += ring->sz_message;
+        if(ring->offset == ring->sz_data)
+        {
+            ring->offset = 0;
+        }
+    }
+}
+
+static inline char *ring_slot_ahead(const struct xchg_ring *ring, size_t position, size_t distance)
+{
+    size_t offset;
+
+    if(likely(ring->mask != 0))
+    {
+        offset = (position + distance) & ring->mask;
+    }
+    else
+    {
+        offset = ring->offset + distance;
+        if(offset >= ring->sz_data)
+        {
+            offset -= ring->sz_data;
+        }
+    }
+
+    return ring->data + offset;
+}
+
+static void ring_init(struct xchg_ring *ring, char *buffer, size_t sz_data, size_t sz_message, size_t sz_header,
+                      bool liveness, bool any_size, bool producer)
+{
+    if(liveness)
+    {
+        ring->shared = (struct xchg_ring_shared *)buffer;
+        ring->r = &ring->shared->r;
+        ring->w = &ring->shared->w;
+        ring->data = buffer + XCHG_RING_HEADER_SIZE;
+    }
+    else
+    {
+        ring->shared = NULL;
+        ring->r = (volatile size_t *)(buffer + (sizeof(size_t) * 0));
+        ring->w = (volatile size_t *)(buffer + (sizeof(size_t) * 1));
+        ring->data = buffer + (sizeof(size_t) * 2);
+    }
+
+    // a producer caches the read position one ring ahead, as the limit up to which it may write
+
+    ring->cr = producer ? *ring->r + sz_data : *ring->r;
+    ring->cw = *ring->w;
+    ring->sz_data = sz_data;
+    ring->sz_message = sz_message;
+    ring->sz_header = sz_header;
+    ring->mask = any_size ? 0 : sz_data - 1;
+    ring->offset = (producer ? ring->cw : ring->cr) % sz_data;
+    ring->prefetch = 0;
+    ring->batch = 1;
+    ring->nr_unpublished = 0;
+    ring->streaming = 0;
+    ring->sequence = ring->cw / sz_message;
+    ring->sample_start = 0;
+    ring->sample_countdown = 0;
+    ring->held = false;
+}
+
+static void ring_create(char *buffer, uint32_t flags, size_t sz_message, size_t sz_data)
+{
+    struct xchg_ring_shared *shared = (struct xchg_ring_shared *)buffer;
+
+    atomic_store((_Atomic uint32_t *)&shared->magic, 0);
+    memset(buffer, 0, XCHG_RING_HEADER_SIZE);
+
+    shared->version = XCHG_RING_VERSION;
+    shared->flags = flags & XCHG_RING_LAYOUT_FLAGS;
+    shared->sz_message = sz_message;
+    shared->sz_data = sz_data;
+
+    // the magic is published last, so a peer that sees it also sees a complete header
+
+    atomic_store_explicit((_Atomic uint32_t *)&shared->magic, XCHG_RING_MAGIC, memory_order_release);
+}
+
+static char *ring_validate(const char *buffer, size_t sz_buffer, uint32_t *flags, size_t *sz_message)
+{
+    struct xchg_ring_shared *shared = (struct xchg_ring_shared *)buffer;
+
+    if(sz_buffer <= XCHG_RING_HEADER_SIZE)
+    {
+        return "ring header is missing";
+    }
+
+    if(atomic_load_explicit((_Atomic uint32_t *)&shared->magic, memory_order_acquire) != XCHG_RING_MAGIC)
+    {
+        return "ring header is missing";
+    }
+
+    if(shared->version != XCHG_RING_VERSION)
+    {
+        return "ring header version is unsupported";
+    }
+
+    if(shared->sz_data != sz_buffer - XCHG_RING_HEADER_SIZE)
+    {
+        return "ring size does not match ring header";
+    }
+
+    if(*sz_message != 0 && (shared->sz_message != *sz_message || shared->flags != *flags))
+    {
+        return "ring geometry does not match ring header";
+    }
+
+    *flags = shared->flags;
+    *sz_message = shared->sz_message;
+    return NULL;
+}
+
+static void ring_attach(struct xchg_ring *ring)
+{
+    // every attach advances the generation, which tells a peer that is recovering from a crash that a replacement
+    // has already taken over; this happens after the heartbeat so the new process id is visible first
+
+    ring->generation = atomic_fetch_add((_Atomic uint64_t *)&ring->shared->generation, 1) + 1;
+}
+
+static void ring_heartbeat(struct xchg_ring *ring, bool producer)
+{
+    uint64_t pid = (uint64_t)getpid();
+    uint64_t now = monotonic_ns();
+
+    if(producer)
+    {
+        atomic_store_explicit((_Atomic uint64_t *)&ring->shared->producer_pid, pid, memory_order_relaxed);
+        atomic_store_explicit((_Atomic uint64_t *)&ring->shared->producer_heartbeat, now, memory_order_relaxed);
+    }
+    else
+    {
+        atomic_store_explicit((_Atomic uint64_t *)&ring->shared->consumer_pid, pid, memory_order_relaxed);
+        atomic_store_explicit((_Atomic uint64_t *)&ring->shared->consumer_heartbeat, now, memory_order_relaxed);
+    }
+}
+
+static char *ring_peer_check(struct xchg_ring *ring, bool producer, uint64_t timeout_ns)
+{
+    uint64_t generation = atomic_load((_Atomic uint64_t *)&ring->shared->generation);
+    uint64_t *pid = producer ? &ring->shared->consumer_pid : &ring->shared->producer_pid;
+    uint64_t *heartbeat = producer ? &ring->shared->consumer_heartbeat : &ring->shared->producer_heartbeat;
+
+    uint64_t peer_pid = atomic_load_explicit((_Atomic uint64_t *)pid, memory_order_relaxed);
+    uint64_t peer_heartbeat = atomic_load_explicit((_Atomic uint64_t *)heartbeat, memory_order_relaxed);
+
+    // a later recovery only applies to the peer observed here, which is identified by this generation
+
+    ring->generation = generation;
+
+    if(peer_pid == 0)
+    {
+        return "peer has not attached";
+    }
+
+    if(!process_alive(peer_pid))
+    {
+        return "peer process has exited";
+    }
+
+    if(timeout_ns != 0 && monotonic_ns() - peer_heartbeat > timeout_ns)
+    {
+        return "peer heartbeat has expired";
+    }
+
+    return NULL;
+}
+
+static bool ring_claim(struct xchg_ring *ring)
+{
+    uint64_t expected = ring->generation;
+
+    if(!atomic_compare_exchange_strong((_Atomic uint64_t *)&ring->shared->generation, &expected, expected + 1))
+    {
+        return false;
+    }
+
+    ring->generation = expected + 1;
+    return true;
+}
+
+static void ring_unclaim(struct xchg_ring *ring)
+{
+    // a replacement which attached in the meantime has moved the generation on, in which case it is left alone
+
+    uint64_t claimed = ring->generation;
+
+    ring->generation = claimed - 1;
+    atomic_compare_exchange_strong((_Atomic uint64_t *)&ring->shared->generation, &claimed, ring->generation);
+}
+
+static void ring_recover(struct xchg_ring *ring, bool producer, bool discard)
+{
+    if(producer)
+    {
+        atomic_store((_Atomic uint64_t *)&ring->shared->consumer_pid, 0);
+        atomic_store((_Atomic uint64_t *)&ring->shared->consumer_heartbeat, 0);
+    }
+    else
+    {
+        atomic_store((_Atomic uint64_t *)&ring->shared->producer_pid, 0);
+        atomic_store((_Atomic uint64_t *)&ring->shared->producer_heartbeat, 0);
+    }
+
+    if(discard)
+    {
+        // with the peer gone this end owns both counters, so unread messages are dropped by moving the read
+        // counter up to the write counter
+
+        ring->cw = *ring->w;
+        atomic_thread_fence(memory_order_acquire);
+        *ring->r = ring->cw;
+        ring->cr = producer ? ring->cw + ring->sz_data : ring->cw;
+        ring->offset = ring->cw % ring->sz_data;
+        ring->nr_unpublished = 0;
+    }
+}
+
+bool xchg_channel_init(struct xchg_channel *channel,
+                       size_t sz_message,
+                       char *ingress, size_t sz_ingress,
+                       char *egress, size_t sz_egress)
+{
+    return xchg_channel_init_ex(channel, 0, sz_message, ingress, sz_ingress, egress, sz_egress);
+}
+
+static bool channel_init(struct xchg_channel *channel, uint32_t flags,
+                         size_t sz_message,
+                         char *ingress, size_t sz_ingress,
+                         char *egress, size_t sz_egress,
+                         bool create)
+{
+    if(unlikely(channel == NULL || (ingress == NULL && egress == NULL)))
+    {
+        return false;
+    }
+
+    if(flags & ~(uint32_t)XCHG_RING_LAYOUT_FLAGS)
+    {
+        channel->error = "channel flags are invalid";
+        return false;
+    }
+
+    bool any_size = (flags & xchg_channel_flag_any_size) != 0;
+
+    if(!any_size && flp2(sz_message) != sz_message)
+    {
+        channel->error = "message size is invalid";
+        return false;
+    }
+
+    size_t sz_header = slot_header_size(flags);
+
+    if(sz_message <= sz_header)
+    {
+        channel->error = "message size is too small for the requested channel flags";
+        return false;
+    }
+
+    bool liveness = (flags & xchg_channel_flag_liveness) != 0;
+
+    if((flags & xchg_channel_flag_statistics) && !liveness)
+    {
+        channel->error = "channel statistics require a ring header";
+        return false;
+    }
+    size_t sz_overhead = liveness ? XCHG_RING_HEADER_SIZE : sizeof(size_t) + sizeof(size_t);
+
+    size_t sz_ingress_data = sz_ingress - sz_overhead;
+
+    if(ingress != NULL && (sz_ingress <= sz_overhead || (!any_size && flp2(sz_ingress_data) != sz_ingress_data) ||
+                          sz_ingress_data % sz_message != 0))
+    {
+        channel->error = "ingress size is invalid";
+        return false;
+    }
+
+    size_t sz_egress_data = sz_egress - sz_overhead;
+
+    if(egress != NULL && (sz_egress <= sz_overhead || (!any_size && flp2(sz_egress_data) != sz_egress_data) ||
+                          sz_egress_data % sz_message != 0))
+    {
+        channel->error = "egress size is invalid";
+        return false;
+    }
+
+    if(create && ingress != NULL)
+    {
+        ring_create(ingress, flags, sz_message, sz_ingress_data);
+    }
+
+    if(create && egress != NULL)
+    {
+        ring_create(egress, flags, sz_message, sz_egress_data);
+    }
+
+    struct { char *buffer; size_t sz_buffer; } buffers[] = { { ingress, sz_ingress }, { egress, sz_egress } };
+
+    for(size_t i = 0; liveness && i < 2; i++)
+    {
+        const struct xchg_ring_shared *shared = (const struct xchg_ring_shared *)buffers[i].buffer;
+
+        if(shared == NULL || atomic_load((_Atomic uint32_t *)&shared->magic) != XCHG_RING_MAGIC)
+        {
+            continue;
+        }
+
+        uint32_t expected_flags = flags & XCHG_RING_LAYOUT_FLAGS;
+        size_t expected_sz_message = sz_message;
+        char *error = ring_validate(buffers[i].buffer, buffers[i].sz_buffer, &expected_flags, &expected_sz_message);
+
+        if(error != NULL)
+        {
+            channel->error = error;
+            return false;
+        }
+    }
+
+    if(ingress != NULL)
+    {
+        ring_init(&channel->ingress, ingress, sz_ingress_data, sz_message, sz_header, liveness, any_size, false);
+    }
+
+    if(egress != NULL)
+    {
+        ring_init(&channel->egress, egress, sz_egress_data, sz_message, sz_header, liveness, any_size, true);
+    }
+
+    channel->flags = flags;
+    channel->sampler = NULL;
+    channel->sample_period = 0;
+
+    if(liveness)
+    {
+        xchg_channel_heartbeat(channel);
+
+        if(ingress != NULL)
+        {
+            ring_attach(&channel->ingress);
+        }
+
+        if(egress != NULL)
+        {
+            ring_attach(&channel->egress);
+        }
+    }
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_init_ex(struct xchg_channel *channel, uint32_t flags,
+                          size_t sz_message,
+                          char *ingress, size_t sz_ingress,
+                          char *egress, size_t sz_egress)
+{
+    return channel_init(channel, flags, sz_message, ingress, sz_ingress, egress, sz_egress, false);
+}
+
+bool xchg_channel_create(struct xchg_channel *channel, uint32_t flags,
+                         size_t sz_message,
+                         char *ingress, size_t sz_ingress,
+                         char *egress, size_t sz_egress)
+{
+    return channel_init(channel, flags | xchg_channel_flag_liveness, sz_message, ingress, sz_ingress, egress, sz_egress,
+                        true);
+}
+
+bool xchg_channel_attach(struct xchg_channel *channel,
+                         char *ingress, size_t sz_ingress,
+                         char *egress, size_t sz_egress)
+{
+    if(unlikely(channel == NULL || (ingress == NULL && egress == NULL)))
+    {
+        return false;
+    }
+
+    uint32_t flags = 0;
+    size_t sz_message = 0;
+
+    if(ingress != NULL)
+    {
+        char *error = ring_validate(ingress, sz_ingress, &flags, &sz_message);
+
+        if(error != NULL)
+        {
+            channel->error = error;
+            return false;
+        }
+    }
+
+    if(egress != NULL)
+    {
+        char *error = ring_validate(egress, sz_egress, &flags, &sz_message);
+
+        if(error != NULL)
+        {
+            channel->error = error;
+            return false;
+        }
+    }
+
+    return xchg_channel_init_ex(channel, flags, sz_message, ingress, sz_ingress, egress, sz_egress);
+}
+
+bool xchg_channel_prepare(struct xchg_channel *channel, struct xchg_message *message)
+{
+    if(unlikely(channel == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->egress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no egress";
+        return false;
+    }
+
+    if(unlikely(nr_free(ring, ring->sz_message) < ring->sz_message))
+    {
+        if(channel->flags & xchg_channel_flag_statistics)
+        {
+            statistic_add(&ring->shared->nr_full, 1);
+        }
+
+        XCHG_PROBE2(ring_full, ring->data, ring->sequence);
+
+        channel->error = "channel is full";
+        return false;
+    }
+
+    size_t data_offset = ring_offset(ring, ring->cw);
+    char *data = ring->data + data_offset + ring->sz_header;
+
+    if(ring->prefetch != 0 && ring->cr - ring->cw > ring->prefetch)
+    {
+        __builtin_prefetch(ring_slot_ahead(ring, ring->cw, ring->prefetch), 1, 3);
+    }
+
+    xchg_message_init(message, data, ring->sz_message - ring->sz_header);
+    message->streaming = ring->streaming;
+    ring->held = true;
+
+    ring_sample_start(channel, ring);
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_send(struct xchg_channel *channel, const struct xchg_message *message)
+{
+    return xchg_channel_send_typed(channel, message, 0);
+}
+
+bool xchg_channel_send_typed(struct xchg_channel *channel, const struct xchg_message *message, uint32_t type)
+{
+    if(unlikely(channel == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->egress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no egress";
+        return false;
+    }
+
+    size_t data_offset = ring_offset(ring, ring->cw);
+    char *data = ring->data + data_offset + ring->sz_header;
+
+    if(unlikely(message->length != ring->sz_message - ring->sz_header || data != message->data))
+    {
+        channel->error = "message is invalid";
+        return false;
+    }
+
+    if(ring->sz_header > 0)
+    {
+        struct xchg_header header = {
+            .length = (uint32_t)message->position,
+            .checksum = (channel->flags & xchg_channel_flag_checksum) ? crc32c(message->data, message->position) : 0,
+            .type = type,
+            .sequence = ring->sequence,
+        };
+        memcpy(ring->data + data_offset, &header, ring->sz_header);
+    }
+
+    XCHG_PROBE3(message_send, ring->data, ring->sequence, message->position);
+
+    ring->sequence += 1;
+    ring->cw += ring->sz_message;
+    ring->held = false;
+    ring_advance(ring);
+#if defined(__x86_64__)
+    if(message->streaming != 0)
+    {
+        _mm_sfence();
+    }
+#endif
+    atomic_thread_fence(memory_order_release);
+    *ring->w += ring->sz_message;
+
+    if(channel->flags & xchg_channel_flag_statistics)
+    {
+        statistic_add(&ring->shared->nr_sent, 1);
+        statistic_add(&ring->shared->sz_sent, message->position);
+
+        // the cached read limit can trail the consumer by a whole lap, so it only bounds the occupancy; the read
+        // position itself is only loaded once that bound passes the mark
+
+        uint64_t nr_pending = (ring->cw - (ring->cr - ring->sz_data)) / ring->sz_message;
+
+        if(nr_pending > ring->shared->nr_high_water)
+        {
+            size_t r = atomic_load_explicit((_Atomic size_t *)ring->r, memory_order_relaxed);
+            nr_pending = (ring->cw - r) / ring->sz_message;
+
+            if(nr_pending > ring->shared->nr_high_water)
+            {
+                atomic_store_explicit((_Atomic uint64_t *)&ring->shared->nr_high_water, nr_pending,
+                                      memory_order_relaxed);
+            }
+        }
+    }
+
+    if(channel->notify != NULL)
+    {
+        // the consumer clears its readiness bit before re-checking the ring, so the new write counter must be
+        // visible before the bit is tested here or the notification could be lost
+
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if((*channel->notify & channel->notify_mask) == 0)
+        {
+            atomic_fetch_or((_Atomic uint64_t *)channel->notify, channel->notify_mask);
+        }
+    }
+
+    ring_sample_end(channel, ring, xchg_sample_prepare_send);
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_receive(struct xchg_channel *channel, struct xchg_message *message)
+{
+    if(unlikely(channel == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->ingress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no ingress";
+        return false;
+    }
+
+    if(unlikely(nr_used(ring, ring->sz_message) < ring->sz_message))
+    {
+        if(channel->flags & xchg_channel_flag_statistics)
+        {
+            statistic_add(&ring->shared->nr_empty, 1);
+        }
+
+        XCHG_PROBE2(ring_empty, ring->data, ring->cr / ring->sz_message);
+
+        channel->error = "channel is empty";
+        return false;
+    }
+
+    size_t data_offset = ring_offset(ring, ring->cr);
+    char *data = ring->data + data_offset + ring->sz_header;
+
+    // only slots which have already been published are prefetched, since pulling in a slot that the producer is
+    // still writing would just bounce its cache line between the two
+
+    if(ring->prefetch != 0 && ring->cw - ring->cr > ring->prefetch)
+    {
+        __builtin_prefetch(ring_slot_ahead(ring, ring->cr, ring->prefetch), 0, 3);
+    }
+
+    xchg_message_init(message, data, ring->sz_message - ring->sz_header);
+    ring->held = true;
+
+    if(ring->sz_header > 0)
+    {
+        struct xchg_header header;
+        memcpy(&header, ring->data + data_offset, offsetof(struct xchg_header, type));
+
+        if(unlikely(header.length > message->length))
+        {
+            channel->error = "message length is invalid";
+            XCHG_PROBE3(message_invalid, ring->data, ring->cr / ring->sz_message, channel->error);
+            return false;
+        }
+
+        message->length = header.length;
+
+        if((channel->flags & xchg_channel_flag_checksum) && unlikely(crc32c(data, header.length) != header.checksum))
+        {
+            channel->error = "message failed checksum verification";
+            XCHG_PROBE3(message_invalid, ring->data, ring->cr / ring->sz_message, channel->error);
+            return false;
+        }
+    }
+
+    XCHG_PROBE3(message_receive, ring->data, ring->cr / ring->sz_message, message->length);
+
+    ring_sample_start(channel, ring);
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_return(struct xchg_channel *channel, const struct xchg_message *message)
+{
+    if(unlikely(channel == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->ingress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no ingress";
+        return false;
+    }
+
+    size_t data_offset = ring_offset(ring, ring->cr);
+    char *data = ring->data + data_offset + ring->sz_header;
+
+    if(unlikely(message->length > ring->sz_message - ring->sz_header || data != message->data))
+    {
+        channel->error = "message is invalid";
+        return false;
+    }
+
+    XCHG_PROBE3(message_return, ring->data, ring->cr / ring->sz_message, message->length);
+
+    ring->cr += ring->sz_message;
+    ring->held = false;
+    ring_advance(ring);
+    ring->nr_unpublished += 1;
+
+    if(channel->flags & xchg_channel_flag_statistics)
+    {
+        statistic_add(&ring->shared->nr_received, 1);
+        statistic_add(&ring->shared->sz_received, message->length);
+    }
+
+    if(ring->nr_unpublished >= ring->batch || ring->cr == ring->cw)
+    {
+        atomic_thread_fence(memory_order_acquire);
+        *ring->r = ring->cr;
+        ring->nr_unpublished = 0;
+    }
+
+    ring_sample_end(channel, ring, xchg_sample_receive_return);
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_header(struct xchg_channel *channel, const struct xchg_message *message, struct xchg_header *header)
+{
+    if(unlikely(channel == NULL || message == NULL || header == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(!(channel->flags & xchg_channel_flag_header)))
+    {
+        channel->error = "channel has no message headers";
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->ingress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no ingress";
+        return false;
+    }
+
+    size_t data_offset = ring_offset(ring, ring->cr);
+    char *data = ring->data + data_offset + ring->sz_header;
+
+    if(unlikely(data != message->data))
+    {
+        channel->error = "message is invalid";
+        return false;
+    }
+
+    memcpy(header, ring->data + data_offset, sizeof(struct xchg_header));
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_heartbeat(struct xchg_channel *channel)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(!(channel->flags & xchg_channel_flag_liveness)))
+    {
+        channel->error = "channel has no liveness header";
+        return false;
+    }
+
+    if(channel->ingress.data != NULL)
+    {
+        ring_heartbeat(&channel->ingress, false);
+    }
+
+    if(channel->egress.data != NULL)
+    {
+        ring_heartbeat(&channel->egress, true);
+    }
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_peer_alive(struct xchg_channel *channel, uint64_t timeout_ns)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(!(channel->flags & xchg_channel_flag_liveness)))
+    {
+        channel->error = "channel has no liveness header";
+        return false;
+    }
+
+    char *error = NULL;
+
+    // both rings are always checked, so that a later recovery knows which peer was observed on each of them
+
+    if(channel->ingress.data != NULL)
+    {
+        error = ring_peer_check(&channel->ingress, false, timeout_ns);
+    }
+
+    if(channel->egress.data != NULL)
+    {
+        char *egress_error = ring_peer_check(&channel->egress, true, timeout_ns);
+        error = error != NULL ? error : egress_error;
+    }
+
+    channel->error = error;
+    return error == NULL;
+}
+
+bool xchg_channel_recover(struct xchg_channel *channel, bool discard)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(!(channel->flags & xchg_channel_flag_liveness)))
+    {
+        channel->error = "channel has no liveness header";
+        return false;
+    }
+
+    struct xchg_ring *rings[] = { &channel->ingress, &channel->egress };
+
+    // the producer of ingress and the consumer of egress are the peers being recovered from
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        uint64_t *pid = i == 0 ? &rings[i]->shared->producer_pid : &rings[i]->shared->consumer_pid;
+
+        if(rings[i]->data != NULL && process_alive(atomic_load((_Atomic uint64_t *)pid)))
+        {
+            channel->error = "peer process is still running";
+            return false;
+        }
+    }
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        if(rings[i]->data != NULL &&
+           atomic_load((_Atomic uint64_t *)&rings[i]->shared->generation) != rings[i]->generation)
+        {
+            channel->error = "peer has already reattached";
+            return false;
+        }
+    }
+
+    // both rings are claimed before either is changed, so a replacement which attaches to one of them in the
+    // meantime leaves the channel as it was
+
+    if(channel->ingress.data != NULL && !ring_claim(&channel->ingress))
+    {
+        channel->error = "peer has already reattached";
+        return false;
+    }
+
+    if(channel->egress.data != NULL && !ring_claim(&channel->egress))
+    {
+        if(channel->ingress.data != NULL)
+        {
+            ring_unclaim(&channel->ingress);
+        }
+
+        channel->error = "peer has already reattached";
+        return false;
+    }
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        if(rings[i]->data != NULL)
+        {
+            ring_recover(rings[i], i == 1, discard);
+        }
+    }
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_set_prefetch(struct xchg_channel *channel, size_t distance)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *rings[] = { &channel->ingress, &channel->egress };
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        if(rings[i]->data != NULL && distance >= rings[i]->sz_data / rings[i]->sz_message)
+        {
+            channel->error = "prefetch distance is invalid";
+            return false;
+        }
+    }
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        rings[i]->prefetch = distance * rings[i]->sz_message;
+    }
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_set_refresh_batch(struct xchg_channel *channel, size_t batch)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->ingress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no ingress";
+        return false;
+    }
+
+    if(batch == 0 || batch > ring->sz_data / ring->sz_message)
+    {
+        channel->error = "refresh batch is invalid";
+        return false;
+    }
+
+    ring->batch = batch;
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_channel_set_streaming(struct xchg_channel *channel, size_t threshold)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_ring *ring = &channel->egress;
+
+    if(unlikely(ring->data == NULL))
+    {
+        channel->error = "channel has no egress";
+        return false;
+    }
+
+    ring->streaming = threshold;
+
+    channel->error = NULL;
+    return true;
+}
+
+const char *xchg_channel_strerror(const struct xchg_channel *channel)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    return channel->error;
+}
+
+bool xchg_statistics_read(struct xchg_statistics *statistics, const char *ring, size_t sz_ring)
+{
+    if(unlikely(statistics == NULL || ring == NULL))
+    {
+        return false;
+    }
+
+    uint32_t flags = 0;
+    size_t sz_message = 0;
+    char *error = ring_validate(ring, sz_ring, &flags, &sz_message);
+
+    if(error != NULL)
+    {
+        statistics->error = error;
+        return false;
+    }
+
+    const struct xchg_ring_shared *shared = (const struct xchg_ring_shared *)ring;
+
+    // the read position is loaded first, so the write position loaded after it can never be behind it
+
+    size_t r = atomic_load_explicit((_Atomic size_t *)&shared->r, memory_order_acquire);
+    size_t w = atomic_load_explicit((_Atomic size_t *)&shared->w, memory_order_acquire);
+
+    statistics->flags = flags;
+    statistics->sz_message = sz_message;
+    statistics->sz_data = shared->sz_data;
+    statistics->read_sequence = r / sz_message;
+    statistics->write_sequence = w / sz_message;
+    statistics->nr_pending = (w - r) / sz_message;
+    statistics->producer_pid = atomic_load_explicit((_Atomic uint64_t *)&shared->producer_pid, memory_order_relaxed);
+    statistics->producer_heartbeat = atomic_load_explicit((_Atomic uint64_t *)&shared->producer_heartbeat,
+                                                          memory_order_relaxed);
+    statistics->consumer_pid = atomic_load_explicit((_Atomic uint64_t *)&shared->consumer_pid, memory_order_relaxed);
+    statistics->consumer_heartbeat = atomic_load_explicit((_Atomic uint64_t *)&shared->consumer_heartbeat,
+                                                          memory_order_relaxed);
+    statistics->nr_sent = atomic_load_explicit((_Atomic uint64_t *)&shared->nr_sent, memory_order_relaxed);
+    statistics->sz_sent = atomic_load_explicit((_Atomic uint64_t *)&shared->sz_sent, memory_order_relaxed);
+    statistics->nr_full = atomic_load_explicit((_Atomic uint64_t *)&shared->nr_full, memory_order_relaxed);
+    statistics->nr_high_water = atomic_load_explicit((_Atomic uint64_t *)&shared->nr_high_water, memory_order_relaxed);
+    statistics->nr_received = atomic_load_explicit((_Atomic uint64_t *)&shared->nr_received, memory_order_relaxed);
+    statistics->sz_received = atomic_load_explicit((_Atomic uint64_t *)&shared->sz_received, memory_order_relaxed);
+    statistics->nr_empty = atomic_load_explicit((_Atomic uint64_t *)&shared->nr_empty, memory_order_relaxed);
+
+    statistics->error = NULL;
+    return true;
+}
+
+bool xchg_statistics_peek(struct xchg_statistics *statistics, const char *ring, uint64_t sequence,
+                          char *buffer, size_t sz_buffer, size_t *length)
+{
+    if(unlikely(statistics == NULL || ring == NULL || buffer == NULL || length == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(statistics->sz_message == 0))
+    {
+        statistics->error = "ring header has not been read";
+        return false;
+    }
+
+    const struct xchg_ring_shared *shared = (const struct xchg_ring_shared *)ring;
+    size_t sz_header = slot_header_size(statistics->flags);
+    size_t sz_payload = statistics->sz_message - sz_header;
+    size_t position = (size_t)sequence * statistics->sz_message;
+
+    if(sz_buffer < sz_payload)
+    {
+        statistics->error = "buffer is too small";
+        return false;
+    }
+
+    size_t r = atomic_load_explicit((_Atomic size_t *)&shared->r, memory_order_acquire);
+    size_t w = atomic_load_explicit((_Atomic size_t *)&shared->w, memory_order_acquire);
+
+    if(position - r >= w - r)
+    {
+        statistics->error = "message is not pending";
+        return false;
+    }
+
+    const char *slot = ring + XCHG_RING_HEADER_SIZE + (position % statistics->sz_data);
+
+    if(sz_header > 0)
+    {
+        uint32_t written = 0;
+        memcpy(&written, slot, sizeof(written));
+        sz_payload = written < sz_payload ? written : sz_payload;
+    }
+
+    memcpy(buffer, slot + sz_header, sz_payload);
+
+    // the slot may have been returned and reused while it was being copied, which is detected like a seqlock retry
+    // by checking that the read position has not moved past it since
+
+    atomic_thread_fence(memory_order_acquire);
+
+    if(atomic_load_explicit((_Atomic size_t *)&shared->r, memory_order_relaxed) - r > position - r)
+    {
+        statistics->error = "message is no longer pending";
+        return false;
+    }
+
+    *length = sz_payload;
+
+    statistics->error = NULL;
+    return true;
+}
+
+const char *xchg_statistics_strerror(const struct xchg_statistics *statistics)
+{
+    if(unlikely(statistics == NULL))
+    {
+        return false;
+    }
+
+    return statistics->error;
+}
+
+bool xchg_sampler_init(struct xchg_sampler *sampler, struct xchg_sample *samples, size_t nr_samples)
+{
+    if(unlikely(sampler == NULL || samples == NULL))
+    {
+        return false;
+    }
+
+    if(nr_samples == 0 || flp2(nr_samples) != nr_samples)
+    {
+        sampler->error = "sample count is invalid";
+        return false;
+    }
+
+    sampler->samples = samples;
+    sampler->mask = nr_samples - 1;
+    sampler->w = 0;
+    sampler->r = 0;
+    sampler->nr_dropped = 0;
+
+    sampler->error = NULL;
+    return true;
+}
+
+bool xchg_channel_set_sampler(struct xchg_channel *channel, struct xchg_sampler *sampler, size_t period)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    if(sampler != NULL && period == 0)
+    {
+        channel->error = "sample period is invalid";
+        return false;
+    }
+
+    channel->sampler = sampler;
+    channel->sample_period = period;
+
+    struct xchg_ring *rings[] = { &channel->ingress, &channel->egress };
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        rings[i]->sample_start = 0;
+        rings[i]->sample_countdown = period;
+    }
+
+    channel->error = NULL;
+    return true;
+}
+
+// log-linear buckets: values below 32 have a bucket each, and every power of two above that is split into 32
+
+#define XCHG_HISTOGRAM_SUB_BITS 5u
+#define XCHG_HISTOGRAM_SUB_COUNT (1u << XCHG_HISTOGRAM_SUB_BITS)
+
+static_assert(((64u - XCHG_HISTOGRAM_SUB_BITS + 1u) * XCHG_HISTOGRAM_SUB_COUNT) == XCHG_HISTOGRAM_BUCKETS,
+              "histogram bucket count does not cover 64-bit values");
+
+static size_t histogram_index(uint64_t value)
+{
+    if(value < XCHG_HISTOGRAM_SUB_COUNT)
+    {
+        return (size_t)value;
+    }
+
+    unsigned shift = (63u - (unsigned)__builtin_clzll(value)) - XCHG_HISTOGRAM_SUB_BITS;
+    return ((size_t)(shift + 1) * XCHG_HISTOGRAM_SUB_COUNT) + (size_t)((value >> shift) - XCHG_HISTOGRAM_SUB_COUNT);
+}
+
+static uint64_t histogram_highest(size_t index)
+{
+    if(index < XCHG_HISTOGRAM_SUB_COUNT)
+    {
+        return index;
+    }
+
+    unsigned shift = (unsigned)(index / XCHG_HISTOGRAM_SUB_COUNT) - 1;
+    uint64_t base = (uint64_t)(XCHG_HISTOGRAM_SUB_COUNT + (index % XCHG_HISTOGRAM_SUB_COUNT)) << shift;
+    return base + (((uint64_t)1 << shift) - 1);
+}
+
+static void histogram_record(struct xchg_histogram *histogram, uint64_t value)
+{
+    histogram->counts[histogram_index(value)] += 1;
+    histogram->count += 1;
+
+    if(value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+bool xchg_sampler_drain(struct xchg_sampler *sampler,
+                        struct xchg_histogram *prepare_send, struct xchg_histogram *receive_return, size_t *nr_drained)
+{
+    if(unlikely(sampler == NULL || sampler->samples == NULL))
+    {
+        return false;
+    }
+
+    size_t r = sampler->r;
+    size_t w = atomic_load_explicit((_Atomic size_t *)&sampler->w, memory_order_acquire);
+
+    for(size_t i = r; i != w; i++)
+    {
+        const struct xchg_sample *sample = &sampler->samples[i & sampler->mask];
+        struct xchg_histogram *histogram = sample->kind == xchg_sample_prepare_send ? prepare_send : receive_return;
+
+        if(histogram != NULL)
+        {
+            histogram_record(histogram, sample->ticks);
+        }
+    }
+
+    atomic_store_explicit((_Atomic size_t *)&sampler->r, w, memory_order_release);
+
+    if(nr_drained != NULL)
+    {
+        *nr_drained = w - r;
+    }
+
+    sampler->error = NULL;
+    return true;
+}
+
+uint64_t xchg_sampler_dropped(const struct xchg_sampler *sampler)
+{
+    if(unlikely(sampler == NULL))
+    {
+        return 0;
+    }
+
+    return atomic_load_explicit((_Atomic uint64_t *)&sampler->nr_dropped, memory_order_relaxed);
+}
+
+bool xchg_sampler_calibrate(double *ticks_per_ns)
+{
+    if(unlikely(ticks_per_ns == NULL))
+    {
+        return false;
+    }
+
+    uint64_t start_ns = monotonic_ns();
+    uint64_t start_ticks = ticks();
+
+    struct timespec duration = { .tv_sec = 0, .tv_nsec = 10000000 };
+    while(nanosleep(&duration, &duration) != 0 && errno == EINTR)
+    {
+    }
+
+    uint64_t end_ticks = ticks();
+    uint64_t end_ns = monotonic_ns();
+
+    if(end_ns == start_ns || end_ticks == start_ticks)
+    {
+        return false;
+    }
+
+    *ticks_per_ns = (double)(end_ticks - start_ticks) / (double)(end_ns - start_ns);
+    return true;
+}
+
+const char *xchg_sampler_strerror(const struct xchg_sampler *sampler)
+{
+    if(unlikely(sampler == NULL))
+    {
+        return false;
+    }
+
+    return sampler->error;
+}
+
+bool xchg_histogram_percentile(const struct xchg_histogram *histogram, double percentile, uint64_t *value)
+{
+    if(unlikely(histogram == NULL || value == NULL))
+    {
+        return false;
+    }
+
+    if(histogram->count == 0 || !(percentile >= 0.0 && percentile <= 100.0))
+    {
+        return false;
+    }
+
+    uint64_t target = (uint64_t)((percentile / 100.0) * (double)histogram->count);
+    if((double)target < (percentile / 100.0) * (double)histogram->count)
+    {
+        target += 1;
+    }
+    if(target == 0)
+    {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+
+    for(size_t i = 0; i < XCHG_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->counts[i];
+
+        if(seen >= target)
+        {
+            uint64_t highest = histogram_highest(i);
+            *value = highest < histogram->max ? highest : histogram->max;
+            return true;
+        }
+    }
+
+    *value = histogram->max;
+    return true;
+}
+
+bool xchg_histogram_merge(struct xchg_histogram *histogram, const struct xchg_histogram *source)
+{
+    if(unlikely(histogram == NULL || source == NULL))
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < XCHG_HISTOGRAM_BUCKETS; i++)
+    {
+        histogram->counts[i] += source->counts[i];
+    }
+
+    histogram->count += source->count;
+
+    if(source->max > histogram->max)
+    {
+        histogram->max = source->max;
+    }
+
+    return true;
+}
+
+bool xchg_lanes_init(struct xchg_lanes *lanes, uint32_t flags, size_t nr_lanes, size_t sz_message,
+                     char *ingress[], size_t sz_ingress[],
+                     char *egress[], size_t sz_egress[])
+{
+    if(unlikely(lanes == NULL || (ingress == NULL && egress == NULL)))
+    {
+        return false;
+    }
+
+    if(unlikely((ingress != NULL && sz_ingress == NULL) || (egress != NULL && sz_egress == NULL)))
+    {
+        return false;
+    }
+
+    if(nr_lanes == 0 || nr_lanes > XCHG_LANES_MAX)
+    {
+        lanes->error = "number of lanes is invalid";
+        return false;
+    }
+
+    for(size_t i = 0; i < nr_lanes; i++)
+    {
+        struct xchg_channel *channel = &lanes->lanes[i].channel;
+
+        memset(channel, 0, sizeof(struct xchg_channel));
+
+        if(!xchg_channel_init_ex(channel, flags, sz_message,
+                                 ingress != NULL ? ingress[i] : NULL, ingress != NULL ? sz_ingress[i] : 0,
+                                 egress != NULL ? egress[i] : NULL, egress != NULL ? sz_egress[i] : 0))
+        {
+            lanes->error = channel->error != NULL ? channel->error : "lane buffers are invalid";
+            return false;
+        }
+    }
+
+    lanes->nr_lanes = nr_lanes;
+    lanes->error = NULL;
+    return true;
+}
+
+static struct xchg_channel *lanes_find(struct xchg_lanes *lanes, const struct xchg_message *message, bool ingress)
+{
+    for(size_t i = 0; i < lanes->nr_lanes; i++)
+    {
+        struct xchg_channel *channel = &lanes->lanes[i].channel;
+        struct xchg_ring *ring = ingress ? &channel->ingress : &channel->egress;
+
+        if(ring->data != NULL && message->data >= ring->data && message->data < ring->data + ring->sz_data)
+        {
+            return channel;
+        }
+    }
+
+    return NULL;
+}
+
+bool xchg_lanes_prepare(struct xchg_lanes *lanes, struct xchg_message *message, size_t priority)
+{
+    if(unlikely(lanes == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(priority >= lanes->nr_lanes))
+    {
+        lanes->error = "lane priority is invalid";
+        return false;
+    }
+
+    struct xchg_channel *channel = &lanes->lanes[priority].channel;
+
+    if(!xchg_channel_prepare(channel, message))
+    {
+        lanes->error = channel->error;
+        return false;
+    }
+
+    lanes->error = NULL;
+    return true;
+}
+
+bool xchg_lanes_send(struct xchg_lanes *lanes, const struct xchg_message *message)
+{
+    if(unlikely(lanes == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_channel *channel = lanes_find(lanes, message, false);
+
+    if(unlikely(channel == NULL))
+    {
+        lanes->error = "message is invalid";
+        return false;
+    }
+
+    if(!xchg_channel_send(channel, message))
+    {
+        lanes->error = channel->error;
+        return false;
+    }
+
+    lanes->error = NULL;
+    return true;
+}
+
+bool xchg_lanes_receive(struct xchg_lanes *lanes, struct xchg_message *message, size_t *priority)
+{
+    if(unlikely(lanes == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < lanes->nr_lanes; i++)
+    {
+        struct xchg_channel *channel = &lanes->lanes[i].channel;
+        struct xchg_ring *ring = &channel->ingress;
+
+        if(unlikely(ring->data == NULL))
+        {
+            lanes->error = "channel has no ingress";
+            return false;
+        }
+
+        if(nr_used(ring, ring->sz_message) < ring->sz_message)
+        {
+            continue;
+        }
+
+        if(priority != NULL)
+        {
+            *priority = i;
+        }
+
+        if(!xchg_channel_receive(channel, message))
+        {
+            lanes->error = channel->error;
+            return false;
+        }
+
+        lanes->error = NULL;
+        return true;
+    }
+
+    lanes->error = "channel is empty";
+    return false;
+}
+
+bool xchg_lanes_return(struct xchg_lanes *lanes, const struct xchg_message *message)
+{
+    if(unlikely(lanes == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_channel *channel = lanes_find(lanes, message, true);
+
+    if(unlikely(channel == NULL))
+    {
+        lanes->error = "message is invalid";
+        return false;
+    }
+
+    if(!xchg_channel_return(channel, message))
+    {
+        lanes->error = channel->error;
+        return false;
+    }
+
+    lanes->error = NULL;
+    return true;
+}
+
+const char *xchg_lanes_strerror(const struct xchg_lanes *lanes)
+{
+    if(unlikely(lanes == NULL))
+    {
+        return false;
+    }
+
+    return lanes->error;
+}
+
+static void seqlock_write_begin(volatile uint64_t *sequence)
+{
+    atomic_store_explicit((_Atomic uint64_t *)sequence, *sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void seqlock_write_end(volatile uint64_t *sequence)
+{
+    atomic_store_explicit((_Atomic uint64_t *)sequence, *sequence + 1, memory_order_release);
+}
+
+static uint64_t seqlock_read_begin(volatile uint64_t *sequence)
+{
+    return atomic_load_explicit((_Atomic uint64_t *)sequence, memory_order_acquire);
+}
+
+static bool seqlock_read_retry(volatile uint64_t *sequence, uint64_t start)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return (start & 1u) != 0 || atomic_load_explicit((_Atomic uint64_t *)sequence, memory_order_relaxed) != start;
+}
+
+struct xchg_conflator_slot
+{
+    uint64_t sequence;
+    uint32_t pending;
+    uint32_t length;
+};
+
+#define XCHG_CACHE_LINE 64u
+
+static size_t align_up(size_t x, size_t alignment)
+{
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t conflator_capacity(size_t nr_keys)
+{
+    // a key can be queued twice while the consumer is between clearing its pending flag and dequeuing it
+
+    size_t capacity = 2;
+    while(capacity < nr_keys + 1)
+    {
+        capacity <<= 1u;
+    }
+    return capacity;
+}
+
+size_t xchg_conflator_size(size_t nr_keys, size_t sz_message)
+{
+    if(nr_keys == 0 || nr_keys > UINT32_MAX || sz_message == 0 || sz_message > UINT32_MAX)
+    {
+        return 0;
+    }
+
+    size_t sz_keys = align_up(conflator_capacity(nr_keys) * sizeof(uint32_t), XCHG_CACHE_LINE);
+    size_t sz_slot = align_up(sizeof(struct xchg_conflator_slot) + sz_message, XCHG_CACHE_LINE);
+
+    return (2 * XCHG_CACHE_LINE) + sz_keys + (nr_keys * sz_slot);
+}
+
+bool xchg_conflator_init(struct xchg_conflator *conflator, size_t nr_keys, size_t sz_message,
+                         char *buffer, size_t sz_buffer)
+{
+    if(unlikely(conflator == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    size_t sz_required = xchg_conflator_size(nr_keys, sz_message);
+
+    if(sz_required == 0)
+    {
+        conflator->error = "conflator geometry is invalid";
+        return false;
+    }
+
+    if(sz_buffer < sz_required || ((uintptr_t)buffer % XCHG_CACHE_LINE) != 0)
+    {
+        conflator->error = "conflator buffer is invalid";
+        return false;
+    }
+
+    size_t capacity = conflator_capacity(nr_keys);
+
+    conflator->r = (volatile uint64_t *)(buffer + (XCHG_CACHE_LINE * 0));
+    conflator->cr = *conflator->r;
+    conflator->w = (volatile uint64_t *)(buffer + (XCHG_CACHE_LINE * 1));
+    conflator->cw = *conflator->w;
+    conflator->keys = (volatile uint32_t *)(buffer + (XCHG_CACHE_LINE * 2));
+    conflator->mask = capacity - 1;
+    conflator->slots = buffer + (XCHG_CACHE_LINE * 2) + align_up(capacity * sizeof(uint32_t), XCHG_CACHE_LINE);
+    conflator->sz_slot = align_up(sizeof(struct xchg_conflator_slot) + sz_message, XCHG_CACHE_LINE);
+    conflator->nr_keys = nr_keys;
+    conflator->sz_message = sz_message;
+    conflator->key = SIZE_MAX;
+
+    conflator->error = NULL;
+    return true;
+}
+
+bool xchg_conflator_prepare(struct xchg_conflator *conflator, struct xchg_message *message, size_t key)
+{
+    if(unlikely(conflator == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(key >= conflator->nr_keys))
+    {
+        conflator->error = "key is invalid";
+        return false;
+    }
+
+    if(unlikely(conflator->key != SIZE_MAX))
+    {
+        conflator->error = "another message is already prepared";
+        return false;
+    }
+
+    struct xchg_conflator_slot *slot = (struct xchg_conflator_slot *)(conflator->slots + (key * conflator->sz_slot));
+
+    seqlock_write_begin(&slot->sequence);
+    conflator->key = key;
+
+    xchg_message_init(message, (char *)(slot + 1), conflator->sz_message);
+
+    conflator->error = NULL;
+    return true;
+}
+
+bool xchg_conflator_send(struct xchg_conflator *conflator, const struct xchg_message *message)
+{
+    if(unlikely(conflator == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    size_t key = conflator->key;
+    struct xchg_conflator_slot *slot = (struct xchg_conflator_slot *)(conflator->slots + (key * conflator->sz_slot));
+
+    if(unlikely(key == SIZE_MAX || message->data != (char *)(slot + 1) || message->length != conflator->sz_message))
+    {
+        conflator->error = "message is invalid";
+        return false;
+    }
+
+    slot->length = (uint32_t)message->position;
+    seqlock_write_end(&slot->sequence);
+    conflator->key = SIZE_MAX;
+
+    // only the update which marks the key as pending enqueues it; later updates are conflated into the same slot
+
+    if(atomic_exchange((_Atomic uint32_t *)&slot->pending, 1) == 0)
+    {
+        conflator->keys[conflator->cw & conflator->mask] = (uint32_t)key;
+        conflator->cw += 1;
+        atomic_store_explicit((_Atomic uint64_t *)conflator->w, conflator->cw, memory_order_release);
+    }
+
+    conflator->error = NULL;
+    return true;
+}
+
+#define XCHG_CONFLATOR_READ_ATTEMPTS 64u
+
+bool xchg_conflator_receive(struct xchg_conflator *conflator, size_t *key, struct xchg_message *message,
+                            char *buffer, size_t sz_buffer)
+{
+    if(unlikely(conflator == NULL || key == NULL || message == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(sz_buffer < conflator->sz_message))
+    {
+        conflator->error = "buffer is too small";
+        return false;
+    }
+
+    if(conflator->cw == conflator->cr)
+    {
+        conflator->cw = atomic_load_explicit((_Atomic uint64_t *)conflator->w, memory_order_acquire);
+
+        if(conflator->cw == conflator->cr)
+        {
+            conflator->error = "conflator is empty";
+            return false;
+        }
+    }
+
+    uint32_t k = conflator->keys[conflator->cr & conflator->mask];
+    struct xchg_conflator_slot *slot = (struct xchg_conflator_slot *)(conflator->slots + (k * conflator->sz_slot));
+
+    if(seqlock_read_begin(&slot->sequence) & 1u)
+    {
+        conflator->error = "message is being written";
+        return false;
+    }
+
+    // clear the pending flag before copying, so that an update racing with the copy enqueues the key again
+
+    atomic_store((_Atomic uint32_t *)&slot->pending, 0);
+
+    uint32_t length;
+    uint64_t start;
+    uint32_t attempt = 0;
+
+    do
+    {
+        if(attempt++ == XCHG_CONFLATOR_READ_ATTEMPTS)
+        {
+            // the producer stalled mid-update, so the key stays queued for a later attempt, unless an update which
+            // raced with the copy has already queued it again
+
+            if(atomic_exchange((_Atomic uint32_t *)&slot->pending, 1) != 0)
+            {
+                conflator->cr += 1;
+                atomic_store_explicit((_Atomic uint64_t *)conflator->r, conflator->cr, memory_order_release);
+            }
+
+            conflator->error = "message is being written";
+            return false;
+        }
+
+        start = seqlock_read_begin(&slot->sequence);
+        length = slot->length;
+        if(length > conflator->sz_message)
+        {
+            length = (uint32_t)conflator->sz_message;
+        }
+        memcpy(buffer, (const char *)(slot + 1), length);
+    } while(seqlock_read_retry(&slot->sequence, start));
+
+    conflator->cr += 1;
+    atomic_store_explicit((_Atomic uint64_t *)conflator->r, conflator->cr, memory_order_release);
+
+    xchg_message_init(message, buffer, conflator->sz_message);
+    message->length = length;
+
+    *key = k;
+
+    conflator->error = NULL;
+    return true;
+}
+
+const char *xchg_conflator_strerror(const struct xchg_conflator *conflator)
+{
+    if(unlikely(conflator == NULL))
+    {
+        return false;
+    }
+
+    return conflator->error;
+}
+
+#define XCHG_SNAPSHOT_READ_ATTEMPTS 64u
+
+bool xchg_snapshot_init(struct xchg_snapshot *snapshot, char *buffer, size_t sz_buffer)
+{
+    if(unlikely(snapshot == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    if(sz_buffer <= XCHG_CACHE_LINE || ((uintptr_t)buffer % sizeof(uint64_t)) != 0)
+    {
+        snapshot->error = "snapshot buffer is invalid";
+        return false;
+    }
+
+    snapshot->sequence = (volatile uint64_t *)(buffer + (sizeof(uint64_t) * 0));
+    snapshot->length = (volatile uint64_t *)(buffer + (sizeof(uint64_t) * 1));
+    snapshot->data = buffer + XCHG_CACHE_LINE;
+    snapshot->sz_message = sz_buffer - XCHG_CACHE_LINE;
+    snapshot->writing = false;
+
+    snapshot->error = NULL;
+    return true;
+}
+
+bool xchg_snapshot_prepare(struct xchg_snapshot *snapshot, struct xchg_message *message)
+{
+    if(unlikely(snapshot == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(snapshot->data == NULL))
+    {
+        snapshot->error = "snapshot is not initialized";
+        return false;
+    }
+
+    if(unlikely(snapshot->writing))
+    {
+        snapshot->error = "another message is already prepared";
+        return false;
+    }
+
+    seqlock_write_begin(snapshot->sequence);
+    snapshot->writing = true;
+
+    xchg_message_init(message, snapshot->data, snapshot->sz_message);
+
+    snapshot->error = NULL;
+    return true;
+}
+
+bool xchg_snapshot_publish(struct xchg_snapshot *snapshot, const struct xchg_message *message)
+{
+    if(unlikely(snapshot == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(!snapshot->writing || message->data != snapshot->data || message->length != snapshot->sz_message))
+    {
+        snapshot->error = "message is invalid";
+        return false;
+    }
+
+    *snapshot->length = message->position;
+    seqlock_write_end(snapshot->sequence);
+    snapshot->writing = false;
+
+    snapshot->error = NULL;
+    return true;
+}
+
+bool xchg_snapshot_read(struct xchg_snapshot *snapshot, struct xchg_message *message,
+                        char *buffer, size_t sz_buffer, uint64_t *version)
+{
+    if(unlikely(snapshot == NULL || message == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(snapshot->data == NULL))
+    {
+        snapshot->error = "snapshot is not initialized";
+        return false;
+    }
+
+    if(unlikely(sz_buffer < snapshot->sz_message))
+    {
+        snapshot->error = "buffer is too small";
+        return false;
+    }
+
+    uint64_t start = seqlock_read_begin(snapshot->sequence);
+
+    if(start == 0)
+    {
+        snapshot->error = "snapshot is empty";
+        return false;
+    }
+
+    if(start & 1u)
+    {
+        snapshot->error = "snapshot is being written";
+        return false;
+    }
+
+    // the copy is only retried a bounded number of times, so that a writer which stalls or dies after the check
+    // above cannot hang the reader
+
+    size_t length = 0;
+    size_t attempt = 0;
+
+    do
+    {
+        if(attempt++ == XCHG_SNAPSHOT_READ_ATTEMPTS)
+        {
+            snapshot->error = "snapshot is being written";
+            return false;
+        }
+
+        start = seqlock_read_begin(snapshot->sequence);
+        length = *snapshot->length;
+        if(length > snapshot->sz_message)
+        {
+            length = snapshot->sz_message;
+        }
+        memcpy(buffer, snapshot->data, length);
+    } while(seqlock_read_retry(snapshot->sequence, start));
+
+    xchg_message_init(message, buffer, snapshot->sz_message);
+    message->length = length;
+
+    if(version != NULL)
+    {
+        *version = start / 2;
+    }
+
+    snapshot->error = NULL;
+    return true;
+}
+
+const char *xchg_snapshot_strerror(const struct xchg_snapshot *snapshot)
+{
+    if(unlikely(snapshot == NULL))
+    {
+        return false;
+    }
+
+    return snapshot->error;
+}
+
+bool xchg_rpc_init(struct xchg_rpc *rpc, struct xchg_channel *channel, struct xchg_rpc_call *calls, size_t nr_calls)
+{
+    if(unlikely(rpc == NULL || channel == NULL))
+    {
+        return false;
+    }
+
+    if(channel->ingress.data == NULL || channel->egress.data == NULL)
+    {
+        rpc->error = "channel must have both ingress and egress";
+        return false;
+    }
+
+    if((calls == NULL) != (nr_calls == 0) || (nr_calls != 0 && flp2(nr_calls) != nr_calls))
+    {
+        rpc->error = "completion table is invalid";
+        return false;
+    }
+
+    if(calls != NULL)
+    {
+        memset(calls, 0, nr_calls * sizeof(struct xchg_rpc_call));
+    }
+
+    rpc->channel = channel;
+    rpc->calls = calls;
+    rpc->mask = nr_calls - 1;
+    rpc->next_id = 1;
+    rpc->nr_pending = 0;
+
+    rpc->error = NULL;
+    return true;
+}
+
+bool xchg_rpc_prepare(struct xchg_rpc *rpc, struct xchg_message *message)
+{
+    if(unlikely(rpc == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(rpc->calls == NULL))
+    {
+        rpc->error = "rpc has no completion table";
+        return false;
+    }
+
+    // correlation ids are never zero, so a zero id marks a free completion slot
+
+    if(rpc->calls[rpc->next_id & rpc->mask].id != 0)
+    {
+        rpc->error = "too many calls are in flight";
+        return false;
+    }
+
+    if(!xchg_channel_prepare(rpc->channel, message))
+    {
+        rpc->error = rpc->channel->error;
+        return false;
+    }
+
+    if(!xchg_message_write_uint64(message, rpc->next_id))
+    {
+        rpc->error = message->error;
+        return false;
+    }
+
+    rpc->error = NULL;
+    return true;
+}
+
+bool xchg_rpc_call(struct xchg_rpc *rpc, const struct xchg_message *message,
+                   xchg_rpc_callback callback, void *context, uint64_t *id)
+{
+    if(unlikely(rpc == NULL || message == NULL || callback == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(rpc->calls == NULL))
+    {
+        rpc->error = "rpc has no completion table";
+        return false;
+    }
+
+    if(!xchg_channel_send(rpc->channel, message))
+    {
+        rpc->error = rpc->channel->error;
+        return false;
+    }
+
+    struct xchg_rpc_call *call = &rpc->calls[rpc->next_id & rpc->mask];
+    call->id = rpc->next_id;
+    call->callback = callback;
+    call->context = context;
+
+    if(id != NULL)
+    {
+        *id = rpc->next_id;
+    }
+
+    rpc->next_id += 1;
+    rpc->nr_pending += 1;
+
+    rpc->error = NULL;
+    return true;
+}
+
+bool xchg_rpc_dispatch(struct xchg_rpc *rpc, size_t *nr_completed)
+{
+    if(unlikely(rpc == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(rpc->calls == NULL))
+    {
+        rpc->error = "rpc has no completion table";
+        return false;
+    }
+
+    size_t completed = 0;
+    struct xchg_message response = { 0 };
+
+    if(nr_completed != NULL)
+    {
+        *nr_completed = 0;
+    }
+
+    struct xchg_ring *ring = &rpc->channel->ingress;
+
+    while(rpc->nr_pending > 0 && nr_used(ring, ring->sz_message) >= ring->sz_message)
+    {
+        if(!xchg_channel_receive(rpc->channel, &response))
+        {
+            // returning the slot clears the channel error, so it is taken first
+
+            rpc->error = rpc->channel->error;
+            xchg_channel_return(rpc->channel, &response);
+
+            if(nr_completed != NULL)
+            {
+                *nr_completed = completed;
+            }
+
+            return false;
+        }
+
+        uint64_t id = 0;
+        struct xchg_rpc_call *call = NULL;
+
+        if(xchg_message_read_uint64(&response, &id) && id != 0)
+        {
+            call = &rpc->calls[id & rpc->mask];
+        }
+
+        if(call == NULL || call->id != id)
+        {
+            xchg_channel_return(rpc->channel, &response);
+
+            if(nr_completed != NULL)
+            {
+                *nr_completed = completed;
+            }
+
+            rpc->error = "response has an unknown correlation id";
+            return false;
+        }
+
+        // the slot is released before the callback runs so that the callback may issue further calls
+
+        xchg_rpc_callback callback = call->callback;
+        void *context = call->context;
+        call->id = 0;
+        rpc->nr_pending -= 1;
+
+        callback(context, &response);
+
+        xchg_channel_return(rpc->channel, &response);
+        completed += 1;
+    }
+
+    if(nr_completed != NULL)
+    {
+        *nr_completed = completed;
+    }
+
+    rpc->error = NULL;
+    return true;
+}
+
+size_t xchg_rpc_pending(const struct xchg_rpc *rpc)
+{
+    if(unlikely(rpc == NULL))
+    {
+        return 0;
+    }
+
+    return rpc->nr_pending;
+}
+
+bool xchg_rpc_receive(struct xchg_rpc *rpc, struct xchg_message *message, uint64_t *id)
+{
+    if(unlikely(rpc == NULL || message == NULL || id == NULL))
+    {
+        return false;
+    }
+
+    if(!xchg_channel_receive(rpc->channel, message))
+    {
+        rpc->error = rpc->channel->error;
+        return false;
+    }
+
+    if(!xchg_message_read_uint64(message, id) || *id == 0)
+    {
+        rpc->error = "request has no correlation id";
+        return false;
+    }
+
+    rpc->error = NULL;
+    return true;
+}
+
+bool xchg_rpc_return(struct xchg_rpc *rpc, const struct xchg_message *message)
+{
+    if(unlikely(rpc == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(!xchg_channel_return(rpc->channel, message))
+    {
+        rpc->error = rpc->channel->error;
+        return false;
+    }
+
+    rpc->error = NULL;
+    return true;
+}
+
+bool xchg_rpc_reply_prepare(struct xchg_rpc *rpc, struct xchg_message *message, uint64_t id)
+{
+    if(unlikely(rpc == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(unlikely(id == 0))
+    {
+        rpc->error = "correlation id is invalid";
+        return false;
+    }
+
+    if(!xchg_channel_prepare(rpc->channel, message))
+    {
+        rpc->error = rpc->channel->error;
+        return false;
+    }
+
+    if(!xchg_message_write_uint64(message, id))
+    {
+        rpc->error = message->error;
+        return false;
+    }
+
+    rpc->error = NULL;
+    return true;
+}
+
+bool xchg_rpc_reply(struct xchg_rpc *rpc, const struct xchg_message *message)
+{
+    if(unlikely(rpc == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(!xchg_channel_send(rpc->channel, message))
+    {
+        rpc->error = rpc->channel->error;
+        return false;
+    }
+
+    rpc->error = NULL;
+    return true;
+}
+
+const char *xchg_rpc_strerror(const struct xchg_rpc *rpc)
+{
+    if(unlikely(rpc == NULL))
+    {
+        return false;
+    }
+
+    return rpc->error;
+}
+
+bool xchg_channel_set_notify(struct xchg_channel *channel, char *bitmap, size_t sz_bitmap, size_t index)
+{
+    if(unlikely(channel == NULL))
+    {
+        return false;
+    }
+
+    if(bitmap == NULL)
+    {
+        channel->notify = NULL;
+        channel->notify_mask = 0;
+        channel->error = NULL;
+        return true;
+    }
+
+    if(sz_bitmap < XCHG_POLLER_SIZE || ((uintptr_t)bitmap % sizeof(uint64_t)) != 0)
+    {
+        channel->error = "poller bitmap is invalid";
+        return false;
+    }
+
+    if(index >= XCHG_POLLER_MAX)
+    {
+        channel->error = "poller index is invalid";
+        return false;
+    }
+
+    channel->notify = &((volatile uint64_t *)bitmap)[index / 64];
+    channel->notify_mask = (uint64_t)1 << (index % 64);
+
+    channel->error = NULL;
+    return true;
+}
+
+bool xchg_poller_init(struct xchg_poller *poller, enum xchg_poller_policy policy,
+                      char *bitmap, size_t sz_bitmap,
+                      struct xchg_channel *channels[], size_t nr_channels)
+{
+    if(unlikely(poller == NULL || bitmap == NULL || channels == NULL))
+    {
+        return false;
+    }
+
+    if(policy != xchg_poller_policy_fair && policy != xchg_poller_policy_priority)
+    {
+        poller->error = "poller policy is invalid";
+        return false;
+    }
+
+    if(sz_bitmap < XCHG_POLLER_SIZE || ((uintptr_t)bitmap % sizeof(uint64_t)) != 0)
+    {
+        poller->error = "poller bitmap is invalid";
+        return false;
+    }
+
+    if(nr_channels == 0 || nr_channels > XCHG_POLLER_MAX)
+    {
+        poller->error = "number of channels is invalid";
+        return false;
+    }
+
+    for(size_t i = 0; i < nr_channels; i++)
+    {
+        if(channels[i] == NULL || channels[i]->ingress.data == NULL)
+        {
+            poller->error = "channel has no ingress";
+            return false;
+        }
+    }
+
+    poller->bitmap = (volatile uint64_t *)bitmap;
+    poller->channels = channels;
+    poller->nr_channels = nr_channels;
+    poller->policy = policy;
+    poller->cursor = 0;
+
+    for(size_t i = 0; i < XCHG_POLLER_SIZE / sizeof(uint64_t); i++)
+    {
+        uint64_t bits = (nr_channels >= (i + 1) * 64) ? ~(uint64_t)0
+                      : (nr_channels > i * 64) ? ((uint64_t)1 << (nr_channels % 64)) - 1
+                      : 0;
+        atomic_store((_Atomic uint64_t *)&poller->bitmap[i], bits);
+    }
+
+    poller->error = NULL;
+    return true;
+}
+
+static bool poller_next(struct xchg_poller *poller, size_t start, size_t *index)
+{
+    size_t nr_words = (poller->nr_channels + 63) / 64;
+
+    for(size_t i = 0; i <= nr_words; i++)
+    {
+        size_t word = ((start / 64) + i) % nr_words;
+        uint64_t bits = poller->bitmap[word];
+
+        if(i == 0)
+        {
+            bits &= ~(uint64_t)0 << (start % 64);
+        }
+        else if(i == nr_words)
+        {
+            bits &= ((uint64_t)1 << (start % 64)) - 1;
+        }
+
+        if(word == nr_words - 1 && poller->nr_channels % 64 != 0)
+        {
+            bits &= ((uint64_t)1 << (poller->nr_channels % 64)) - 1;
+        }
+
+        if(bits != 0)
+        {
+            *index = (word * 64) + (size_t)__builtin_ctzll(bits);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool xchg_poller_receive(struct xchg_poller *poller, struct xchg_channel **channel, struct xchg_message *message)
+{
+    if(unlikely(poller == NULL || channel == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    size_t start = (poller->policy == xchg_poller_policy_fair) ? poller->cursor : 0;
+    size_t index = 0;
+
+    while(poller_next(poller, start, &index))
+    {
+        struct xchg_channel *candidate = poller->channels[index];
+        struct xchg_ring *ring = &candidate->ingress;
+        volatile uint64_t *word = &poller->bitmap[index / 64];
+        uint64_t mask = (uint64_t)1 << (index % 64);
+
+        if(nr_used(ring, ring->sz_message) < ring->sz_message)
+        {
+            // the ring looks drained, so clear its readiness bit and then check once more to close the race with
+            // a producer which published a message before observing the bit as cleared
+
+            atomic_fetch_and((_Atomic uint64_t *)word, ~mask);
+
+            if(nr_used(ring, ring->sz_message) < ring->sz_message)
+            {
+                continue;
+            }
+
+            atomic_fetch_or((_Atomic uint64_t *)word, mask);
+        }
+
+        poller->cursor = (index + 1) % poller->nr_channels;
+        *channel = candidate;
+
+        if(unlikely(!xchg_channel_receive(candidate, message)))
+        {
+            poller->error = candidate->error;
+            return false;
+        }
+
+        poller->error = NULL;
+        return true;
+    }
+
+    poller->error = "poller is empty";
+    return false;
+}
+
+const char *xchg_poller_strerror(const struct xchg_poller *poller)
+{
+    if(unlikely(poller == NULL))
+    {
+        return false;
+    }
+
+    return poller->error;
+}
+
+// header at the start of a recording buffer. The used size is only advanced once a record is complete, so a reader
+// never sees a partial record, and a recorder that crashed mid-record resumes from the last complete one
+
+struct xchg_recording_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sz_used;
+    uint64_t nr_records;
+    uint64_t segment;  // index of the journal segment, always zero for a recording
+    uint64_t sequence;  // sequence of the first record, always zero for a recording
+    uint64_t sealed;  // set once a journal has rolled over to the next segment
+    uint64_t reserved[2];
+};
+
+#define XCHG_RECORDING_MAGIC 0x43455258u  // "XREC"
+
+static_assert(sizeof(struct xchg_recording_header) == XCHG_RECORDING_HEADER_SIZE, "recording header size is wrong");
+static_assert(sizeof(struct xchg_record) % 8 == 0, "record size is not a multiple of 8 bytes");
+
+static uint64_t realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+static char *recording_validate(const char *buffer, size_t sz_buffer, size_t *sz_used)
+{
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)buffer;
+
+    if(sz_buffer <= XCHG_RECORDING_HEADER_SIZE ||
+       atomic_load_explicit((_Atomic uint32_t *)&header->magic, memory_order_acquire) != XCHG_RECORDING_MAGIC)
+    {
+        return "recording header is missing";
+    }
+
+    if(header->version != XCHG_RECORDING_VERSION)
+    {
+        return "recording header version is unsupported";
+    }
+
+    size_t used = (size_t)atomic_load_explicit((_Atomic uint64_t *)&header->sz_used, memory_order_acquire);
+
+    if(used < XCHG_RECORDING_HEADER_SIZE || used > sz_buffer)
+    {
+        return "recording size does not match recording header";
+    }
+
+    *sz_used = used;
+    return NULL;
+}
+
+// writes an empty recording header into buffer, publishing the magic last so that a reader never sees it half done
+
+static void recording_start(char *buffer, uint64_t segment, uint64_t sequence)
+{
+    struct xchg_recording_header *header = (struct xchg_recording_header *)buffer;
+
+    atomic_store((_Atomic uint32_t *)&header->magic, 0);
+    memset(buffer, 0, XCHG_RECORDING_HEADER_SIZE);
+
+    header->version = XCHG_RECORDING_VERSION;
+    header->sz_used = XCHG_RECORDING_HEADER_SIZE;
+    header->nr_records = 0;
+    header->segment = segment;
+    header->sequence = sequence;
+
+    atomic_store_explicit((_Atomic uint32_t *)&header->magic, XCHG_RECORDING_MAGIC, memory_order_release);
+}
+
+// the record count is not published together with the used size, so a writer which crashed mid-append could leave
+// it off by one; resuming counts the complete records instead
+
+static uint64_t recording_next_sequence(const char *buffer, size_t sz_used)
+{
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)buffer;
+    uint64_t sequence = header->sequence;
+
+    for(size_t position = XCHG_RECORDING_HEADER_SIZE; position + sizeof(struct xchg_record) <= sz_used;)
+    {
+        struct xchg_record record;
+        memcpy(&record, buffer + position, sizeof(record));
+
+        position += align_up(sizeof(record) + record.length, 8);
+        sequence += 1;
+    }
+
+    return sequence;
+}
+
+bool xchg_recorder_init(struct xchg_recorder *recorder, char *buffer, size_t sz_buffer)
+{
+    if(unlikely(recorder == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    if(((uintptr_t)buffer % 8) != 0 || sz_buffer <= XCHG_RECORDING_HEADER_SIZE)
+    {
+        recorder->error = "recording buffer is invalid";
+        return false;
+    }
+
+    struct xchg_recording_header *header = (struct xchg_recording_header *)buffer;
+    size_t sz_used = XCHG_RECORDING_HEADER_SIZE;
+
+    // only a buffer which has never held a recording is started afresh, anything else must be a valid recording so
+    // that an existing capture is never overwritten
+
+    if(atomic_load_explicit((_Atomic uint32_t *)&header->magic, memory_order_acquire) != XCHG_RECORDING_MAGIC)
+    {
+        recording_start(buffer, 0, 0);
+    }
+    else
+    {
+        char *error = recording_validate(buffer, sz_buffer, &sz_used);
+
+        if(error != NULL)
+        {
+            recorder->error = error;
+            return false;
+        }
+    }
+
+    recorder->buffer = buffer;
+    recorder->sz_buffer = sz_buffer;
+    recorder->position = sz_used;
+    recorder->sequence = recording_next_sequence(buffer, sz_used);
+    recorder->index = NULL;
+
+    recorder->error = NULL;
+    return true;
+}
+
+bool xchg_recorder_record(struct xchg_recorder *recorder, const struct xchg_message *message, uint32_t type)
+{
+    if(unlikely(recorder == NULL || recorder->buffer == NULL || message == NULL || message->data == NULL))
+    {
+        return false;
+    }
+
+    size_t sz_record = align_up(sizeof(struct xchg_record) + message->length, 8);
+
+    if(message->length > UINT32_MAX || sz_record > recorder->sz_buffer - recorder->position)
+    {
+        recorder->error = "recording is full";
+        return false;
+    }
+
+    struct xchg_record record = {
+        .timestamp = realtime_ns(),
+        .sequence = recorder->sequence,
+        .length = (uint32_t)message->length,
+        .type = type,
+    };
+
+    size_t offset = recorder->position;
+    char *data = recorder->buffer + offset;
+    memcpy(data, &record, sizeof(record));
+    memcpy(data + sizeof(record), message->data, message->length);
+
+    recorder->position += sz_record;
+    recorder->sequence += 1;
+
+    struct xchg_recording_header *header = (struct xchg_recording_header *)recorder->buffer;
+    atomic_store_explicit((_Atomic uint64_t *)&header->nr_records, recorder->sequence, memory_order_relaxed);
+    atomic_store_explicit((_Atomic uint64_t *)&header->sz_used, recorder->position, memory_order_release);
+
+    if(recorder->index != NULL)
+    {
+        xchg_index_add(recorder->index, &record, 0, offset);
+    }
+
+    recorder->error = NULL;
+    return true;
+}
+
+bool xchg_recorder_drain(struct xchg_recorder *recorder, struct xchg_channel *channel, size_t *nr_recorded)
+{
+    if(unlikely(recorder == NULL || channel == NULL))
+    {
+        return false;
+    }
+
+    size_t nr = 0;
+    struct xchg_message message;
+    bool drained = true;
+
+    for(;;)
+    {
+        message.data = NULL;
+
+        if(!xchg_channel_receive(channel, &message))
+        {
+            if(message.data != NULL)
+            {
+                // a message that failed validation is still consumed, so that one corrupt message does not stall
+                // the tap
+
+                xchg_channel_return(channel, &message);
+                recorder->error = "channel message failed validation";
+                drained = false;
+            }
+            else if(channel->ingress.data == NULL)
+            {
+                recorder->error = "channel has no ingress";
+                drained = false;
+            }
+            break;
+        }
+
+        struct xchg_header header = { 0 };
+
+        if(channel->flags & xchg_channel_flag_header)
+        {
+            xchg_channel_header(channel, &message, &header);
+        }
+
+        if(!xchg_recorder_record(recorder, &message, header.type))
+        {
+            drained = false;
+            break;
+        }
+
+        xchg_channel_return(channel, &message);
+        nr += 1;
+    }
+
+    if(nr_recorded != NULL)
+    {
+        *nr_recorded = nr;
+    }
+
+    if(drained)
+    {
+        recorder->error = NULL;
+    }
+
+    return drained;
+}
+
+const char *xchg_recorder_strerror(const struct xchg_recorder *recorder)
+{
+    if(unlikely(recorder == NULL))
+    {
+        return false;
+    }
+
+    return recorder->error;
+}
+
+bool xchg_replayer_init(struct xchg_replayer *replayer, const char *buffer, size_t sz_buffer)
+{
+    if(unlikely(replayer == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    size_t sz_used = 0;
+    char *error = recording_validate(buffer, sz_buffer, &sz_used);
+
+    if(error != NULL)
+    {
+        replayer->error = error;
+        return false;
+    }
+
+    replayer->buffer = buffer;
+    replayer->sz_buffer = sz_buffer;
+    replayer->position = XCHG_RECORDING_HEADER_SIZE;
+    replayer->origin = 0;
+    replayer->start = 0;
+
+    replayer->error = NULL;
+    return true;
+}
+
+// loads the record at the replayer's position without advancing past it, if the recorder has completed it
+
+static bool replayer_peek(struct xchg_replayer *replayer, struct xchg_record *record, size_t *sz_record)
+{
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)replayer->buffer;
+    size_t sz_used = (size_t)atomic_load_explicit((_Atomic uint64_t *)&header->sz_used, memory_order_acquire);
+
+    if(sz_used > replayer->sz_buffer || replayer->position + sizeof(struct xchg_record) > sz_used)
+    {
+        replayer->error = "recording has no more records";
+        return false;
+    }
+
+    memcpy(record, replayer->buffer + replayer->position, sizeof(struct xchg_record));
+    *sz_record = align_up(sizeof(struct xchg_record) + record->length, 8);
+
+    if(*sz_record > sz_used - replayer->position)
+    {
+        replayer->error = "recording is corrupt";
+        return false;
+    }
+
+    return true;
+}
+
+bool xchg_replayer_read(struct xchg_replayer *replayer, struct xchg_record *record, const char **payload)
+{
+    if(unlikely(replayer == NULL || replayer->buffer == NULL || record == NULL || payload == NULL))
+    {
+        return false;
+    }
+
+    size_t sz_record = 0;
+
+    if(!replayer_peek(replayer, record, &sz_record))
+    {
+        return false;
+    }
+
+    *payload = replayer->buffer + replayer->position + sizeof(struct xchg_record);
+    replayer->position += sz_record;
+
+    replayer->error = NULL;
+    return true;
+}
+
+bool xchg_replayer_send(struct xchg_replayer *replayer, struct xchg_channel *channel, double speed, size_t *nr_sent)
+{
+    if(unlikely(replayer == NULL || replayer->buffer == NULL || channel == NULL))
+    {
+        return false;
+    }
+
+    if(!(speed >= 0.0))
+    {
+        replayer->error = "replay speed is invalid";
+        return false;
+    }
+
+    size_t nr = 0;
+    bool more = true;
+    uint64_t now = speed != 0.0 ? monotonic_ns() : 0;
+
+    for(;;)
+    {
+        struct xchg_record record;
+        size_t sz_record = 0;
+
+        if(!replayer_peek(replayer, &record, &sz_record))
+        {
+            more = false;
+            break;
+        }
+
+        if(speed != 0.0)
+        {
+            if(replayer->start == 0)
+            {
+                replayer->start = now;
+                replayer->origin = record.timestamp;
+            }
+
+            // a message is due once as much time has passed since the first send as passed between the first
+            // record and this one, scaled by the replay speed
+
+            uint64_t offset = record.timestamp > replayer->origin ? record.timestamp - replayer->origin : 0;
+
+            if((double)(now - replayer->start) * speed < (double)offset)
+            {
+                break;
+            }
+        }
+
+        struct xchg_message message;
+
+        if(!xchg_channel_prepare(channel, &message))
+        {
+            if(channel->egress.data == NULL)
+            {
+                replayer->error = "channel has no egress";
+                more = false;
+            }
+            break;
+        }
+
+        if(record.length > message.length)
+        {
+            replayer->error = "recorded message is too large for channel";
+            more = false;
+            break;
+        }
+
+        memcpy(message.data, replayer->buffer + replayer->position + sizeof(struct xchg_record), record.length);
+        message.position = record.length;
+
+        xchg_channel_send_typed(channel, &message, record.type);
+
+        replayer->position += sz_record;
+        nr += 1;
+    }
+
+    if(nr_sent != NULL)
+    {
+        *nr_sent = nr;
+    }
+
+    if(more)
+    {
+        replayer->error = NULL;
+    }
+
+    return more;
+}
+
+bool xchg_replayer_rewind(struct xchg_replayer *replayer)
+{
+    if(unlikely(replayer == NULL || replayer->buffer == NULL))
+    {
+        return false;
+    }
+
+    replayer->position = XCHG_RECORDING_HEADER_SIZE;
+    replayer->origin = 0;
+    replayer->start = 0;
+
+    replayer->error = NULL;
+    return true;
+}
+
+const char *xchg_replayer_strerror(const struct xchg_replayer *replayer)
+{
+    if(unlikely(replayer == NULL))
+    {
+        return false;
+    }
+
+    return replayer->error;
+}
+
+bool xchg_journal_init(struct xchg_journal *journal, char *segment, size_t sz_segment)
+{
+    if(unlikely(journal == NULL || segment == NULL))
+    {
+        return false;
+    }
+
+    if(((uintptr_t)segment % 8) != 0 || sz_segment <= XCHG_RECORDING_HEADER_SIZE)
+    {
+        journal->error = "journal segment is invalid";
+        return false;
+    }
+
+    struct xchg_recording_header *header = (struct xchg_recording_header *)segment;
+    size_t sz_used = XCHG_RECORDING_HEADER_SIZE;
+
+    if(atomic_load_explicit((_Atomic uint32_t *)&header->magic, memory_order_acquire) != XCHG_RECORDING_MAGIC)
+    {
+        recording_start(segment, 0, 0);
+    }
+    else
+    {
+        char *error = recording_validate(segment, sz_segment, &sz_used);
+
+        if(error != NULL)
+        {
+            journal->error = error;
+            return false;
+        }
+    }
+
+    journal->segment = segment;
+    journal->sz_segment = sz_segment;
+    journal->position = sz_used;
+    journal->segment_index = header->segment;
+    journal->sequence = recording_next_sequence(segment, sz_used);
+    journal->writable = true;
+    journal->index = NULL;
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_journal_open(struct xchg_journal *journal, const char *segment, size_t sz_segment)
+{
+    if(unlikely(journal == NULL || segment == NULL))
+    {
+        return false;
+    }
+
+    size_t sz_used = 0;
+    char *error = recording_validate(segment, sz_segment, &sz_used);
+
+    if(error != NULL)
+    {
+        journal->error = error;
+        return false;
+    }
+
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)segment;
+
+    journal->segment = (char *)segment;
+    journal->sz_segment = sz_segment;
+    journal->position = XCHG_RECORDING_HEADER_SIZE;
+    journal->segment_index = header->segment;
+    journal->sequence = header->sequence;
+    journal->writable = false;
+    journal->index = NULL;
+
+    journal->error = NULL;
+    return true;
+}
+
+// loads the number of bytes of the current segment which hold complete messages, and whether the writer has since
+// moved on to the next segment, in which case that number is final
+
+static size_t journal_used(const struct xchg_journal *journal, bool *sealed)
+{
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)journal->segment;
+
+    *sealed = atomic_load_explicit((_Atomic uint64_t *)&header->sealed, memory_order_acquire) != 0;
+    return (size_t)atomic_load_explicit((_Atomic uint64_t *)&header->sz_used, memory_order_acquire);
+}
+
+bool xchg_journal_roll(struct xchg_journal *journal, char *segment, size_t sz_segment)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL || segment == NULL))
+    {
+        return false;
+    }
+
+    struct xchg_recording_header *header = (struct xchg_recording_header *)journal->segment;
+
+    if(journal->writable)
+    {
+        if(((uintptr_t)segment % 8) != 0 || sz_segment <= XCHG_RECORDING_HEADER_SIZE)
+        {
+            journal->error = "journal segment is invalid";
+            return false;
+        }
+
+        // the current segment is sealed before the next one exists, so a writer which restarts in between finds
+        // the newest segment sealed, can only roll it over, and starts the next segment again from its header
+
+        atomic_store_explicit((_Atomic uint64_t *)&header->sealed, 1, memory_order_release);
+        recording_start(segment, journal->segment_index + 1, journal->sequence);
+
+        journal->position = XCHG_RECORDING_HEADER_SIZE;
+    }
+    else
+    {
+        bool sealed = false;
+        size_t sz_used = journal_used(journal, &sealed);
+
+        if(!sealed || journal->position != sz_used)
+        {
+            journal->error = "journal segment is not finished";
+            return false;
+        }
+
+        size_t sz_next = 0;
+        char *error = recording_validate(segment, sz_segment, &sz_next);
+
+        if(error != NULL)
+        {
+            journal->error = error;
+            return false;
+        }
+
+        const struct xchg_recording_header *next = (const struct xchg_recording_header *)segment;
+
+        if(next->segment != journal->segment_index + 1 || next->sequence != journal->sequence)
+        {
+            journal->error = "journal segment is out of order";
+            return false;
+        }
+
+        journal->position = XCHG_RECORDING_HEADER_SIZE;
+    }
+
+    journal->segment = segment;
+    journal->sz_segment = sz_segment;
+    journal->segment_index += 1;
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_journal_prepare(struct xchg_journal *journal, struct xchg_message *message)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(!journal->writable)
+    {
+        journal->error = "journal is not open for writing";
+        return false;
+    }
+
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)journal->segment;
+
+    if(atomic_load_explicit((_Atomic uint64_t *)&header->sealed, memory_order_relaxed) != 0)
+    {
+        journal->error = "journal segment is sealed";
+        return false;
+    }
+
+    size_t sz_free = (journal->sz_segment - journal->position) & ~(size_t)7;
+
+    if(sz_free <= sizeof(struct xchg_record))
+    {
+        journal->error = "journal segment is full";
+        return false;
+    }
+
+    size_t length = sz_free - sizeof(struct xchg_record);
+
+    message->data = journal->segment + journal->position + sizeof(struct xchg_record);
+    message->length = length < UINT32_MAX ? length : UINT32_MAX;
+    message->position = 0;
+    message->streaming = 0;
+    message->error = NULL;
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_journal_send(struct xchg_journal *journal, const struct xchg_message *message, uint32_t type)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(!journal->writable)
+    {
+        journal->error = "journal is not open for writing";
+        return false;
+    }
+
+    char *data = journal->segment + journal->position;
+    size_t sz_record = align_up(sizeof(struct xchg_record) + message->position, 8);
+
+    if(unlikely(message->data != data + sizeof(struct xchg_record) || message->position > UINT32_MAX ||
+                sz_record > journal->sz_segment - journal->position))
+    {
+        journal->error = "message is invalid";
+        return false;
+    }
+
+    struct xchg_record record = {
+        .timestamp = realtime_ns(),
+        .sequence = journal->sequence,
+        .length = (uint32_t)message->position,
+        .type = type,
+    };
+    memcpy(data, &record, sizeof(record));
+
+    size_t offset = journal->position;
+    journal->position += sz_record;
+    journal->sequence += 1;
+
+    struct xchg_recording_header *header = (struct xchg_recording_header *)journal->segment;
+    atomic_store_explicit((_Atomic uint64_t *)&header->nr_records, journal->sequence - header->sequence,
+                          memory_order_relaxed);
+    atomic_store_explicit((_Atomic uint64_t *)&header->sz_used, journal->position, memory_order_release);
+
+    if(journal->index != NULL)
+    {
+        xchg_index_add(journal->index, &record, journal->segment_index, offset);
+    }
+
+    journal->error = NULL;
+    return true;
+}
+
+// loads the record at the reader's cursor, if the writer has completed it, checking that it is the one expected
+
+static bool journal_peek(struct xchg_journal *journal, struct xchg_record *record, size_t *sz_record)
+{
+    bool sealed = false;
+    size_t sz_used = journal_used(journal, &sealed);
+
+    if(sz_used > journal->sz_segment || journal->position + sizeof(struct xchg_record) > sz_used)
+    {
+        journal->error = sealed ? "journal segment is sealed" : "journal has no more messages";
+        return false;
+    }
+
+    memcpy(record, journal->segment + journal->position, sizeof(struct xchg_record));
+    *sz_record = align_up(sizeof(struct xchg_record) + record->length, 8);
+
+    if(*sz_record > sz_used - journal->position || record->sequence != journal->sequence)
+    {
+        journal->error = "journal is corrupt";
+        return false;
+    }
+
+    return true;
+}
+
+bool xchg_journal_receive(struct xchg_journal *journal, struct xchg_message *message)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    if(journal->writable)
+    {
+        journal->error = "journal is not open for reading";
+        return false;
+    }
+
+    struct xchg_record record;
+    size_t sz_record = 0;
+
+    if(!journal_peek(journal, &record, &sz_record))
+    {
+        return false;
+    }
+
+    // an empty message is still received, so this does not go through xchg_message_init
+
+    message->data = journal->segment + journal->position + sizeof(struct xchg_record);
+    message->length = record.length;
+    message->position = 0;
+    message->streaming = 0;
+    message->error = NULL;
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_journal_record(struct xchg_journal *journal, const struct xchg_message *message,
+                         struct xchg_record *record)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL || message == NULL || record == NULL))
+    {
+        return false;
+    }
+
+    const char *data = journal->segment + journal->position;
+
+    if(journal->writable || message->data != data + sizeof(struct xchg_record))
+    {
+        journal->error = "message is invalid";
+        return false;
+    }
+
+    memcpy(record, data, sizeof(struct xchg_record));
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_journal_return(struct xchg_journal *journal, const struct xchg_message *message)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL || message == NULL))
+    {
+        return false;
+    }
+
+    const char *data = journal->segment + journal->position;
+    struct xchg_record record;
+
+    if(journal->writable || message->data != data + sizeof(struct xchg_record))
+    {
+        journal->error = "message is invalid";
+        return false;
+    }
+
+    memcpy(&record, data, sizeof(struct xchg_record));
+
+    journal->position += align_up(sizeof(struct xchg_record) + record.length, 8);
+    journal->sequence += 1;
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_journal_tell(const struct xchg_journal *journal, uint64_t *segment, size_t *offset, uint64_t *sequence)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL))
+    {
+        return false;
+    }
+
+    if(segment != NULL)
+    {
+        *segment = journal->segment_index;
+    }
+
+    if(offset != NULL)
+    {
+        *offset = journal->position;
+    }
+
+    if(sequence != NULL)
+    {
+        *sequence = journal->sequence;
+    }
+
+    return true;
+}
+
+bool xchg_journal_seek(struct xchg_journal *journal, size_t offset, uint64_t sequence)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL))
+    {
+        return false;
+    }
+
+    if(journal->writable)
+    {
+        journal->error = "journal is not open for reading";
+        return false;
+    }
+
+    bool sealed = false;
+    size_t sz_used = journal_used(journal, &sealed);
+
+    if((offset % 8) != 0 || offset < XCHG_RECORDING_HEADER_SIZE || offset > sz_used || sz_used > journal->sz_segment)
+    {
+        journal->error = "journal offset is invalid";
+        return false;
+    }
+
+    // an offset within the written messages must land on the record carrying the expected sequence, which catches
+    // offsets that were saved against a different segment
+
+    if(offset < sz_used)
+    {
+        struct xchg_record record;
+
+        if(offset + sizeof(struct xchg_record) > sz_used)
+        {
+            journal->error = "journal offset is invalid";
+            return false;
+        }
+
+        memcpy(&record, journal->segment + offset, sizeof(struct xchg_record));
+
+        if(record.sequence != sequence)
+        {
+            journal->error = "journal offset is invalid";
+            return false;
+        }
+    }
+
+    journal->position = offset;
+    journal->sequence = sequence;
+
+    journal->error = NULL;
+    return true;
+}
+
+const char *xchg_journal_strerror(const struct xchg_journal *journal)
+{
+    if(unlikely(journal == NULL))
+    {
+        return false;
+    }
+
+    return journal->error;
+}
+
+// header at the start of an index buffer. Each entry is written before the entry count is advanced, so a search
+// never sees a partial entry
+
+struct xchg_index_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t interval;
+    uint64_t nr_entries;
+    uint64_t reserved[5];
+};
+
+#define XCHG_INDEX_MAGIC 0x58444958u  // "XIDX"
+
+static_assert(sizeof(struct xchg_index_header) == XCHG_INDEX_HEADER_SIZE, "index header size is wrong");
+static_assert(sizeof(struct xchg_index_entry) % 8 == 0, "index entry size is not a multiple of 8 bytes");
+
+static char *index_validate(const char *buffer, size_t sz_buffer, size_t *nr_entries)
+{
+    const struct xchg_index_header *header = (const struct xchg_index_header *)buffer;
+
+    if(sz_buffer < XCHG_INDEX_HEADER_SIZE + sizeof(struct xchg_index_entry) ||
+       atomic_load_explicit((_Atomic uint32_t *)&header->magic, memory_order_acquire) != XCHG_INDEX_MAGIC)
+    {
+        return "index header is missing";
+    }
+
+    if(header->version != XCHG_INDEX_VERSION || header->interval == 0)
+    {
+        return "index header version is unsupported";
+    }
+
+    size_t nr = (size_t)atomic_load_explicit((_Atomic uint64_t *)&header->nr_entries, memory_order_acquire);
+
+    if(nr > (sz_buffer - XCHG_INDEX_HEADER_SIZE) / sizeof(struct xchg_index_entry))
+    {
+        return "index size does not match index header";
+    }
+
+    *nr_entries = nr;
+    return NULL;
+}
+
+bool xchg_index_init(struct xchg_index *index, char *buffer, size_t sz_buffer, uint64_t interval)
+{
+    if(unlikely(index == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    if(((uintptr_t)buffer % 8) != 0 || sz_buffer < XCHG_INDEX_HEADER_SIZE + sizeof(struct xchg_index_entry))
+    {
+        index->error = "index buffer is invalid";
+        return false;
+    }
+
+    if(interval == 0)
+    {
+        index->error = "index interval is invalid";
+        return false;
+    }
+
+    struct xchg_index_header *header = (struct xchg_index_header *)buffer;
+    size_t nr_entries = 0;
+
+    // only a buffer which has never held an index is started afresh, anything else must be a valid index so that
+    // existing entries are never overwritten
+
+    if(atomic_load_explicit((_Atomic uint32_t *)&header->magic, memory_order_acquire) != XCHG_INDEX_MAGIC)
+    {
+        memset(buffer, 0, XCHG_INDEX_HEADER_SIZE);
+
+        header->version = XCHG_INDEX_VERSION;
+        header->interval = interval;
+        header->nr_entries = 0;
+
+        atomic_store_explicit((_Atomic uint32_t *)&header->magic, XCHG_INDEX_MAGIC, memory_order_release);
+    }
+    else
+    {
+        char *error = index_validate(buffer, sz_buffer, &nr_entries);
+
+        if(error != NULL)
+        {
+            index->error = error;
+            return false;
+        }
+
+        if(header->interval != interval)
+        {
+            index->error = "index interval does not match index header";
+            return false;
+        }
+    }
+
+    index->buffer = buffer;
+    index->sz_buffer = sz_buffer;
+    index->interval = interval;
+    index->nr_entries = nr_entries;
+    index->writable = true;
+
+    index->error = NULL;
+    return true;
+}
+
+bool xchg_index_open(struct xchg_index *index, const char *buffer, size_t sz_buffer)
+{
+    if(unlikely(index == NULL || buffer == NULL))
+    {
+        return false;
+    }
+
+    size_t nr_entries = 0;
+    char *error = index_validate(buffer, sz_buffer, &nr_entries);
+
+    if(error != NULL)
+    {
+        index->error = error;
+        return false;
+    }
+
+    index->buffer = (char *)buffer;
+    index->sz_buffer = sz_buffer;
+    index->interval = ((const struct xchg_index_header *)buffer)->interval;
+    index->nr_entries = nr_entries;
+    index->writable = false;
+
+    index->error = NULL;
+    return true;
+}
+
+bool xchg_index_add(struct xchg_index *index, const struct xchg_record *record, uint64_t segment, size_t offset)
+{
+    if(unlikely(index == NULL || index->buffer == NULL || record == NULL))
+    {
+        return false;
+    }
+
+    if(!index->writable)
+    {
+        index->error = "index is not open for writing";
+        return false;
+    }
+
+    if(record->sequence % index->interval != 0)
+    {
+        index->error = NULL;
+        return true;
+    }
+
+    struct xchg_index_entry *entries = (struct xchg_index_entry *)(index->buffer + XCHG_INDEX_HEADER_SIZE);
+
+    // entries must be sorted for the binary search, which also keeps a restarted writer from indexing a message
+    // twice
+
+    if(index->nr_entries > 0 && record->sequence <= entries[index->nr_entries - 1].sequence)
+    {
+        index->error = "index sequence is out of order";
+        return false;
+    }
+
+    if(index->nr_entries >= (index->sz_buffer - XCHG_INDEX_HEADER_SIZE) / sizeof(struct xchg_index_entry))
+    {
+        index->error = "index is full";
+        return false;
+    }
+
+    // the realtime clock may be stepped back, but the search by time needs timestamps which never decrease
+
+    uint64_t timestamp = record->timestamp;
+
+    if(index->nr_entries > 0 && timestamp < entries[index->nr_entries - 1].timestamp)
+    {
+        timestamp = entries[index->nr_entries - 1].timestamp;
+    }
+
+    entries[index->nr_entries] = (struct xchg_index_entry){
+        .sequence = record->sequence,
+        .timestamp = timestamp,
+        .segment = segment,
+        .offset = offset,
+    };
+    index->nr_entries += 1;
+
+    struct xchg_index_header *header = (struct xchg_index_header *)index->buffer;
+    atomic_store_explicit((_Atomic uint64_t *)&header->nr_entries, index->nr_entries, memory_order_release);
+
+    index->error = NULL;
+    return true;
+}
+
+// finds the last entry whose key is at or before target, reading the entry count once so that a search over an
+// index which is still being written only considers complete entries
+
+static bool index_search(struct xchg_index *index, uint64_t target, bool by_time, struct xchg_index_entry *entry)
+{
+    const struct xchg_index_header *header = (const struct xchg_index_header *)index->buffer;
+    const struct xchg_index_entry *entries = (const struct xchg_index_entry *)(index->buffer + XCHG_INDEX_HEADER_SIZE);
+
+    size_t nr = (size_t)atomic_load_explicit((_Atomic uint64_t *)&header->nr_entries, memory_order_acquire);
+    size_t max = (index->sz_buffer - XCHG_INDEX_HEADER_SIZE) / sizeof(struct xchg_index_entry);
+    size_t lo = 0;
+    size_t hi = nr < max ? nr : max;
+
+    while(lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t key = by_time ? entries[mid].timestamp : entries[mid].sequence;
+
+        if(key <= target)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if(lo == 0)
+    {
+        index->error = "index has no entry at or before the target";
+        return false;
+    }
+
+    *entry = entries[lo - 1];
+
+    index->error = NULL;
+    return true;
+}
+
+bool xchg_index_seek_sequence(struct xchg_index *index, uint64_t sequence, struct xchg_index_entry *entry)
+{
+    if(unlikely(index == NULL || index->buffer == NULL || entry == NULL))
+    {
+        return false;
+    }
+
+    return index_search(index, sequence, false, entry);
+}
+
+bool xchg_index_seek_time(struct xchg_index *index, uint64_t timestamp, struct xchg_index_entry *entry)
+{
+    if(unlikely(index == NULL || index->buffer == NULL || entry == NULL))
+    {
+        return false;
+    }
+
+    return index_search(index, timestamp, true, entry);
+}
+
+const char *xchg_index_strerror(const struct xchg_index *index)
+{
+    if(unlikely(index == NULL))
+    {
+        return false;
+    }
+
+    return index->error;
+}
+
+bool xchg_recorder_set_index(struct xchg_recorder *recorder, struct xchg_index *index)
+{
+    if(unlikely(recorder == NULL || recorder->buffer == NULL))
+    {
+        return false;
+    }
+
+    if(index != NULL && (index->buffer == NULL || !index->writable))
+    {
+        recorder->error = "index is not open for writing";
+        return false;
+    }
+
+    recorder->index = index;
+
+    recorder->error = NULL;
+    return true;
+}
+
+bool xchg_journal_set_index(struct xchg_journal *journal, struct xchg_index *index)
+{
+    if(unlikely(journal == NULL || journal->segment == NULL))
+    {
+        return false;
+    }
+
+    if(!journal->writable)
+    {
+        journal->error = "journal is not open for writing";
+        return false;
+    }
+
+    if(index != NULL && (index->buffer == NULL || !index->writable))
+    {
+        journal->error = "index is not open for writing";
+        return false;
+    }
+
+    journal->index = index;
+
+    journal->error = NULL;
+    return true;
+}
+
+bool xchg_replayer_seek(struct xchg_replayer *replayer, size_t offset, uint64_t sequence)
+{
+    if(unlikely(replayer == NULL || replayer->buffer == NULL))
+    {
+        return false;
+    }
+
+    const struct xchg_recording_header *header = (const struct xchg_recording_header *)replayer->buffer;
+    size_t sz_used = (size_t)atomic_load_explicit((_Atomic uint64_t *)&header->sz_used, memory_order_acquire);
+
+    if((offset % 8) != 0 || offset < XCHG_RECORDING_HEADER_SIZE || offset > sz_used || sz_used > replayer->sz_buffer)
+    {
+        replayer->error = "recording offset is invalid";
+        return false;
+    }
+
+    // an offset within the recorded records must land on the record carrying the expected sequence, which catches
+    // offsets that were saved against a different recording
+
+    if(offset < sz_used)
+    {
+        struct xchg_record record;
+
+        if(offset + sizeof(struct xchg_record) > sz_used)
+        {
+            replayer->error = "recording offset is invalid";
+            return false;
+        }
+
+        memcpy(&record, replayer->buffer + offset, sizeof(struct xchg_record));
+
+        if(record.sequence != sequence)
+        {
+            replayer->error = "recording offset is invalid";
+            return false;
+        }
+    }
+
+    replayer->position = offset;
+    replayer->origin = 0;
+    replayer->start = 0;
+
+    replayer->error = NULL;
+    return true;
 }
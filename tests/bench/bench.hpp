@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+// a pair of cpus for the two ends of a channel, named after how far apart they are in the cache hierarchy
+
+struct bench_placement
+{
+    std::string name;
+    int producer;
+    int consumer;
+};
+
+// pins the calling thread to cpu, returning false if the cpu does not exist or is not allowed
+
+bool bench_pin(int cpu);
+
+// restores the calling thread's affinity to every cpu the process was started with
+
+void bench_unpin();
+
+// discovers same-core, cross-core, cross-socket and cross-node cpu pairs from sysfs, omitting any the machine cannot provide
+
+std::vector<bench_placement> bench_placements();
+
+// registers the benchmarks which run a producer and a consumer on a given pair of cpus
+
+void bench_register_channel_placements(const std::vector<bench_placement> &placements);
+
+// registers the one-way latency benchmarks which run a producer and a consumer on a given pair of cpus
+
+void bench_register_latency_placements(const std::vector<bench_placement> &placements);
+
+// registers the benchmarks which fork a producer and a consumer process over a shared mapping
+
+void bench_register_process_placements(const std::vector<bench_placement> &placements);
@@ -0,0 +1,465 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "xchg.h"
+
+using namespace std;
+
+struct bench_ring
+{
+    bench_ring(uint32_t flags, size_t sz_message, size_t nr_slots) :
+        slab(16 + (sz_message * nr_slots))
+    {
+        ok = xchg_channel_init_ex(&producer, flags, sz_message, nullptr, 0, slab.data(), slab.size()) &&
+             xchg_channel_init_ex(&consumer, flags, sz_message, slab.data(), slab.size(), nullptr, 0);
+    }
+
+    vector<char> slab;
+    xchg_channel producer = {};
+    xchg_channel consumer = {};
+    bool ok;
+};
+
+// prepare, write, send, receive, read and return one message on a single thread, so the cost of each call is
+// measured without any cross-thread traffic
+
+static void bench_round_trip(benchmark::State &state, uint32_t flags, size_t sz_message, size_t sz_payload)
+{
+    auto ring = bench_ring(flags, sz_message, 64);
+    if(!ring.ok)
+    {
+        state.SkipWithError("xchg_channel_init_ex failed");
+        return;
+    }
+
+    auto payload = vector<uint8_t>(sz_payload, 0xA5);
+    xchg_message message = {};
+    const uint8_t *list = nullptr;
+    uint64_t sz_list = 0;
+
+    for(auto _ : state)
+    {
+        if(!xchg_channel_prepare(&ring.producer, &message) ||
+           !xchg_message_write_uint8_list(&message, payload.data(), payload.size()) ||
+           !xchg_channel_send(&ring.producer, &message) ||
+           !xchg_channel_receive(&ring.consumer, &message) ||
+           !xchg_message_read_uint8_list(&message, &list, &sz_list) ||
+           !xchg_channel_return(&ring.consumer, &message))
+        {
+            state.SkipWithError("round trip failed");
+            return;
+        }
+        benchmark::DoNotOptimize(list);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * sz_payload);
+}
+
+static void bench_round_trip_flags(benchmark::State &state)
+{
+    auto flags = (uint32_t)state.range(0);
+    auto sz_message = (size_t)state.range(1);
+    bench_round_trip(state, flags, sz_message, sz_message / 2);
+}
+
+// the any-size flag is measured both on power-of-two slots, to compare it with the mask path, and on slots only it
+// accepts
+
+BENCHMARK(bench_round_trip_flags)
+    ->Name("round_trip")
+    ->ArgNames({ "flags", "size" })
+    ->ArgsProduct({ { 0, xchg_channel_flag_length, xchg_channel_flag_checksum, xchg_channel_flag_header,
+                      xchg_channel_flag_any_size },
+                    { 64, 256, 1024, 4096, 16384 } })
+    ->Args({ xchg_channel_flag_any_size, 48 })
+    ->Args({ xchg_channel_flag_any_size, 768 })
+    ->Args({ xchg_channel_flag_any_size, 12288 });
+
+// the single-threaded round trip with both ends sampled one in every period messages, where a period of zero leaves
+// sampling off, so the cost of the countdown and of the timestamps can be told apart
+
+static void bench_round_trip_sampled(benchmark::State &state)
+{
+    auto period = (size_t)state.range(0);
+    auto ring = bench_ring(0, 64, 64);
+    auto samples = vector<xchg_sample>(4096);
+    xchg_sampler sampler = {};
+
+    if(!ring.ok || !xchg_sampler_init(&sampler, samples.data(), samples.size()) ||
+       (period != 0 && (!xchg_channel_set_sampler(&ring.producer, &sampler, period) ||
+                        !xchg_channel_set_sampler(&ring.consumer, &sampler, period))))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    xchg_message message = {};
+    uint64_t value = 0;
+    uint64_t i = 0;
+
+    for(auto _ : state)
+    {
+        xchg_channel_prepare(&ring.producer, &message);
+        xchg_message_write_uint64(&message, value);
+        xchg_channel_send(&ring.producer, &message);
+        xchg_channel_receive(&ring.consumer, &message);
+        xchg_message_read_uint64(&message, &value);
+        xchg_channel_return(&ring.consumer, &message);
+
+        // drained in place of a monitor thread, rarely enough not to show in the timing
+
+        if((++i & 1023) == 0)
+        {
+            xchg_sampler_drain(&sampler, nullptr, nullptr, nullptr);
+        }
+    }
+    benchmark::DoNotOptimize(value);
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(bench_round_trip_sampled)->Name("round_trip_sampled")->ArgName("period")->Arg(0)->Arg(1024)->Arg(64)->Arg(1);
+
+// replays a recording of mixed-size messages into a ring at full speed, draining it in between, as a load generator
+// would
+
+static void bench_replay(benchmark::State &state)
+{
+    auto ring = bench_ring(0, 1024, 64);
+    auto recording = vector<char>(1 << 20);
+    auto payload = vector<uint8_t>(900, 0xA5);
+    char data[1024];
+    xchg_recorder recorder = {};
+    xchg_replayer replayer = {};
+
+    if(!ring.ok || !xchg_recorder_init(&recorder, recording.data(), recording.size()))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    // each message is recorded through a second view limited to the bytes that were written into it
+
+    xchg_message message = {};
+    xchg_message written = {};
+    size_t position = 0;
+    for(size_t i = 0; i < 1024; i++)
+    {
+        xchg_message_init(&message, data, sizeof(data));
+        xchg_message_write_uint8_list(&message, payload.data(), (i * 37) % payload.size());
+        xchg_message_position(&message, &position);
+        xchg_message_init(&written, data, position);
+        xchg_recorder_record(&recorder, &written, 0);
+    }
+
+    xchg_replayer_init(&replayer, recording.data(), recording.size());
+
+    size_t nr_sent = 0;
+    uint64_t nr_messages = 0;
+
+    for(auto _ : state)
+    {
+        if(!xchg_replayer_send(&replayer, &ring.producer, 0, &nr_sent))
+        {
+            xchg_replayer_rewind(&replayer);
+        }
+        while(xchg_channel_receive(&ring.consumer, &message))
+        {
+            xchg_channel_return(&ring.consumer, &message);
+        }
+        nr_messages += nr_sent;
+    }
+
+    state.SetItemsProcessed((int64_t)nr_messages);
+}
+
+BENCHMARK(bench_replay)->Name("replay");
+
+// append a message to a journal segment in place, and tail it from a reader cursor
+
+static void bench_journal(benchmark::State &state)
+{
+    auto segments = vector<uint64_t>(2 * (1 << 20) / sizeof(uint64_t));
+    char *current = reinterpret_cast<char *>(segments.data());
+    char *next = current + (1 << 20);
+    xchg_journal writer = {};
+    xchg_journal reader = {};
+
+    if(!xchg_journal_init(&writer, current, 1 << 20) || !xchg_journal_open(&reader, current, 1 << 20))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    xchg_message message = {};
+    uint64_t value = 0;
+
+    for(auto _ : state)
+    {
+        if(!xchg_journal_prepare(&writer, &message))
+        {
+            // the reader has caught up, so both ends move on to a fresh segment and the old one is reused
+
+            xchg_journal_roll(&writer, next, 1 << 20);
+            xchg_journal_roll(&reader, next, 1 << 20);
+            std::swap(current, next);
+            xchg_journal_prepare(&writer, &message);
+        }
+        xchg_message_write_uint64(&message, value);
+        xchg_journal_send(&writer, &message, 0);
+
+        xchg_journal_receive(&reader, &message);
+        xchg_message_read_uint64(&message, &value);
+        xchg_journal_return(&reader, &message);
+    }
+
+    state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(bench_journal)->Name("journal");
+
+// seek by sequence through an index of a million entries, standing in for a capture of a billion messages
+
+static void bench_index_seek(benchmark::State &state)
+{
+    auto nr_entries = (size_t)1 << 20;
+    auto buffer = vector<uint64_t>((XCHG_INDEX_HEADER_SIZE + nr_entries * sizeof(xchg_index_entry)) / sizeof(uint64_t));
+    xchg_index index = {};
+
+    if(!xchg_index_init(&index, reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(uint64_t), 1024))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    xchg_record record = {};
+    for(size_t i = 0; i < nr_entries; i++)
+    {
+        record.sequence = i * 1024;
+        record.timestamp = i * 1000;
+        xchg_index_add(&index, &record, i / 4096, XCHG_RECORDING_HEADER_SIZE + (i % 4096) * 256);
+    }
+
+    xchg_index_entry entry = {};
+    uint64_t target = 0;
+
+    for(auto _ : state)
+    {
+        // a large odd stride visits the entries in an order the prefetcher cannot follow
+
+        target = (target + 0x9E3779B97F4A7C15u) % ((uint64_t)nr_entries * 1024);
+        xchg_index_seek_sequence(&index, target, &entry);
+        benchmark::DoNotOptimize(entry);
+    }
+
+    state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(bench_index_seek)->Name("index_seek");
+
+// send a burst of messages, then receive all of them
+
+static void bench_burst(benchmark::State &state)
+{
+    auto burst = (size_t)state.range(0);
+    auto ring = bench_ring(0, 64, 256);
+    if(!ring.ok)
+    {
+        state.SkipWithError("xchg_channel_init failed");
+        return;
+    }
+
+    xchg_message message = {};
+    uint64_t value = 0;
+
+    for(auto _ : state)
+    {
+        for(size_t i = 0; i < burst; i++)
+        {
+            xchg_channel_prepare(&ring.producer, &message);
+            xchg_message_write_uint64(&message, i);
+            xchg_channel_send(&ring.producer, &message);
+        }
+        for(size_t i = 0; i < burst; i++)
+        {
+            xchg_channel_receive(&ring.consumer, &message);
+            xchg_message_read_uint64(&message, &value);
+            xchg_channel_return(&ring.consumer, &message);
+        }
+        benchmark::DoNotOptimize(value);
+    }
+
+    state.SetItemsProcessed(state.iterations() * burst);
+}
+
+BENCHMARK(bench_burst)->Name("burst")->ArgName("burst")->RangeMultiplier(4)->Range(1, 256);
+
+// runs fn on a thread pinned to cpu until stop is set
+
+template<typename F>
+static thread bench_peer(int cpu, atomic<bool> &stop, F fn)
+{
+    return thread([cpu, &stop, fn]() mutable {
+        bench_pin(cpu);
+        while(!stop.load(memory_order_relaxed))
+        {
+            if(!fn())
+            {
+                this_thread::yield();
+            }
+        }
+    });
+}
+
+// one message to the peer and one back per iteration, so the time is a full round trip between the two cpus
+
+static void bench_ping_pong(benchmark::State &state, bench_placement placement)
+{
+    auto request = bench_ring(0, 64, 64);
+    auto response = bench_ring(0, 64, 64);
+    if(!request.ok || !response.ok || !bench_pin(placement.producer))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    atomic<bool> stop(false);
+    auto peer = bench_peer(placement.consumer, stop, [&request, &response]() {
+        xchg_message message = {};
+        uint64_t value = 0;
+        if(!xchg_channel_receive(&request.consumer, &message))
+        {
+            return false;
+        }
+        xchg_message_read_uint64(&message, &value);
+        xchg_channel_return(&request.consumer, &message);
+        while(!xchg_channel_prepare(&response.producer, &message))
+        {
+        }
+        xchg_message_write_uint64(&message, value);
+        xchg_channel_send(&response.producer, &message);
+        return true;
+    });
+
+    xchg_message message = {};
+    uint64_t value = 0;
+    uint64_t counter = 0;
+
+    for(auto _ : state)
+    {
+        xchg_channel_prepare(&request.producer, &message);
+        xchg_message_write_uint64(&message, counter++);
+        xchg_channel_send(&request.producer, &message);
+        while(!xchg_channel_receive(&response.consumer, &message))
+        {
+            this_thread::yield();
+        }
+        xchg_message_read_uint64(&message, &value);
+        xchg_channel_return(&response.consumer, &message);
+    }
+
+    stop.store(true);
+    peer.join();
+    bench_unpin();
+
+    if(value + 1 != counter)
+    {
+        state.SkipWithError("responses were received out of order");
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// one message per iteration streamed to the peer, which drains the ring
+
+static void bench_stream(benchmark::State &state, bench_placement placement)
+{
+    auto sz_payload = (size_t)state.range(0);
+    auto prefetch = (size_t)state.range(1);
+    auto batch = (size_t)state.range(2);
+    auto streaming = (size_t)state.range(3);
+
+    auto ring = bench_ring(0, sz_payload * 2, 256);
+    if(!ring.ok ||
+       !xchg_channel_set_prefetch(&ring.producer, prefetch) ||
+       !xchg_channel_set_prefetch(&ring.consumer, prefetch) ||
+       !xchg_channel_set_refresh_batch(&ring.consumer, batch) ||
+       !xchg_channel_set_streaming(&ring.producer, streaming) ||
+       !bench_pin(placement.producer))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    atomic<bool> stop(false);
+    atomic<uint64_t> received(0);
+    auto peer = bench_peer(placement.consumer, stop, [&ring, &received]() {
+        xchg_message message = {};
+        if(!xchg_channel_receive(&ring.consumer, &message))
+        {
+            return false;
+        }
+        const uint8_t *list = nullptr;
+        uint64_t sz_list = 0;
+        uint64_t sum = 0;
+        xchg_message_read_uint8_list(&message, &list, &sz_list);
+        for(uint64_t i = 0; i < sz_list; i += 64)
+        {
+            sum += list[i];
+        }
+        benchmark::DoNotOptimize(sum);
+        xchg_channel_return(&ring.consumer, &message);
+        received.store(received.load(memory_order_relaxed) + 1, memory_order_release);
+        return true;
+    });
+
+    auto payload = vector<uint8_t>(sz_payload, 0xA5);
+    xchg_message message = {};
+    uint64_t sent = 0;
+
+    for(auto _ : state)
+    {
+        while(!xchg_channel_prepare(&ring.producer, &message))
+        {
+            this_thread::yield();
+        }
+        xchg_message_write_uint8_list(&message, payload.data(), payload.size());
+        xchg_channel_send(&ring.producer, &message);
+        sent++;
+    }
+
+    while(received.load(memory_order_acquire) < sent)
+    {
+        this_thread::yield();
+    }
+
+    stop.store(true);
+    peer.join();
+    bench_unpin();
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * sz_payload);
+}
+
+void bench_register_channel_placements(const vector<bench_placement> &placements)
+{
+    for(auto &placement : placements)
+    {
+        benchmark::RegisterBenchmark(("ping_pong/" + placement.name).c_str(), bench_ping_pong, placement)
+            ->UseRealTime();
+
+        benchmark::RegisterBenchmark(("stream/" + placement.name).c_str(), bench_stream, placement)
+            ->ArgNames({ "payload", "prefetch", "batch", "streaming" })
+            ->ArgsProduct({ { 32 }, { 0, 1, 4 }, { 1, 16, 64 }, { 0 } })
+            ->ArgsProduct({ { 1024, 4096, 16384 }, { 1 }, { 1 }, { 0, 256 } })
+            ->UseRealTime();
+    }
+}
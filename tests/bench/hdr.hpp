@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// high dynamic range histogram with 1024 linear sub-buckets per power of two, so every recorded value is kept to
+// within 0.1% (three significant digits) from one nanosecond up to about eighteen minutes
+
+class hdr_histogram
+{
+private:
+    static const int sub_bucket_bits = 10;
+    static const uint64_t sub_bucket_count = (uint64_t)1 << sub_bucket_bits;
+    static const int max_shift = 30;
+
+    std::vector<uint64_t> counts;
+
+    uint64_t total = 0;
+
+    uint64_t max = 0;
+
+    static size_t index_of(uint64_t value)
+    {
+        if(value < 2 * sub_bucket_count)
+        {
+            return (size_t)value;
+        }
+
+        int shift = (63 - __builtin_clzll(value)) - sub_bucket_bits;
+        if(shift > max_shift)
+        {
+            shift = max_shift;
+            value = ((2 * sub_bucket_count) - 1) << shift;
+        }
+
+        uint64_t mantissa = value >> shift;
+        return (size_t)((2 * sub_bucket_count) + ((shift - 1) * sub_bucket_count) + (mantissa - sub_bucket_count));
+    }
+
+    static uint64_t highest_equivalent(size_t index)
+    {
+        if(index < 2 * sub_bucket_count)
+        {
+            return index;
+        }
+
+        uint64_t shift = ((index - (2 * sub_bucket_count)) / sub_bucket_count) + 1;
+        uint64_t mantissa = sub_bucket_count + ((index - (2 * sub_bucket_count)) % sub_bucket_count);
+        return (mantissa << shift) + (((uint64_t)1 << shift) - 1);
+    }
+
+public:
+    hdr_histogram() :
+        counts((2 * sub_bucket_count) + (max_shift * sub_bucket_count), 0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        counts[index_of(value)] += 1;
+        total += 1;
+        if(value > max)
+        {
+            max = value;
+        }
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t maximum() const
+    {
+        return max;
+    }
+
+    // smallest recorded value which at least the given percentage of recorded values are less than or equal to
+
+    uint64_t percentile(double pct) const
+    {
+        if(total == 0)
+        {
+            return 0;
+        }
+
+        auto target = (uint64_t)std::ceil((pct / 100.0) * (double)total);
+        if(target == 0)
+        {
+            target = 1;
+        }
+
+        uint64_t seen = 0;
+        for(size_t i = 0; i < counts.size(); i++)
+        {
+            seen += counts[i];
+            if(seen >= target)
+            {
+                auto value = highest_equivalent(i);
+                return value < max ? value : max;
+            }
+        }
+
+        return max;
+    }
+};
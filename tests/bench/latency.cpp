@@ -0,0 +1,121 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "hdr.hpp"
+#include "xchg.h"
+
+using namespace std;
+
+static uint64_t steady_ns()
+{
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// one-way latency under a fixed offered load. Each message is stamped with the time it was scheduled to be sent
+// rather than the time it actually was, so a stall in the producer or a full ring is charged to every message
+// queued behind it instead of silently delaying the schedule (coordinated omission)
+
+static void bench_latency(benchmark::State &state, bench_placement placement)
+{
+    auto rate = (uint64_t)state.range(0);
+    auto sz_message = (size_t)state.range(1);
+    auto interval_ns = 1000000000u / rate;
+
+    vector<char> slab(16 + (sz_message * 1024));
+    xchg_channel producer = {};
+    xchg_channel consumer = {};
+    if(!xchg_channel_init(&producer, sz_message, nullptr, 0, slab.data(), slab.size()) ||
+       !xchg_channel_init(&consumer, sz_message, slab.data(), slab.size(), nullptr, 0) ||
+       !bench_pin(placement.producer))
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    hdr_histogram histogram;
+    atomic<bool> stop(false);
+    atomic<uint64_t> received(0);
+
+    auto peer = thread([&]() {
+        bench_pin(placement.consumer);
+        xchg_message message = {};
+        uint64_t stamp = 0;
+        while(!stop.load(memory_order_relaxed))
+        {
+            if(!xchg_channel_receive(&consumer, &message))
+            {
+                this_thread::yield();
+                continue;
+            }
+            xchg_message_read_uint64(&message, &stamp);
+            histogram.record(steady_ns() - stamp);
+            xchg_channel_return(&consumer, &message);
+            received.store(received.load(memory_order_relaxed) + 1, memory_order_release);
+        }
+    });
+
+    xchg_message message = {};
+    uint64_t sent = 0;
+    uint64_t next = steady_ns();
+
+    for(auto _ : state)
+    {
+        while(steady_ns() < next)
+        {
+            this_thread::yield();
+        }
+        while(!xchg_channel_prepare(&producer, &message))
+        {
+            this_thread::yield();
+        }
+        xchg_message_write_uint64(&message, next);
+        xchg_channel_send(&producer, &message);
+        next += interval_ns;
+        sent++;
+    }
+
+    while(received.load(memory_order_acquire) < sent)
+    {
+        this_thread::yield();
+    }
+
+    stop.store(true);
+    peer.join();
+    bench_unpin();
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["p50_ns"] = (double)histogram.percentile(50.0);
+    state.counters["p90_ns"] = (double)histogram.percentile(90.0);
+    state.counters["p99_ns"] = (double)histogram.percentile(99.0);
+    state.counters["p99.9_ns"] = (double)histogram.percentile(99.9);
+    state.counters["p99.99_ns"] = (double)histogram.percentile(99.99);
+    state.counters["p99.999_ns"] = (double)histogram.percentile(99.999);
+    state.counters["max_ns"] = (double)histogram.maximum();
+}
+
+void bench_register_latency_placements(const vector<bench_placement> &placements)
+{
+    // each run offers half a second of load, so the highest percentiles are backed by enough samples at high rates
+
+    for(auto &placement : placements)
+    {
+        for(int64_t rate : { 10000, 100000, 1000000 })
+        {
+            for(int64_t sz_message : { 64, 1024 })
+            {
+                benchmark::RegisterBenchmark(("latency/" + placement.name).c_str(), bench_latency, placement)
+                    ->ArgNames({ "rate", "size" })
+                    ->Args({ rate, sz_message })
+                    ->Iterations(rate / 2)
+                    ->UseRealTime()
+                    ->Unit(benchmark::kMicrosecond);
+            }
+        }
+    }
+}
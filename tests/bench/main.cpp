@@ -0,0 +1,168 @@
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+
+using namespace std;
+
+static cpu_set_t bench_affinity;
+
+static int read_topology(int cpu, const char *name)
+{
+    ifstream file("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/" + name);
+    int value = -1;
+    file >> value;
+    return value;
+}
+
+bool bench_pin(int cpu)
+{
+    if(cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &bench_affinity))
+    {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void bench_unpin()
+{
+    pthread_setaffinity_np(pthread_self(), sizeof(bench_affinity), &bench_affinity);
+}
+
+static int read_node(int cpu)
+{
+    for(int node = 0; node < 1024; node++)
+    {
+        auto path = "/sys/devices/system/cpu/cpu" + to_string(cpu) + "/node" + to_string(node);
+        if(access(path.c_str(), F_OK) == 0)
+        {
+            return node;
+        }
+    }
+    return -1;
+}
+
+vector<bench_placement> bench_placements()
+{
+    vector<int> cpus;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if(CPU_ISSET(cpu, &bench_affinity))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    vector<bench_placement> placements;
+    if(cpus.empty())
+    {
+        return placements;
+    }
+
+    int first = cpus[0];
+    int package = read_topology(first, "physical_package_id");
+    int core = read_topology(first, "core_id");
+    int node = read_node(first);
+
+    // both ends on one cpu, then on an SMT sibling, another core in the same package, another package, and another
+    // numa node, which on machines with sub-numa clustering can differ from the package
+
+    placements.push_back({ "same_cpu", first, first });
+
+    bool found_sibling = false;
+    bool found_core = false;
+    bool found_socket = false;
+    bool found_node = false;
+
+    for(size_t i = 1; i < cpus.size(); i++)
+    {
+        int cpu = cpus[i];
+        int cpu_package = read_topology(cpu, "physical_package_id");
+        int cpu_core = read_topology(cpu, "core_id");
+
+        if(!found_sibling && cpu_package == package && cpu_core == core)
+        {
+            placements.push_back({ "smt_sibling", first, cpu });
+            found_sibling = true;
+        }
+        else if(!found_core && cpu_package == package && cpu_core != core)
+        {
+            placements.push_back({ "cross_core", first, cpu });
+            found_core = true;
+        }
+        else if(!found_socket && cpu_package != package)
+        {
+            placements.push_back({ "cross_socket", first, cpu });
+            found_socket = true;
+        }
+
+        if(!found_node && node >= 0 && read_node(cpu) != node)
+        {
+            placements.push_back({ "cross_node", first, cpu });
+            found_node = true;
+        }
+    }
+
+    return placements;
+}
+
+int main(int argc, char **argv)
+{
+    sched_getaffinity(0, sizeof(bench_affinity), &bench_affinity);
+
+    auto placements = bench_placements();
+
+    // --bench_producer_cpu=N and --bench_consumer_cpu=M add a "custom" placement for the given pair of cpus, and are
+    // removed from argv before google benchmark sees them
+
+    int producer = -1;
+    int consumer = -1;
+    int nr_args = 1;
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg.rfind("--bench_producer_cpu=", 0) == 0)
+        {
+            producer = stoi(arg.substr(strlen("--bench_producer_cpu=")));
+        }
+        else if(arg.rfind("--bench_consumer_cpu=", 0) == 0)
+        {
+            consumer = stoi(arg.substr(strlen("--bench_consumer_cpu=")));
+        }
+        else
+        {
+            argv[nr_args++] = argv[i];
+        }
+    }
+    argc = nr_args;
+
+    if(producer >= 0 || consumer >= 0)
+    {
+        placements.push_back({ "custom", producer >= 0 ? producer : consumer, consumer >= 0 ? consumer : producer });
+    }
+
+    bench_register_channel_placements(placements);
+    bench_register_latency_placements(placements);
+    bench_register_process_placements(placements);
+
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
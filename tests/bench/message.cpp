@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xchg.h"
+
+using namespace std;
+
+// each iteration encodes or decodes a fixed number of scalars, so per-value cost is items_per_second
+
+static const size_t nr_scalars = 64;
+
+template<typename T, bool (*write)(struct xchg_message *, T)>
+static void bench_encode_scalar(benchmark::State &state)
+{
+    vector<char> buffer(nr_scalars * 16);
+    xchg_message message = {};
+    xchg_message_init(&message, buffer.data(), buffer.size());
+
+    for(auto _ : state)
+    {
+        xchg_message_reset(&message);
+        for(size_t i = 0; i < nr_scalars; i++)
+        {
+            if(!write(&message, (T)i))
+            {
+                state.SkipWithError("write failed");
+                return;
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * nr_scalars);
+}
+
+template<typename T, bool (*write)(struct xchg_message *, T), bool (*read)(struct xchg_message *, T *)>
+static void bench_decode_scalar(benchmark::State &state)
+{
+    vector<char> buffer(nr_scalars * 16);
+    xchg_message message = {};
+    xchg_message_init(&message, buffer.data(), buffer.size());
+    for(size_t i = 0; i < nr_scalars; i++)
+    {
+        write(&message, (T)i);
+    }
+
+    T value;
+    for(auto _ : state)
+    {
+        xchg_message_reset(&message);
+        for(size_t i = 0; i < nr_scalars; i++)
+        {
+            if(!read(&message, &value))
+            {
+                state.SkipWithError("read failed");
+                return;
+            }
+            benchmark::DoNotOptimize(value);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * nr_scalars);
+}
+
+template<typename T, bool (*write)(struct xchg_message *, const T[], uint64_t)>
+static void bench_encode_list(benchmark::State &state)
+{
+    auto sz_list = (size_t)state.range(0);
+    auto list = make_unique<T[]>(sz_list);
+    vector<char> buffer(16 + (sz_list * sizeof(T)));
+    xchg_message message = {};
+    xchg_message_init(&message, buffer.data(), buffer.size());
+
+    for(auto _ : state)
+    {
+        xchg_message_reset(&message);
+        if(!write(&message, list.get(), sz_list))
+        {
+            state.SkipWithError("write failed");
+            return;
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * sz_list * sizeof(T));
+}
+
+template<typename T,
+         bool (*write)(struct xchg_message *, const T[], uint64_t),
+         bool (*read)(struct xchg_message *, T const *[], uint64_t *)>
+static void bench_decode_list(benchmark::State &state)
+{
+    auto sz_list = (size_t)state.range(0);
+    auto list = make_unique<T[]>(sz_list);
+    vector<char> buffer(16 + (sz_list * sizeof(T)));
+    xchg_message message = {};
+    xchg_message_init(&message, buffer.data(), buffer.size());
+    write(&message, list.get(), sz_list);
+
+    const T *result = nullptr;
+    uint64_t sz_result = 0;
+    for(auto _ : state)
+    {
+        xchg_message_reset(&message);
+        if(!read(&message, &result, &sz_result))
+        {
+            state.SkipWithError("read failed");
+            return;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * sz_list * sizeof(T));
+}
+
+#define BENCH_CODEC(xchg_type, c_type)                                                                             \
+    BENCHMARK_TEMPLATE(bench_encode_scalar, c_type, xchg_message_write_##xchg_type)->Name("encode/" #xchg_type);  \
+    BENCHMARK_TEMPLATE(bench_decode_scalar, c_type, xchg_message_write_##xchg_type, xchg_message_read_##xchg_type) \
+        ->Name("decode/" #xchg_type);                                                                              \
+    BENCHMARK_TEMPLATE(bench_encode_list, c_type, xchg_message_write_##xchg_type##_list)                           \
+        ->Name("encode_list/" #xchg_type)                                                                          \
+        ->RangeMultiplier(8)                                                                                       \
+        ->Range(8, 32768);                                                                                         \
+    BENCHMARK_TEMPLATE(bench_decode_list, c_type, xchg_message_write_##xchg_type##_list,                           \
+                       xchg_message_read_##xchg_type##_list)                                                       \
+        ->Name("decode_list/" #xchg_type)                                                                          \
+        ->RangeMultiplier(8)                                                                                       \
+        ->Range(8, 32768);
+
+BENCH_CODEC(bool, bool)
+BENCH_CODEC(int8, int8_t)
+BENCH_CODEC(uint8, uint8_t)
+BENCH_CODEC(int16, int16_t)
+BENCH_CODEC(uint16, uint16_t)
+BENCH_CODEC(int32, int32_t)
+BENCH_CODEC(uint32, uint32_t)
+BENCH_CODEC(int64, int64_t)
+BENCH_CODEC(uint64, uint64_t)
+BENCH_CODEC(float32, float_t)
+BENCH_CODEC(float64, double_t)
@@ -0,0 +1,277 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hpp"
+#include "hdr.hpp"
+#include "xchg.h"
+
+using namespace std;
+
+enum process_backing
+{
+    process_backing_shm = 0,
+    process_backing_hugepages = 1,
+};
+
+// lives at the start of the shared mapping, ahead of the ring, so the two processes can coordinate a run
+
+struct process_control
+{
+    atomic<uint64_t> sent;
+    atomic<uint64_t> received;
+    atomic<bool> ready;
+    atomic<bool> stop;
+    uint64_t latency[7];
+};
+
+static const size_t process_sz_control = 4096;
+static const size_t process_sz_hugepage = 2 * 1024 * 1024;
+
+static const char *const process_percentile_names[] = {
+    "p50_ns", "p90_ns", "p99_ns", "p99.9_ns", "p99.99_ns", "p99.999_ns", "max_ns",
+};
+
+static const double process_percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99, 99.999 };
+
+static uint64_t steady_ns()
+{
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// maps sz bytes that stay shared across fork, either from a posix shm object like a deployment would use, or from
+// anonymous huge pages. The shm object is unlinked straight away so nothing is left behind in /dev/shm
+
+static void *process_map(process_backing backing, size_t *sz)
+{
+    void *mapping = MAP_FAILED;
+
+    if(backing == process_backing_hugepages)
+    {
+        *sz = (*sz + process_sz_hugepage - 1) & ~(process_sz_hugepage - 1);
+        mapping = mmap(nullptr, *sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    else
+    {
+        auto name = "/xchg_bench." + to_string(getpid());
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd < 0)
+        {
+            return nullptr;
+        }
+        shm_unlink(name.c_str());
+        if(ftruncate(fd, (off_t)*sz) == 0)
+        {
+            mapping = mmap(nullptr, *sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+    }
+
+    return mapping != MAP_FAILED ? mapping : nullptr;
+}
+
+// runs in the forked child until the parent has stopped and every message it sent has been drained
+
+[[noreturn]] static void process_consumer(process_control *control, xchg_channel *consumer, int cpu)
+{
+    if(!bench_pin(cpu))
+    {
+        _exit(1);
+    }
+
+    hdr_histogram histogram;
+    xchg_message message = {};
+    uint64_t stamp = 0;
+    uint64_t received = 0;
+
+    control->ready.store(true, memory_order_release);
+
+    while(!control->stop.load(memory_order_acquire) || received < control->sent.load(memory_order_acquire))
+    {
+        if(!xchg_channel_receive(consumer, &message))
+        {
+            this_thread::yield();
+            continue;
+        }
+        xchg_message_read_uint64(&message, &stamp);
+        histogram.record(steady_ns() - stamp);
+        xchg_channel_return(consumer, &message);
+        received += 1;
+        control->received.store(received, memory_order_release);
+    }
+
+    for(size_t i = 0; i < 6; i++)
+    {
+        control->latency[i] = histogram.percentile(process_percentiles[i]);
+    }
+    control->latency[6] = histogram.maximum();
+
+    _exit(0);
+}
+
+// waits for cond while checking that the child has not died, which would otherwise leave the parent spinning
+
+template<typename Cond>
+static bool process_wait(pid_t child, Cond cond)
+{
+    while(!cond())
+    {
+        if(waitpid(child, nullptr, WNOHANG) == child)
+        {
+            return false;
+        }
+        this_thread::yield();
+    }
+    return true;
+}
+
+// a producer and a consumer in separate processes over a shared mapping, so each end has its own page tables and
+// the ring is reached through a real shm or hugetlb mapping. A rate of zero streams as fast as the ring allows and
+// so measures throughput, where latency includes queueing; otherwise messages follow a fixed schedule and are
+// stamped with their scheduled send time as in the latency benchmarks
+
+static void bench_process(benchmark::State &state, bench_placement placement)
+{
+    auto rate = (uint64_t)state.range(0);
+    auto sz_payload = (size_t)state.range(1);
+    auto backing = (process_backing)state.range(2);
+    auto interval_ns = rate != 0 ? 1000000000u / rate : 0;
+
+    // the ring is first touched by the pinned producer, so it lands on the producer's numa node
+
+    size_t sz_message = 64;
+    while(sz_message < sz_payload + 64)
+    {
+        sz_message *= 2;
+    }
+    auto sz_ring = 16 + (sz_message * 256);
+    auto sz_mapping = process_sz_control + sz_ring;
+
+    if(!bench_pin(placement.producer))
+    {
+        state.SkipWithError("could not pin producer");
+        return;
+    }
+
+    auto mapping = (char *)process_map(backing, &sz_mapping);
+    if(mapping == nullptr)
+    {
+        bench_unpin();
+        state.SkipWithError(backing == process_backing_hugepages ? "huge pages unavailable" : "shm_open failed");
+        return;
+    }
+    memset(mapping, 0, sz_mapping);
+
+    auto control = new(mapping) process_control();
+    auto ring = mapping + process_sz_control;
+
+    xchg_channel producer = {};
+    xchg_channel consumer = {};
+    if(!xchg_channel_init(&producer, sz_message, nullptr, 0, ring, sz_ring) ||
+       !xchg_channel_init(&consumer, sz_message, ring, sz_ring, nullptr, 0))
+    {
+        munmap(mapping, sz_mapping);
+        bench_unpin();
+        state.SkipWithError("xchg_channel_init failed");
+        return;
+    }
+
+    pid_t child = fork();
+    if(child == 0)
+    {
+        process_consumer(control, &consumer, placement.consumer);
+    }
+
+    if(child < 0 || !process_wait(child, [control]() { return control->ready.load(memory_order_acquire); }))
+    {
+        munmap(mapping, sz_mapping);
+        bench_unpin();
+        state.SkipWithError("consumer process failed to start");
+        return;
+    }
+
+    auto payload = vector<uint8_t>(sz_payload, 0xA5);
+    xchg_message message = {};
+    uint64_t sent = 0;
+    uint64_t next = steady_ns();
+
+    for(auto _ : state)
+    {
+        if(rate != 0)
+        {
+            while(steady_ns() < next)
+            {
+                this_thread::yield();
+            }
+        }
+        while(!xchg_channel_prepare(&producer, &message))
+        {
+            this_thread::yield();
+        }
+        xchg_message_write_uint64(&message, rate != 0 ? next : steady_ns());
+        xchg_message_write_uint8_list(&message, payload.data(), payload.size());
+        xchg_channel_send(&producer, &message);
+        next += interval_ns;
+        sent++;
+    }
+
+    control->sent.store(sent, memory_order_release);
+    control->stop.store(true, memory_order_release);
+
+    int status = 0;
+    bool ok = process_wait(child, [control, sent]() { return control->received.load(memory_order_acquire) >= sent; }) &&
+              waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    bench_unpin();
+
+    if(!ok)
+    {
+        munmap(mapping, sz_mapping);
+        state.SkipWithError("consumer process failed");
+        return;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * sz_payload);
+    for(size_t i = 0; i < 7; i++)
+    {
+        state.counters[process_percentile_names[i]] = (double)control->latency[i];
+    }
+
+    munmap(mapping, sz_mapping);
+}
+
+void bench_register_process_placements(const vector<bench_placement> &placements)
+{
+    for(auto &placement : placements)
+    {
+        for(int64_t backing : { process_backing_shm, process_backing_hugepages })
+        {
+            benchmark::RegisterBenchmark(("process/" + placement.name).c_str(), bench_process, placement)
+                ->ArgNames({ "rate", "payload", "hugepages" })
+                ->ArgsProduct({ { 0 }, { 32, 1024 }, { backing } })
+                ->UseRealTime();
+
+            for(int64_t rate : { 100000, 1000000 })
+            {
+                benchmark::RegisterBenchmark(("process/" + placement.name).c_str(), bench_process, placement)
+                    ->ArgNames({ "rate", "payload", "hugepages" })
+                    ->Args({ rate, 32, backing })
+                    ->Iterations(rate / 2)
+                    ->UseRealTime()
+                    ->Unit(benchmark::kMicrosecond);
+            }
+        }
+    }
+}
@@ -1,5 +1,12 @@
 #include <cstring>
 
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "catch.hpp"
 #include "xchg.h"
 
@@ -28,7 +35,7 @@ TEST_CASE("channel create", "[channel]")
     REQUIRE(channel.egress.sz_data == 4096);
     REQUIRE(*channel.egress.r == 0);
     REQUIRE(*channel.egress.w == 0);
-    REQUIRE(channel.egress.cr == 0);
+    REQUIRE(channel.egress.cr == 4096);
     REQUIRE(channel.egress.cw == 0);
 }
 
@@ -135,3 +142,802 @@ TEST_CASE("channel send/receive wraparound", "[channel]")
     REQUIRE(channel_b.ingress.cw == 6144);
     REQUIRE(*channel_b.ingress.w == 6144);
 }
+
+TEST_CASE("channel checksum", "[channel]")
+{
+    char slab[4112] = {};
+
+    struct xchg_channel channel_a = {};
+    REQUIRE_FALSE(xchg_channel_init_ex(&channel_a, 0x80000000u, 64, nullptr, 0, slab, sizeof(slab)));
+    REQUIRE(xchg_channel_strerror(&channel_a));
+    REQUIRE_FALSE(xchg_channel_init_ex(&channel_a, xchg_channel_flag_checksum, 8, nullptr, 0, slab, sizeof(slab)));
+    REQUIRE(xchg_channel_strerror(&channel_a));
+
+    REQUIRE(xchg_channel_init_ex(&channel_a, xchg_channel_flag_checksum, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel channel_b = {};
+    REQUIRE(xchg_channel_init_ex(&channel_b, xchg_channel_flag_checksum, 64, slab, sizeof(slab), nullptr, 0));
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_channel_prepare(&channel_a, &message));
+    REQUIRE(message.length == 56);
+    REQUIRE(message.data == slab + 16 + 8);
+    REQUIRE(xchg_message_write_uint8_list(&message, (const uint8_t *)"alex forster", 12));
+    REQUIRE(xchg_channel_send(&channel_a, &message));
+
+    REQUIRE(xchg_channel_receive(&channel_b, &message));
+    uint64_t message_length = 0;
+    const uint8_t *message_payload = nullptr;
+    REQUIRE(xchg_message_read_uint8_list(&message, &message_payload, &message_length));
+    REQUIRE(memcmp(message_payload, "alex forster", message_length) == 0);
+    REQUIRE(xchg_channel_return(&channel_b, &message));
+
+    REQUIRE(xchg_channel_prepare(&channel_a, &message));
+    REQUIRE(xchg_message_write_uint8_list(&message, (const uint8_t *)"alex forster", 12));
+    REQUIRE(xchg_channel_send(&channel_a, &message));
+
+    slab[16 + 64 + 8 + 4] ^= 0x20;
+
+    REQUIRE_FALSE(xchg_channel_receive(&channel_b, &message));
+    REQUIRE(strcmp(xchg_channel_strerror(&channel_b), "message failed checksum verification") == 0);
+    REQUIRE(message.data == slab + 16 + 64 + 8);
+    REQUIRE(xchg_channel_return(&channel_b, &message));
+    REQUIRE_FALSE(xchg_channel_receive(&channel_b, &message));
+    REQUIRE(strcmp(xchg_channel_strerror(&channel_b), "channel is empty") == 0);
+}
+
+TEST_CASE("channel checksum known value", "[channel]")
+{
+    char slab[144] = {};
+
+    struct xchg_channel channel_a = {};
+    REQUIRE(xchg_channel_init_ex(&channel_a, xchg_channel_flag_checksum, 64, nullptr, 0, slab, sizeof(slab)));
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_channel_prepare(&channel_a, &message));
+    memcpy(message.data, "123456789", 9);
+    REQUIRE(xchg_message_seek(&message, 9));
+    REQUIRE(xchg_channel_send(&channel_a, &message));
+
+    uint32_t length = 0;
+    uint32_t checksum = 0;
+    memcpy(&length, slab + 16, sizeof(length));
+    memcpy(&checksum, slab + 16 + 4, sizeof(checksum));
+    REQUIRE(length == 9);
+    REQUIRE(checksum == 0xE3069283);
+}
+
+TEST_CASE("channel header", "[channel]")
+{
+    char slab[4112] = {};
+
+    struct xchg_channel channel_a = {};
+    REQUIRE(xchg_channel_init_ex(&channel_a, xchg_channel_flag_header, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel channel_b = {};
+    REQUIRE(xchg_channel_init_ex(&channel_b, xchg_channel_flag_header, 64, slab, sizeof(slab), nullptr, 0));
+
+    struct xchg_message message = {};
+    struct xchg_header header = {};
+
+    for(uint32_t i = 0; i < 96; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&channel_a, &message));
+        REQUIRE(message.length == 64 - sizeof(struct xchg_header));
+        REQUIRE(xchg_message_write_uint32(&message, i));
+        if(i % 2 == 0)
+        {
+            REQUIRE(xchg_channel_send_typed(&channel_a, &message, 1000 + i));
+        }
+        else
+        {
+            REQUIRE(xchg_channel_send(&channel_a, &message));
+        }
+
+        REQUIRE(xchg_channel_receive(&channel_b, &message));
+        REQUIRE(message.length == 5);
+        REQUIRE(xchg_channel_header(&channel_b, &message, &header));
+        REQUIRE(header.length == 5);
+        REQUIRE(header.checksum == 0);
+        REQUIRE(header.type == ((i % 2 == 0) ? 1000 + i : 0));
+        REQUIRE(header.sequence == i);
+
+        uint32_t value = 0;
+        REQUIRE(xchg_message_read_uint32(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+        REQUIRE(xchg_channel_return(&channel_b, &message));
+    }
+
+    REQUIRE_FALSE(xchg_channel_header(&channel_a, &message, &header));
+    REQUIRE(xchg_channel_strerror(&channel_a));
+
+    struct xchg_channel channel_c = {};
+    REQUIRE(xchg_channel_init_ex(&channel_c, xchg_channel_flag_header, 64, slab, sizeof(slab), nullptr, 0));
+    REQUIRE(channel_c.egress.sequence == 0);
+    struct xchg_channel channel_d = {};
+    REQUIRE(xchg_channel_init_ex(&channel_d, xchg_channel_flag_header, 64, nullptr, 0, slab, sizeof(slab)));
+    REQUIRE(channel_d.egress.sequence == 96);
+
+    struct xchg_channel channel_e = {};
+    REQUIRE(xchg_channel_init(&channel_e, 64, slab, sizeof(slab), nullptr, 0));
+    REQUIRE_FALSE(xchg_channel_header(&channel_e, &message, &header));
+    REQUIRE(xchg_channel_strerror(&channel_e));
+}
+
+TEST_CASE("channel header checksum", "[channel]")
+{
+    char slab[4112] = {};
+
+    uint32_t flags = xchg_channel_flag_header | xchg_channel_flag_checksum;
+    struct xchg_channel channel_a = {};
+    REQUIRE(xchg_channel_init_ex(&channel_a, flags, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel channel_b = {};
+    REQUIRE(xchg_channel_init_ex(&channel_b, flags, 64, slab, sizeof(slab), nullptr, 0));
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_channel_prepare(&channel_a, &message));
+    REQUIRE(xchg_message_write_uint8_list(&message, (const uint8_t *)"alex forster", 12));
+    REQUIRE(xchg_channel_send_typed(&channel_a, &message, 7));
+
+    REQUIRE(xchg_channel_receive(&channel_b, &message));
+    struct xchg_header header = {};
+    REQUIRE(xchg_channel_header(&channel_b, &message, &header));
+    REQUIRE(header.length == 14);
+    REQUIRE(header.checksum != 0);
+    REQUIRE(header.type == 7);
+    REQUIRE(xchg_channel_return(&channel_b, &message));
+}
+
+TEST_CASE("channel length", "[channel]")
+{
+    char slab[144] = {};
+
+    struct xchg_channel channel_a = {};
+    REQUIRE(xchg_channel_init_ex(&channel_a, xchg_channel_flag_length, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel channel_b = {};
+    REQUIRE(xchg_channel_init_ex(&channel_b, xchg_channel_flag_length, 64, slab, sizeof(slab), nullptr, 0));
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+
+    for(uint64_t i = 0; i < 2; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&channel_a, &message));
+        REQUIRE(message.length == 56);
+        for(uint64_t j = 0; j < 6; j++)
+        {
+            REQUIRE(xchg_message_write_uint64(&message, j));
+        }
+        REQUIRE(xchg_channel_send(&channel_a, &message));
+        REQUIRE(xchg_channel_receive(&channel_b, &message));
+        REQUIRE(message.length == 54);
+        REQUIRE(xchg_channel_return(&channel_b, &message));
+    }
+
+    REQUIRE(xchg_channel_prepare(&channel_a, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 42));
+    REQUIRE(xchg_channel_send(&channel_a, &message));
+
+    REQUIRE(xchg_channel_receive(&channel_b, &message));
+    REQUIRE(message.length == 9);
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 42);
+    REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+    REQUIRE_FALSE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(xchg_channel_return(&channel_b, &message));
+
+    REQUIRE(xchg_channel_prepare(&channel_a, &message));
+    REQUIRE(xchg_channel_send(&channel_a, &message));
+    REQUIRE(xchg_channel_receive(&channel_b, &message));
+    REQUIRE(message.length == 0);
+    REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+    REQUIRE(xchg_channel_return(&channel_b, &message));
+}
+
+TEST_CASE("channel liveness", "[channel]")
+{
+    const size_t sz_slab = XCHG_RING_HEADER_SIZE + 256;
+    char *slab = (char *)mmap(nullptr, sz_slab, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(slab != MAP_FAILED);
+
+    struct xchg_channel consumer = {};
+    REQUIRE_FALSE(xchg_channel_init_ex(&consumer, xchg_channel_flag_liveness, 64, slab, 16 + 256, nullptr, 0));
+    REQUIRE(xchg_channel_strerror(&consumer));
+    REQUIRE(xchg_channel_init_ex(&consumer, xchg_channel_flag_liveness, 64, slab, sz_slab, nullptr, 0));
+    REQUIRE_FALSE(xchg_channel_peer_alive(&consumer, 0));
+    REQUIRE(xchg_channel_strerror(&consumer));
+
+    char plain_slab[16 + 256] = {};
+    struct xchg_channel plain = {};
+    REQUIRE(xchg_channel_init(&plain, 64, plain_slab, sizeof(plain_slab), nullptr, 0));
+    REQUIRE_FALSE(xchg_channel_heartbeat(&plain));
+    REQUIRE(xchg_channel_strerror(&plain));
+    REQUIRE_FALSE(xchg_channel_peer_alive(&plain, 0));
+    REQUIRE_FALSE(xchg_channel_recover(&plain, false));
+
+    // a producer process which sends two messages and dies
+
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if(pid == 0)
+    {
+        struct xchg_channel producer = {};
+        struct xchg_message message = {};
+        xchg_channel_init_ex(&producer, xchg_channel_flag_liveness, 64, nullptr, 0, slab, sz_slab);
+        for(uint64_t i = 0; i < 2; i++)
+        {
+            xchg_channel_prepare(&producer, &message);
+            xchg_message_write_uint64(&message, i);
+            xchg_channel_send(&producer, &message);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+
+    REQUIRE_FALSE(xchg_channel_peer_alive(&consumer, 0));
+    REQUIRE(std::string(xchg_channel_strerror(&consumer)) == "peer process has exited");
+
+    // once recovered, a replacement producer resumes after the messages which are still queued
+
+    REQUIRE(xchg_channel_recover(&consumer, false));
+    REQUIRE_FALSE(xchg_channel_peer_alive(&consumer, 0));
+    REQUIRE(std::string(xchg_channel_strerror(&consumer)) == "peer has not attached");
+
+    struct xchg_channel replacement = {};
+    REQUIRE(xchg_channel_init_ex(&replacement, xchg_channel_flag_liveness, 64, nullptr, 0, slab, sz_slab));
+    REQUIRE_FALSE(xchg_channel_recover(&consumer, true));
+    REQUIRE(std::string(xchg_channel_strerror(&consumer)) == "peer process is still running");
+    REQUIRE(xchg_channel_peer_alive(&consumer, 0));
+    REQUIRE(xchg_channel_peer_alive(&consumer, 1000000000u));
+    REQUIRE(xchg_channel_heartbeat(&replacement));
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_channel_prepare(&replacement, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 2));
+    REQUIRE(xchg_channel_send(&replacement, &message));
+
+    uint64_t value = 0;
+    for(uint64_t i = 0; i < 3; i++)
+    {
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+
+    // recovering with discard drops whatever the next producer left queued when it died
+
+    pid = fork();
+    REQUIRE(pid >= 0);
+    if(pid == 0)
+    {
+        struct xchg_channel producer = {};
+        xchg_channel_init_ex(&producer, xchg_channel_flag_liveness, 64, nullptr, 0, slab, sz_slab);
+        xchg_channel_prepare(&producer, &message);
+        xchg_channel_send(&producer, &message);
+        _exit(0);
+    }
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+
+    REQUIRE_FALSE(xchg_channel_peer_alive(&consumer, 0));
+    REQUIRE(xchg_channel_recover(&consumer, true));
+    REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+    REQUIRE(xchg_channel_strerror(&consumer));
+
+    munmap(slab, sz_slab);
+}
+
+TEST_CASE("channel liveness duplex", "[channel]")
+{
+    const size_t sz_slab = XCHG_RING_HEADER_SIZE + 256;
+    char *slab_a = (char *)mmap(nullptr, sz_slab, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(slab_a != MAP_FAILED);
+    char *slab_b = (char *)mmap(nullptr, sz_slab, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(slab_b != MAP_FAILED);
+
+    struct xchg_channel channel = {};
+    REQUIRE(xchg_channel_init_ex(&channel, xchg_channel_flag_liveness, 64, slab_a, sz_slab, slab_b, sz_slab));
+
+    // a peer process which sends on a and dies, followed by a replacement which only attaches to b and also dies
+
+    for(int i = 0; i < 2; i++)
+    {
+        pid_t pid = fork();
+        REQUIRE(pid >= 0);
+        if(pid == 0)
+        {
+            struct xchg_channel peer = {};
+            struct xchg_message message = {};
+            if(i == 0)
+            {
+                xchg_channel_init_ex(&peer, xchg_channel_flag_liveness, 64, slab_b, sz_slab, slab_a, sz_slab);
+                xchg_channel_prepare(&peer, &message);
+                xchg_message_write_uint64(&message, 1);
+                xchg_channel_send(&peer, &message);
+            }
+            else
+            {
+                xchg_channel_init_ex(&peer, xchg_channel_flag_liveness, 64, slab_b, sz_slab, nullptr, 0);
+            }
+            _exit(0);
+        }
+        int status = 0;
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+
+        if(i == 0)
+        {
+            REQUIRE_FALSE(xchg_channel_peer_alive(&channel, 0));
+            REQUIRE(std::string(xchg_channel_strerror(&channel)) == "peer process has exited");
+        }
+    }
+
+    // the egress generation has moved on since the check, so neither ring is recovered
+
+    REQUIRE_FALSE(xchg_channel_recover(&channel, true));
+    REQUIRE(std::string(xchg_channel_strerror(&channel)) == "peer has already reattached");
+    REQUIRE_FALSE(xchg_channel_peer_alive(&channel, 0));
+    REQUIRE(std::string(xchg_channel_strerror(&channel)) == "peer process has exited");
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+    REQUIRE(xchg_channel_receive(&channel, &message));
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 1);
+    REQUIRE(xchg_channel_return(&channel, &message));
+
+    // checked again, both generations are current and both rings are recovered together
+
+    REQUIRE(xchg_channel_recover(&channel, false));
+    REQUIRE_FALSE(xchg_channel_peer_alive(&channel, 0));
+    REQUIRE(std::string(xchg_channel_strerror(&channel)) == "peer has not attached");
+
+    munmap(slab_a, sz_slab);
+    munmap(slab_b, sz_slab);
+}
+
+TEST_CASE("channel create attach", "[channel]")
+{
+    alignas(64) char slab_a[XCHG_RING_HEADER_SIZE + 512] = {};
+    alignas(64) char slab_b[XCHG_RING_HEADER_SIZE + 256] = {};
+
+    struct xchg_channel peer = {};
+    REQUIRE_FALSE(xchg_channel_attach(&peer, slab_a, sizeof(slab_a), slab_b, sizeof(slab_b)));
+    REQUIRE(std::string(xchg_channel_strerror(&peer)) == "ring header is missing");
+
+    struct xchg_channel creator = {};
+    REQUIRE_FALSE(xchg_channel_create(&creator, 0, 64, slab_a, sizeof(slab_a) - 1, slab_b, sizeof(slab_b)));
+    REQUIRE(xchg_channel_strerror(&creator));
+    REQUIRE(xchg_channel_create(&creator, xchg_channel_flag_header, 64, slab_b, sizeof(slab_b), slab_a, sizeof(slab_a)));
+    REQUIRE(creator.flags == (xchg_channel_flag_header | xchg_channel_flag_liveness));
+
+    // mis-sized or mis-configured attaches are rejected
+
+    REQUIRE_FALSE(xchg_channel_attach(&peer, slab_a, sizeof(slab_a) - 64, slab_b, sizeof(slab_b)));
+    REQUIRE(std::string(xchg_channel_strerror(&peer)) == "ring size does not match ring header");
+    REQUIRE_FALSE(xchg_channel_init_ex(&peer, xchg_channel_flag_liveness, 64, slab_a, sizeof(slab_a), nullptr, 0));
+    REQUIRE(std::string(xchg_channel_strerror(&peer)) == "ring geometry does not match ring header");
+    REQUIRE_FALSE(xchg_channel_init_ex(&peer, xchg_channel_flag_header | xchg_channel_flag_liveness, 128,
+                                       slab_a, sizeof(slab_a), nullptr, 0));
+    REQUIRE(xchg_channel_strerror(&peer));
+
+    uint32_t version = 0;
+    std::memcpy(&version, slab_a + 128 + sizeof(uint64_t) + sizeof(uint32_t), sizeof(version));
+    REQUIRE(version == XCHG_RING_VERSION);
+    version += 1;
+    std::memcpy(slab_a + 128 + sizeof(uint64_t) + sizeof(uint32_t), &version, sizeof(version));
+    REQUIRE_FALSE(xchg_channel_attach(&peer, slab_a, sizeof(slab_a), slab_b, sizeof(slab_b)));
+    REQUIRE(std::string(xchg_channel_strerror(&peer)) == "ring header version is unsupported");
+    version -= 1;
+    std::memcpy(slab_a + 128 + sizeof(uint64_t) + sizeof(uint32_t), &version, sizeof(version));
+
+    // the peer opens the channel from the shared memory alone
+
+    REQUIRE(xchg_channel_attach(&peer, slab_a, sizeof(slab_a), slab_b, sizeof(slab_b)));
+    REQUIRE_FALSE(xchg_channel_strerror(&peer));
+    REQUIRE(peer.flags == creator.flags);
+    REQUIRE(peer.ingress.sz_message == 64);
+    REQUIRE(peer.ingress.sz_data == 512);
+    REQUIRE(peer.egress.sz_data == 256);
+    REQUIRE(xchg_channel_peer_alive(&peer, 0));
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+
+    REQUIRE(xchg_channel_prepare(&creator, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 1));
+    REQUIRE(xchg_channel_send(&creator, &message));
+    REQUIRE(xchg_channel_receive(&peer, &message));
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 1);
+    REQUIRE(xchg_channel_return(&peer, &message));
+
+    REQUIRE(xchg_channel_prepare(&peer, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 2));
+    REQUIRE(xchg_channel_send(&peer, &message));
+    REQUIRE(xchg_channel_receive(&creator, &message));
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 2);
+    REQUIRE(xchg_channel_return(&creator, &message));
+
+    // creating again resets both rings
+
+    REQUIRE(xchg_channel_prepare(&creator, &message));
+    REQUIRE(xchg_channel_send(&creator, &message));
+    REQUIRE(xchg_channel_create(&creator, xchg_channel_flag_header, 64, slab_b, sizeof(slab_b), slab_a, sizeof(slab_a)));
+    REQUIRE(xchg_channel_attach(&peer, slab_a, sizeof(slab_a), slab_b, sizeof(slab_b)));
+    REQUIRE_FALSE(xchg_channel_receive(&peer, &message));
+}
+
+TEST_CASE("channel reattach producer", "[channel]")
+{
+    alignas(64) char slab_a[XCHG_RING_HEADER_SIZE + 256] = {};
+    alignas(64) char slab_b[XCHG_RING_HEADER_SIZE + 256] = {};
+
+    struct xchg_channel creator = {};
+    REQUIRE(xchg_channel_create(&creator, 0, 64, slab_b, sizeof(slab_b), slab_a, sizeof(slab_a)));
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+
+    for(uint64_t i = 0; i < 3; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&creator, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send(&creator, &message));
+    }
+
+    // a producer re-attaching to a ring with unread messages may only fill the one slot left
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_attach(&producer, slab_b, sizeof(slab_b), slab_a, sizeof(slab_a)));
+    REQUIRE(xchg_channel_prepare(&producer, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 3));
+    REQUIRE(xchg_channel_send(&producer, &message));
+    REQUIRE_FALSE(xchg_channel_prepare(&producer, &message));
+    REQUIRE(std::string(xchg_channel_strerror(&producer)) == "channel is full");
+
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_attach(&consumer, slab_a, sizeof(slab_a), slab_b, sizeof(slab_b)));
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+    REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+}
+
+TEST_CASE("channel statistics", "[channel]")
+{
+    alignas(64) char slab_a[XCHG_RING_HEADER_SIZE + 256] = {};
+    alignas(64) char slab_b[XCHG_RING_HEADER_SIZE + 256] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE_FALSE(xchg_channel_init_ex(&producer, xchg_channel_flag_statistics, 64, nullptr, 0, slab_a, 16 + 256));
+    REQUIRE(std::string(xchg_channel_strerror(&producer)) == "channel statistics require a ring header");
+
+    struct xchg_statistics statistics = {};
+    REQUIRE_FALSE(xchg_statistics_read(&statistics, slab_a, sizeof(slab_a)));
+    REQUIRE(std::string(xchg_statistics_strerror(&statistics)) == "ring header is missing");
+
+    REQUIRE(xchg_channel_create(&producer, xchg_channel_flag_length | xchg_channel_flag_statistics, 64,
+                                slab_b, sizeof(slab_b), slab_a, sizeof(slab_a)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_attach(&consumer, slab_a, sizeof(slab_a), slab_b, sizeof(slab_b)));
+
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+
+    // fill the ring, fail once more, then drain half of it
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send(&producer, &message));
+    }
+    REQUIRE_FALSE(xchg_channel_prepare(&producer, &message));
+
+    for(uint64_t i = 0; i < 2; i++)
+    {
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+
+    REQUIRE(xchg_statistics_read(&statistics, slab_a, sizeof(slab_a)));
+    REQUIRE_FALSE(xchg_statistics_strerror(&statistics));
+    REQUIRE(statistics.flags == (xchg_channel_flag_length | xchg_channel_flag_statistics | xchg_channel_flag_liveness));
+    REQUIRE(statistics.sz_message == 64);
+    REQUIRE(statistics.sz_data == 256);
+    REQUIRE(statistics.read_sequence == 2);
+    REQUIRE(statistics.write_sequence == 4);
+    REQUIRE(statistics.nr_pending == 2);
+    REQUIRE(statistics.producer_pid == (uint64_t)getpid());
+    REQUIRE(statistics.consumer_pid == (uint64_t)getpid());
+    REQUIRE(statistics.nr_sent == 4);
+    REQUIRE(statistics.sz_sent == 4 * 9);
+    REQUIRE(statistics.nr_full == 1);
+    REQUIRE(statistics.nr_high_water == 4);
+    REQUIRE(statistics.nr_received == 2);
+    REQUIRE(statistics.sz_received == 2 * 9);
+    REQUIRE(statistics.nr_empty == 1);
+
+    // rings created without the flag still report their positions
+
+    REQUIRE(xchg_channel_create(&producer, 0, 64, nullptr, 0, slab_a, sizeof(slab_a)));
+    REQUIRE(xchg_channel_prepare(&producer, &message));
+    REQUIRE(xchg_channel_send(&producer, &message));
+    REQUIRE(xchg_statistics_read(&statistics, slab_a, sizeof(slab_a)));
+    REQUIRE(statistics.write_sequence == 1);
+    REQUIRE(statistics.nr_pending == 1);
+    REQUIRE(statistics.nr_sent == 0);
+}
+
+TEST_CASE("channel statistics high water", "[channel]")
+{
+    alignas(64) char slab[XCHG_RING_HEADER_SIZE + 1024] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_create(&producer, xchg_channel_flag_statistics, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_attach(&consumer, slab, sizeof(slab), nullptr, 0));
+
+    // a consumer which keeps up never has more than one message pending, however many laps the ring goes round
+
+    struct xchg_message message = {};
+    for(uint64_t i = 0; i < 40; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send(&producer, &message));
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+
+    struct xchg_statistics statistics = {};
+    REQUIRE(xchg_statistics_read(&statistics, slab, sizeof(slab)));
+    REQUIRE(statistics.nr_sent == 40);
+    REQUIRE(statistics.nr_high_water == 1);
+}
+
+TEST_CASE("channel statistics peek", "[channel]")
+{
+    alignas(64) char slab[XCHG_RING_HEADER_SIZE + 256] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_create(&producer, xchg_channel_flag_header, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_attach(&consumer, slab, sizeof(slab), nullptr, 0));
+
+    struct xchg_message message = {};
+    for(uint64_t i = 0; i < 3; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send(&producer, &message));
+    }
+    REQUIRE(xchg_channel_receive(&consumer, &message));
+    REQUIRE(xchg_channel_return(&consumer, &message));
+
+    struct xchg_statistics statistics = {};
+    char buffer[64] = {};
+    size_t length = 0;
+
+    REQUIRE_FALSE(xchg_statistics_peek(&statistics, slab, 1, buffer, sizeof(buffer), &length));
+    REQUIRE(xchg_statistics_strerror(&statistics));
+    REQUIRE(xchg_statistics_read(&statistics, slab, sizeof(slab)));
+
+    REQUIRE_FALSE(xchg_statistics_peek(&statistics, slab, 1, buffer, 8, &length));
+    REQUIRE(std::string(xchg_statistics_strerror(&statistics)) == "buffer is too small");
+    REQUIRE_FALSE(xchg_statistics_peek(&statistics, slab, 0, buffer, sizeof(buffer), &length));
+    REQUIRE(std::string(xchg_statistics_strerror(&statistics)) == "message is not pending");
+    REQUIRE_FALSE(xchg_statistics_peek(&statistics, slab, 3, buffer, sizeof(buffer), &length));
+    REQUIRE(std::string(xchg_statistics_strerror(&statistics)) == "message is not pending");
+
+    for(uint64_t i = 1; i < 3; i++)
+    {
+        REQUIRE(xchg_statistics_peek(&statistics, slab, i, buffer, sizeof(buffer), &length));
+        REQUIRE(length == 9);
+
+        uint64_t value = 0;
+        REQUIRE(xchg_message_init(&message, buffer, length));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+    }
+
+    // peeking never disturbs the consumer
+
+    REQUIRE(xchg_channel_receive(&consumer, &message));
+    REQUIRE(xchg_channel_return(&consumer, &message));
+    REQUIRE_FALSE(xchg_statistics_peek(&statistics, slab, 1, buffer, sizeof(buffer), &length));
+    REQUIRE(xchg_statistics_peek(&statistics, slab, 2, buffer, sizeof(buffer), &length));
+}
+
+TEST_CASE("channel any size", "[channel]")
+{
+    char slab[16 + (96 * 5)] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE_FALSE(xchg_channel_init(&producer, 96, nullptr, 0, slab, sizeof(slab)));
+    REQUIRE(xchg_channel_strerror(&producer));
+    REQUIRE_FALSE(xchg_channel_init_ex(&producer, xchg_channel_flag_any_size, 96, nullptr, 0, slab, sizeof(slab) - 8));
+    REQUIRE(xchg_channel_strerror(&producer));
+    REQUIRE(xchg_channel_init_ex(&producer, xchg_channel_flag_any_size | xchg_channel_flag_length, 96,
+                                 nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init_ex(&consumer, xchg_channel_flag_any_size | xchg_channel_flag_length, 96,
+                                 slab, sizeof(slab), nullptr, 0));
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+    uint64_t next = 0;
+
+    // five slots per ring, so uneven bursts exercise every wraparound offset
+
+    for(uint64_t round = 0; round < 20; round++)
+    {
+        uint64_t burst = 1 + (round % 5);
+        for(uint64_t i = 0; i < burst; i++)
+        {
+            REQUIRE(xchg_channel_prepare(&producer, &message));
+            REQUIRE(message.length == 88);
+            REQUIRE(xchg_message_write_uint64(&message, next + i));
+            REQUIRE(xchg_channel_send(&producer, &message));
+        }
+        if(burst == 5)
+        {
+            REQUIRE_FALSE(xchg_channel_prepare(&producer, &message));
+        }
+        for(uint64_t i = 0; i < burst; i++)
+        {
+            REQUIRE(xchg_channel_receive(&consumer, &message));
+            REQUIRE(xchg_message_read_uint64(&message, &value));
+            REQUIRE(value == next + i);
+            REQUIRE(xchg_channel_return(&consumer, &message));
+        }
+        REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+        next += burst;
+    }
+
+    // a consumer which attaches mid-stream picks up at the right slot
+
+    REQUIRE(xchg_channel_prepare(&producer, &message));
+    REQUIRE(xchg_message_write_uint64(&message, next));
+    REQUIRE(xchg_channel_send(&producer, &message));
+
+    struct xchg_channel late = {};
+    REQUIRE(xchg_channel_init_ex(&late, xchg_channel_flag_any_size | xchg_channel_flag_length, 96,
+                                 slab, sizeof(slab), nullptr, 0));
+    REQUIRE(xchg_channel_receive(&late, &message));
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == next);
+}
+
+TEST_CASE("channel refresh batch", "[channel]")
+{
+    char slab[16 + (64 * 8)] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, slab, sizeof(slab), nullptr, 0));
+
+    REQUIRE_FALSE(xchg_channel_set_prefetch(&consumer, 8));
+    REQUIRE(xchg_channel_strerror(&consumer));
+    REQUIRE(xchg_channel_set_prefetch(&consumer, 7));
+    REQUIRE(xchg_channel_set_prefetch(&producer, 0));
+    REQUIRE_FALSE(xchg_channel_set_refresh_batch(&producer, 4));
+    REQUIRE(xchg_channel_strerror(&producer));
+    REQUIRE_FALSE(xchg_channel_set_refresh_batch(&consumer, 0));
+    REQUIRE_FALSE(xchg_channel_set_refresh_batch(&consumer, 9));
+    REQUIRE(xchg_channel_set_refresh_batch(&consumer, 4));
+    REQUIRE_FALSE(xchg_channel_strerror(&consumer));
+
+    struct xchg_message message = {};
+    size_t r = 0;
+
+    for(uint64_t i = 0; i < 8; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send(&producer, &message));
+    }
+    REQUIRE_FALSE(xchg_channel_prepare(&producer, &message));
+
+    // the read position is published every fourth return
+
+    uint64_t value = 0;
+    for(uint64_t i = 0; i < 6; i++)
+    {
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_channel_return(&consumer, &message));
+
+        std::memcpy(&r, slab, sizeof(r));
+        REQUIRE(r == ((i + 1) / 4) * 4 * 64);
+    }
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, 8 + i));
+        REQUIRE(xchg_channel_send(&producer, &message));
+    }
+    REQUIRE_FALSE(xchg_channel_prepare(&producer, &message));
+
+    // ... and whenever the consumer catches up with everything it has seen
+
+    for(uint64_t i = 6; i < 12; i++)
+    {
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+    REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+
+    std::memcpy(&r, slab, sizeof(r));
+    REQUIRE(r == 12 * 64);
+}
+
+TEST_CASE("channel streaming", "[channel]")
+{
+    std::vector<char> slab(16 + (4096 * 4));
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init_ex(&producer, xchg_channel_flag_checksum, 4096, nullptr, 0, slab.data(), slab.size()));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init_ex(&consumer, xchg_channel_flag_checksum, 4096, slab.data(), slab.size(), nullptr, 0));
+
+    REQUIRE_FALSE(xchg_channel_set_streaming(&consumer, 64));
+    REQUIRE(xchg_channel_strerror(&consumer));
+    REQUIRE(xchg_channel_set_streaming(&producer, 64));
+    REQUIRE_FALSE(xchg_channel_strerror(&producer));
+
+    std::vector<uint8_t> payload(4000);
+    for(size_t i = 0; i < payload.size(); i++)
+    {
+        payload[i] = (uint8_t)(i * 7);
+    }
+
+    struct xchg_message message = {};
+
+    // values both below and above the threshold, starting at every alignment
+
+    for(size_t sz = 1; sz < 200; sz += 13)
+    {
+        for(size_t skew = 0; skew < 16; skew++)
+        {
+            REQUIRE(xchg_channel_prepare(&producer, &message));
+            REQUIRE(xchg_message_write_uint8_list(&message, payload.data(), skew));
+            REQUIRE(xchg_message_write_uint8_list(&message, payload.data() + skew, sz));
+            REQUIRE(xchg_channel_send(&producer, &message));
+
+            const uint8_t *list = nullptr;
+            uint64_t sz_list = 0;
+            REQUIRE(xchg_channel_receive(&consumer, &message));
+            REQUIRE_FALSE(xchg_channel_strerror(&consumer));
+            REQUIRE(xchg_message_read_uint8_list(&message, &list, &sz_list));
+            REQUIRE(sz_list == skew);
+            REQUIRE(xchg_message_read_uint8_list(&message, &list, &sz_list));
+            REQUIRE(sz_list == sz);
+            REQUIRE(std::memcmp(list, payload.data() + skew, sz) == 0);
+            REQUIRE(xchg_channel_return(&consumer, &message));
+        }
+    }
+
+    REQUIRE(xchg_channel_prepare(&producer, &message));
+    REQUIRE(xchg_message_write_uint8_list(&message, payload.data(), payload.size()));
+    REQUIRE(xchg_channel_send(&producer, &message));
+
+    const uint8_t *list = nullptr;
+    uint64_t sz_list = 0;
+    REQUIRE(xchg_channel_receive(&consumer, &message));
+    REQUIRE(xchg_message_read_uint8_list(&message, &list, &sz_list));
+    REQUIRE(sz_list == payload.size());
+    REQUIRE(std::memcmp(list, payload.data(), payload.size()) == 0);
+    REQUIRE(xchg_channel_return(&consumer, &message));
+}
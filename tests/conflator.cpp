@@ -0,0 +1,177 @@
+#include <thread>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("conflator create", "[conflator]")
+{
+    REQUIRE(xchg_conflator_size(0, 64) == 0);
+    REQUIRE(xchg_conflator_size(4, 0) == 0);
+    REQUIRE(xchg_conflator_size(4, 40) == 128 + 64 + (4 * 64));
+    REQUIRE(xchg_conflator_size(4, 64) == 128 + 64 + (4 * 128));
+
+    alignas(64) char buffer[1024] = {};
+    struct xchg_conflator conflator = {};
+    REQUIRE_FALSE(xchg_conflator_init(&conflator, 4, 64, buffer, 128 + 64 + (4 * 128) - 1));
+    REQUIRE(xchg_conflator_strerror(&conflator));
+    REQUIRE_FALSE(xchg_conflator_init(&conflator, 4, 64, buffer + 8, sizeof(buffer) - 8));
+    REQUIRE(xchg_conflator_strerror(&conflator));
+    REQUIRE_FALSE(xchg_conflator_init(&conflator, 0, 64, buffer, sizeof(buffer)));
+    REQUIRE(xchg_conflator_strerror(&conflator));
+    REQUIRE(xchg_conflator_init(&conflator, 4, 64, buffer, sizeof(buffer)));
+    REQUIRE_FALSE(xchg_conflator_strerror(&conflator));
+
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_conflator_prepare(&conflator, &message, 4));
+    REQUIRE(xchg_conflator_strerror(&conflator));
+}
+
+TEST_CASE("conflator conflation", "[conflator]")
+{
+    alignas(64) char buffer[1024] = {};
+    struct xchg_conflator producer = {};
+    REQUIRE(xchg_conflator_init(&producer, 4, 40, buffer, sizeof(buffer)));
+    struct xchg_conflator consumer = {};
+    REQUIRE(xchg_conflator_init(&consumer, 4, 40, buffer, sizeof(buffer)));
+
+    char copy[64];
+    size_t key = 0;
+    uint64_t value = 0;
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)));
+    REQUIRE(xchg_conflator_strerror(&consumer));
+
+    for(uint64_t i = 0; i < 100; i++)
+    {
+        REQUIRE(xchg_conflator_prepare(&producer, &message, 2));
+        REQUIRE(xchg_message_write_uint64(&message, 200 + i));
+        REQUIRE(xchg_conflator_send(&producer, &message));
+        REQUIRE(xchg_conflator_prepare(&producer, &message, 0));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_conflator_send(&producer, &message));
+    }
+    REQUIRE(xchg_conflator_prepare(&producer, &message, 3));
+    REQUIRE(xchg_message_write_uint64(&message, 300));
+    REQUIRE(xchg_conflator_send(&producer, &message));
+
+    // each key is delivered once, with its latest value, in the order its first pending update arrived
+
+    REQUIRE(xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)));
+    REQUIRE(key == 2);
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 299);
+    REQUIRE(xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)));
+    REQUIRE(key == 0);
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 99);
+
+    REQUIRE(xchg_conflator_prepare(&producer, &message, 2));
+    REQUIRE(xchg_message_write_uint64(&message, 1000));
+    REQUIRE(xchg_conflator_send(&producer, &message));
+
+    REQUIRE(xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)));
+    REQUIRE(key == 3);
+    REQUIRE(message.length == 9);
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 300);
+    REQUIRE(xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)));
+    REQUIRE(key == 2);
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 1000);
+    REQUIRE_FALSE(xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)));
+}
+
+TEST_CASE("conflator partial write", "[conflator]")
+{
+    alignas(64) char buffer[1024] = {};
+    struct xchg_conflator producer = {};
+    REQUIRE(xchg_conflator_init(&producer, 2, 40, buffer, sizeof(buffer)));
+    struct xchg_conflator consumer = {};
+    REQUIRE(xchg_conflator_init(&consumer, 2, 40, buffer, sizeof(buffer)));
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_conflator_prepare(&producer, &message, 1));
+    REQUIRE(xchg_message_write_uint64(&message, 1));
+    REQUIRE(xchg_conflator_send(&producer, &message));
+
+    REQUIRE(xchg_conflator_prepare(&producer, &message, 1));
+    REQUIRE_FALSE(xchg_conflator_prepare(&producer, &message, 0));
+    REQUIRE(xchg_message_write_uint64(&message, 2));
+
+    // while the update is being written, its key is not delivered at all
+
+    char copy[64];
+    size_t key = 0;
+    uint64_t value = 0;
+    struct xchg_message received = {};
+    REQUIRE_FALSE(xchg_conflator_receive(&consumer, &key, &received, copy, sizeof(copy)));
+    REQUIRE(xchg_conflator_strerror(&consumer));
+
+    REQUIRE(xchg_conflator_send(&producer, &message));
+    REQUIRE_FALSE(xchg_conflator_send(&producer, &message));
+    REQUIRE(xchg_conflator_receive(&consumer, &key, &received, copy, sizeof(copy)));
+    REQUIRE(key == 1);
+    REQUIRE(xchg_message_read_uint64(&received, &value));
+    REQUIRE(value == 2);
+    REQUIRE_FALSE(xchg_conflator_receive(&consumer, &key, &received, copy, sizeof(copy)));
+}
+
+TEST_CASE("conflator threads", "[conflator]")
+{
+    const size_t nr_keys = 8;
+    const uint64_t nr_updates = 200000;
+
+    alignas(64) char buffer[1024] = {};
+    struct xchg_conflator producer = {};
+    REQUIRE(xchg_conflator_init(&producer, nr_keys, 40, buffer, sizeof(buffer)));
+    struct xchg_conflator consumer = {};
+    REQUIRE(xchg_conflator_init(&consumer, nr_keys, 40, buffer, sizeof(buffer)));
+
+    std::thread thread([&producer, nr_keys, nr_updates]() {
+        for(uint64_t i = 0; i < nr_updates; i++)
+        {
+            struct xchg_message message = {};
+            xchg_conflator_prepare(&producer, &message, i % nr_keys);
+            xchg_message_write_uint64(&message, i);
+            xchg_message_write_uint64(&message, ~i);
+            xchg_conflator_send(&producer, &message);
+        }
+    });
+
+    uint64_t latest[nr_keys] = {};
+    bool consistent = true;
+    bool monotonic = true;
+    size_t nr_received = 0;
+
+    while(true)
+    {
+        char copy[64];
+        size_t key = 0;
+        struct xchg_message message = {};
+        if(!xchg_conflator_receive(&consumer, &key, &message, copy, sizeof(copy)))
+        {
+            if(latest[nr_keys - 1] == nr_updates - 1)
+            {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t a = 0, b = 0;
+        xchg_message_read_uint64(&message, &a);
+        xchg_message_read_uint64(&message, &b);
+        consistent &= (a == ~b) && (a % nr_keys == key);
+        monotonic &= (a >= latest[key]);
+        latest[key] = a;
+        nr_received++;
+    }
+
+    thread.join();
+
+    REQUIRE(consistent);
+    REQUIRE(monotonic);
+    for(size_t key = 0; key < nr_keys; key++)
+    {
+        REQUIRE(latest[key] == nr_updates - nr_keys + key);
+    }
+}
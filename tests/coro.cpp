@@ -0,0 +1,267 @@
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.hpp"
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+static xchg::task coro_produce(xchg::channel channel, uint64_t first, uint64_t count)
+{
+    for(uint64_t i = first; i < first + count; i++)
+    {
+        xchg_message message = co_await channel.prepare();
+        xchg_message_write_uint64(&message, i);
+        channel.send(message);
+    }
+}
+
+static xchg::task coro_consume(xchg::channel channel, uint64_t count, uint64_t *total, size_t *nr_done)
+{
+    for(uint64_t i = 0; i < count; i++)
+    {
+        xchg_message message = co_await channel.receive();
+        uint64_t value = 0;
+        xchg_message_read_uint64(&message, &value);
+        channel.release(message);
+        *total += value;
+    }
+    *nr_done += 1;
+}
+
+TEST_CASE("coro ready", "[coro]")
+{
+    char buffer[272] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, buffer, sizeof(buffer)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, buffer, sizeof(buffer), nullptr, 0));
+
+    xchg::poll_executor executor;
+
+    uint64_t total = 0;
+    size_t nr_done = 0;
+
+    // everything fits in the ring, so neither coroutine ever suspends
+
+    coro_produce(xchg::channel(&producer, executor), 1, 4);
+    REQUIRE(executor.empty());
+    coro_consume(xchg::channel(&consumer, executor), 4, &total, &nr_done);
+    REQUIRE(executor.empty());
+    REQUIRE(nr_done == 1);
+    REQUIRE(total == 1 + 2 + 3 + 4);
+}
+
+TEST_CASE("coro suspend", "[coro]")
+{
+    char buffer[272] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, buffer, sizeof(buffer)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, buffer, sizeof(buffer), nullptr, 0));
+
+    xchg::poll_executor executor;
+
+    uint64_t total = 0;
+    size_t nr_done = 0;
+
+    // many more consumers than slots, and a producer which outruns the ring
+
+    const uint64_t nr_consumers = 1000;
+    for(uint64_t i = 0; i < nr_consumers; i++)
+    {
+        coro_consume(xchg::channel(&consumer, executor), 1, &total, &nr_done);
+    }
+    REQUIRE(nr_done == 0);
+    REQUIRE_FALSE(executor.empty());
+
+    coro_produce(xchg::channel(&producer, executor), 1, nr_consumers);
+    REQUIRE(total == 0);
+
+    executor.run();
+
+    REQUIRE(executor.empty());
+    REQUIRE(nr_done == nr_consumers);
+    REQUIRE(total == (nr_consumers * (nr_consumers + 1)) / 2);
+}
+
+TEST_CASE("coro errors", "[coro]")
+{
+    char buffer[272] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init_ex(&producer, xchg_channel_flag_checksum, 64, nullptr, 0, buffer, sizeof(buffer)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init_ex(&consumer, xchg_channel_flag_checksum, 64, buffer, sizeof(buffer), nullptr, 0));
+
+    xchg::poll_executor executor;
+
+    size_t nr_done = 0;
+    auto prepare = [](xchg::channel channel, size_t *nr_done) -> xchg::task {
+        xchg_message message = co_await channel.prepare();
+        REQUIRE(message.data == nullptr);
+        REQUIRE(channel.strerror());
+        *nr_done += 1;
+    };
+    prepare(xchg::channel(&consumer, executor), &nr_done);
+    REQUIRE(nr_done == 1);
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_channel_prepare(&producer, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 1));
+    REQUIRE(xchg_channel_send(&producer, &message));
+    buffer[16 + 8] ^= 1;
+
+    auto receive = [](xchg::channel channel, size_t *nr_done) -> xchg::task {
+        xchg_message message = co_await channel.receive();
+        REQUIRE(message.data != nullptr);
+        REQUIRE(channel.strerror());
+        REQUIRE(channel.release(message));
+        *nr_done += 1;
+    };
+    receive(xchg::channel(&consumer, executor), &nr_done);
+    REQUIRE(nr_done == 2);
+    REQUIRE(executor.empty());
+}
+
+TEST_CASE("coro held", "[coro]")
+{
+    char source[272] = {};
+    char sink[272] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, source, sizeof(source)));
+    struct xchg_channel relay = {};
+    REQUIRE(xchg_channel_init(&relay, 64, source, sizeof(source), sink, sizeof(sink)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, sink, sizeof(sink), nullptr, 0));
+
+    xchg::poll_executor executor;
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+
+    // each coroutine holds its first slot while awaiting the second operation, so the other coroutine must not be
+    // handed the same slot in the meantime
+
+    SECTION("receive")
+    {
+        auto forward = [](xchg::channel channel) -> xchg::task {
+            xchg_message received = co_await channel.receive();
+            xchg_message prepared = co_await channel.prepare();
+            uint64_t value = 0;
+            xchg_message_read_uint64(&received, &value);
+            xchg_message_write_uint64(&prepared, value);
+            channel.send(prepared);
+            channel.release(received);
+        };
+
+        for(uint64_t i = 0; i < 4; i++)
+        {
+            REQUIRE(xchg_channel_prepare(&relay, &message));
+            REQUIRE(xchg_message_write_uint64(&message, 100 + i));
+            REQUIRE(xchg_channel_send(&relay, &message));
+        }
+        for(uint64_t i = 1; i <= 2; i++)
+        {
+            REQUIRE(xchg_channel_prepare(&producer, &message));
+            REQUIRE(xchg_message_write_uint64(&message, i));
+            REQUIRE(xchg_channel_send(&producer, &message));
+        }
+
+        forward(xchg::channel(&relay, executor));
+        forward(xchg::channel(&relay, executor));
+        REQUIRE_FALSE(executor.empty());
+
+        for(uint64_t i = 0; i < 4; i++)
+        {
+            REQUIRE(xchg_channel_receive(&consumer, &message));
+            REQUIRE(xchg_message_read_uint64(&message, &value));
+            REQUIRE(value == 100 + i);
+            REQUIRE(xchg_channel_return(&consumer, &message));
+        }
+    }
+
+    SECTION("prepare")
+    {
+        auto forward = [](xchg::channel channel) -> xchg::task {
+            xchg_message prepared = co_await channel.prepare();
+            xchg_message received = co_await channel.receive();
+            uint64_t value = 0;
+            xchg_message_read_uint64(&received, &value);
+            xchg_message_write_uint64(&prepared, value);
+            channel.release(received);
+            channel.send(prepared);
+        };
+
+        forward(xchg::channel(&relay, executor));
+        forward(xchg::channel(&relay, executor));
+        REQUIRE_FALSE(executor.empty());
+
+        for(uint64_t i = 1; i <= 2; i++)
+        {
+            REQUIRE(xchg_channel_prepare(&producer, &message));
+            REQUIRE(xchg_message_write_uint64(&message, i));
+            REQUIRE(xchg_channel_send(&producer, &message));
+        }
+    }
+
+    executor.run();
+
+    for(uint64_t i = 1; i <= 2; i++)
+    {
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+    REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+}
+
+TEST_CASE("coro threads", "[coro]")
+{
+    std::vector<char> buffer(16 + 4096);
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, buffer.data(), buffer.size()));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, buffer.data(), buffer.size(), nullptr, 0));
+
+    const uint64_t nr_producers = 8;
+    const uint64_t nr_messages = 10000;
+
+    std::thread thread([&consumer, nr_producers, nr_messages]() {
+        xchg::poll_executor executor;
+        uint64_t total = 0;
+        size_t nr_done = 0;
+        coro_consume(xchg::channel(&consumer, executor), nr_producers * nr_messages, &total, &nr_done);
+        while(!executor.empty())
+        {
+            if(executor.poll() == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        CHECK(total == (nr_producers * nr_messages * (nr_producers * nr_messages - 1)) / 2);
+    });
+
+    xchg::poll_executor executor;
+    for(uint64_t i = 0; i < nr_producers; i++)
+    {
+        coro_produce(xchg::channel(&producer, executor), i * nr_messages, nr_messages);
+    }
+    while(!executor.empty())
+    {
+        if(executor.poll() == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    thread.join();
+}
+
+#endif
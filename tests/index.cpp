@@ -0,0 +1,226 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("index create", "[index]")
+{
+    alignas(8) char buffer[256] = {};
+
+    struct xchg_index reader = {};
+    REQUIRE_FALSE(xchg_index_open(&reader, buffer, sizeof(buffer)));
+    REQUIRE(std::string(xchg_index_strerror(&reader)) == "index header is missing");
+
+    struct xchg_index index = {};
+    REQUIRE_FALSE(xchg_index_init(&index, buffer, XCHG_INDEX_HEADER_SIZE, 4));
+    REQUIRE(std::string(xchg_index_strerror(&index)) == "index buffer is invalid");
+    REQUIRE_FALSE(xchg_index_init(&index, buffer, sizeof(buffer), 0));
+    REQUIRE(std::string(xchg_index_strerror(&index)) == "index interval is invalid");
+    REQUIRE(xchg_index_init(&index, buffer, sizeof(buffer), 4));
+    REQUIRE_FALSE(xchg_index_strerror(&index));
+
+    // the buffer has room for six entries after the header
+
+    struct xchg_record record = {};
+    for(uint64_t i = 0; i < 24; i++)
+    {
+        record.sequence = i;
+        record.timestamp = i == 12 ? 990 : 1000 + i;
+        REQUIRE(xchg_index_add(&index, &record, 0, XCHG_RECORDING_HEADER_SIZE + i * 32));
+    }
+    record.sequence = 24;
+    REQUIRE_FALSE(xchg_index_add(&index, &record, 0, 0));
+    REQUIRE(std::string(xchg_index_strerror(&index)) == "index is full");
+
+    // an index which does not validate is reported rather than started afresh
+
+    struct xchg_index restarted = {};
+    REQUIRE_FALSE(xchg_index_init(&restarted, buffer, XCHG_INDEX_HEADER_SIZE + 2 * sizeof(struct xchg_index_entry), 4));
+    REQUIRE(std::string(xchg_index_strerror(&restarted)) == "index size does not match index header");
+
+    // a restarted index keeps its entries, as long as the interval matches
+
+    REQUIRE_FALSE(xchg_index_init(&restarted, buffer, sizeof(buffer), 8));
+    REQUIRE(std::string(xchg_index_strerror(&restarted)) == "index interval does not match index header");
+    REQUIRE(xchg_index_init(&restarted, buffer, sizeof(buffer), 4));
+    record.sequence = 20;
+    REQUIRE_FALSE(xchg_index_add(&restarted, &record, 0, 0));
+    REQUIRE(std::string(xchg_index_strerror(&restarted)) == "index sequence is out of order");
+
+    REQUIRE(xchg_index_open(&reader, buffer, sizeof(buffer)));
+    REQUIRE_FALSE(xchg_index_add(&reader, &record, 0, 0));
+    REQUIRE(std::string(xchg_index_strerror(&reader)) == "index is not open for writing");
+
+    struct xchg_index_entry entry = {};
+    REQUIRE(xchg_index_seek_sequence(&reader, 0, &entry));
+    REQUIRE(entry.sequence == 0);
+    REQUIRE(xchg_index_seek_sequence(&reader, 11, &entry));
+    REQUIRE(entry.sequence == 8);
+    REQUIRE(entry.timestamp == 1008);
+    REQUIRE(entry.offset == XCHG_RECORDING_HEADER_SIZE + 8 * 32);
+    REQUIRE(xchg_index_seek_sequence(&reader, 12, &entry));
+    REQUIRE(entry.sequence == 12);
+    REQUIRE(entry.timestamp == 1008);
+    REQUIRE(xchg_index_seek_sequence(&reader, UINT64_MAX, &entry));
+    REQUIRE(entry.sequence == 20);
+
+    REQUIRE(xchg_index_seek_time(&reader, 1017, &entry));
+    REQUIRE(entry.sequence == 16);
+
+    // the record at sequence 12 went back in time, so its entry was moved up to the previous entry's timestamp
+
+    REQUIRE(xchg_index_seek_time(&reader, 1008, &entry));
+    REQUIRE(entry.sequence == 12);
+    REQUIRE_FALSE(xchg_index_seek_time(&reader, 999, &entry));
+    REQUIRE(std::string(xchg_index_strerror(&reader)) == "index has no entry at or before the target");
+}
+
+TEST_CASE("index recorder seek", "[index]")
+{
+    std::vector<uint64_t> recording(4096);
+    std::vector<uint64_t> offsets(64);
+    char *buffer = reinterpret_cast<char *>(recording.data());
+    char data[64] = {};
+
+    struct xchg_index index = {};
+    REQUIRE(xchg_index_init(&index, reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(uint64_t), 4));
+
+    struct xchg_recorder recorder = {};
+    REQUIRE(xchg_recorder_init(&recorder, buffer, recording.size() * sizeof(uint64_t)));
+    REQUIRE(xchg_recorder_set_index(&recorder, &index));
+
+    struct xchg_message message = {};
+    for(uint64_t i = 0; i < 100; i++)
+    {
+        REQUIRE(xchg_message_init(&message, data, 9 + (i % 3) * 8));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_recorder_record(&recorder, &message, 0));
+    }
+
+    struct xchg_replayer replayer = {};
+    REQUIRE(xchg_replayer_init(&replayer, buffer, recording.size() * sizeof(uint64_t)));
+
+    // seeking lands on the nearest indexed record, from which the target is at most three records away
+
+    struct xchg_index_entry entry = {};
+    REQUIRE(xchg_index_seek_sequence(&index, 37, &entry));
+    REQUIRE(entry.sequence == 36);
+    REQUIRE(entry.segment == 0);
+    REQUIRE(xchg_replayer_seek(&replayer, entry.offset, entry.sequence));
+
+    struct xchg_record record = {};
+    const char *payload = nullptr;
+    REQUIRE(xchg_replayer_read(&replayer, &record, &payload));
+    REQUIRE(record.sequence == 36);
+    REQUIRE(xchg_replayer_read(&replayer, &record, &payload));
+    REQUIRE(record.sequence == 37);
+
+    struct xchg_message received = {};
+    uint64_t value = 0;
+    REQUIRE(xchg_message_init(&received, const_cast<char *>(payload), record.length));
+    REQUIRE(xchg_message_read_uint64(&received, &value));
+    REQUIRE(value == 37);
+
+    // seeking by time finds the last indexed record which was written no later than the target
+
+    struct xchg_index_entry later = {};
+    REQUIRE(xchg_index_seek_sequence(&index, 60, &later));
+    REQUIRE(xchg_index_seek_time(&index, later.timestamp, &entry));
+    REQUIRE(entry.timestamp == later.timestamp);
+    REQUIRE(entry.sequence >= later.sequence);
+    REQUIRE(xchg_replayer_seek(&replayer, entry.offset, entry.sequence));
+    REQUIRE(xchg_replayer_read(&replayer, &record, &payload));
+    REQUIRE(record.sequence == entry.sequence);
+    REQUIRE(record.timestamp == entry.timestamp);
+
+    REQUIRE_FALSE(xchg_replayer_seek(&replayer, entry.offset + 4, entry.sequence));
+    REQUIRE(std::string(xchg_replayer_strerror(&replayer)) == "recording offset is invalid");
+    REQUIRE_FALSE(xchg_replayer_seek(&replayer, entry.offset, entry.sequence + 1));
+    REQUIRE(std::string(xchg_replayer_strerror(&replayer)) == "recording offset is invalid");
+    REQUIRE_FALSE(xchg_replayer_seek(&replayer, 0, 0));
+    REQUIRE_FALSE(xchg_replayer_seek(&replayer, recording.size() * sizeof(uint64_t), 0));
+}
+
+TEST_CASE("index journal seek", "[index]")
+{
+    constexpr size_t nr_segments = 4;
+    constexpr size_t sz_segment = 1024;
+
+    std::vector<uint64_t> storage(nr_segments * sz_segment / sizeof(uint64_t));
+    std::vector<uint64_t> offsets(64);
+    char *segments = reinterpret_cast<char *>(storage.data());
+
+    struct xchg_index index = {};
+    REQUIRE(xchg_index_init(&index, reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(uint64_t), 8));
+
+    struct xchg_journal writer = {};
+    REQUIRE(xchg_journal_init(&writer, segments, sz_segment));
+    REQUIRE(xchg_journal_set_index(&writer, &index));
+
+    struct xchg_message message = {};
+    uint64_t segment = 0;
+    uint64_t nr_messages = 0;
+
+    while(segment < nr_segments)
+    {
+        if(!xchg_journal_prepare(&writer, &message) || !xchg_message_write_uint64(&message, nr_messages))
+        {
+            segment += 1;
+            if(segment < nr_segments)
+            {
+                REQUIRE(xchg_journal_roll(&writer, segments + segment * sz_segment, sz_segment));
+            }
+            continue;
+        }
+
+        REQUIRE(xchg_journal_send(&writer, &message, 0));
+        nr_messages += 1;
+    }
+
+    REQUIRE(nr_messages > 64);
+
+    // the index spans every segment, so a reader can start from any message in the journal
+
+    struct xchg_index reader_index = {};
+    REQUIRE(xchg_index_open(&reader_index, reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(uint64_t)));
+
+    for(uint64_t target : {uint64_t(0), uint64_t(7), nr_messages / 2, nr_messages - 1})
+    {
+        struct xchg_index_entry entry = {};
+        REQUIRE(xchg_index_seek_sequence(&reader_index, target, &entry));
+        REQUIRE(entry.sequence <= target);
+        REQUIRE(target - entry.sequence < 8);
+
+        struct xchg_journal reader = {};
+        REQUIRE(entry.segment < nr_segments);
+        REQUIRE(xchg_journal_open(&reader, segments + entry.segment * sz_segment, sz_segment));
+        REQUIRE(xchg_journal_seek(&reader, entry.offset, entry.sequence));
+
+        struct xchg_message received = {};
+        struct xchg_record record = {};
+        for(uint64_t sequence = entry.sequence; sequence < target; sequence++)
+        {
+            REQUIRE(xchg_journal_receive(&reader, &received));
+            REQUIRE(xchg_journal_return(&reader, &received));
+        }
+
+        uint64_t value = 0;
+        REQUIRE(xchg_journal_receive(&reader, &received));
+        REQUIRE(xchg_journal_record(&reader, &received, &record));
+        REQUIRE(record.sequence == target);
+        REQUIRE(xchg_message_read_uint64(&received, &value));
+        REQUIRE(value == target);
+    }
+
+    // only writers feed an index
+
+    struct xchg_journal reader = {};
+    REQUIRE(xchg_journal_open(&reader, segments, sz_segment));
+    REQUIRE_FALSE(xchg_journal_set_index(&reader, &index));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal is not open for writing");
+    REQUIRE_FALSE(xchg_journal_set_index(&writer, &reader_index));
+    REQUIRE(std::string(xchg_journal_strerror(&writer)) == "index is not open for writing");
+    REQUIRE(xchg_journal_set_index(&writer, nullptr));
+}
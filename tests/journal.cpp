@@ -0,0 +1,403 @@
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("journal create", "[journal]")
+{
+    alignas(8) char segment[256] = {};
+
+    struct xchg_journal reader = {};
+    REQUIRE_FALSE(xchg_journal_open(&reader, segment, sizeof(segment)));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "recording header is missing");
+
+    struct xchg_journal writer = {};
+    REQUIRE_FALSE(xchg_journal_init(&writer, segment, XCHG_RECORDING_HEADER_SIZE));
+    REQUIRE(std::string(xchg_journal_strerror(&writer)) == "journal segment is invalid");
+    REQUIRE_FALSE(xchg_journal_init(&writer, segment + 1, sizeof(segment) - 1));
+    REQUIRE(xchg_journal_strerror(&writer));
+    REQUIRE(xchg_journal_init(&writer, segment, sizeof(segment)));
+    REQUIRE_FALSE(xchg_journal_strerror(&writer));
+
+    REQUIRE(xchg_journal_open(&reader, segment, sizeof(segment)));
+
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_journal_receive(&reader, &message));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal has no more messages");
+
+    // each end only supports its own half of the operations
+
+    REQUIRE_FALSE(xchg_journal_prepare(&reader, &message));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal is not open for writing");
+    REQUIRE_FALSE(xchg_journal_receive(&writer, &message));
+    REQUIRE(std::string(xchg_journal_strerror(&writer)) == "journal is not open for reading");
+
+    uint64_t index = 1;
+    size_t offset = 0;
+    uint64_t sequence = 1;
+    REQUIRE(xchg_journal_tell(&writer, &index, &offset, &sequence));
+    REQUIRE(index == 0);
+    REQUIRE(offset == XCHG_RECORDING_HEADER_SIZE);
+    REQUIRE(sequence == 0);
+}
+
+TEST_CASE("journal append and tail", "[journal]")
+{
+    alignas(8) char first[256] = {};
+    alignas(8) char second[256] = {};
+
+    struct xchg_journal writer = {};
+    REQUIRE(xchg_journal_init(&writer, first, sizeof(first)));
+
+    struct xchg_journal reader = {};
+    REQUIRE(xchg_journal_open(&reader, first, sizeof(first)));
+
+    // messages are written in place, so the prepared message points straight into the segment
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_journal_prepare(&writer, &message));
+    REQUIRE(message.data == first + XCHG_RECORDING_HEADER_SIZE + sizeof(struct xchg_record));
+    REQUIRE(xchg_message_write_uint64(&message, 42));
+    REQUIRE(xchg_journal_send(&writer, &message, 7));
+
+    // an empty message is still appended
+
+    REQUIRE(xchg_journal_prepare(&writer, &message));
+    REQUIRE(xchg_journal_send(&writer, &message, 8));
+
+    struct xchg_message received = {};
+    struct xchg_record record = {};
+    uint64_t value = 0;
+
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(received.data == first + XCHG_RECORDING_HEADER_SIZE + sizeof(struct xchg_record));
+    REQUIRE(xchg_journal_record(&reader, &received, &record));
+    REQUIRE(record.sequence == 0);
+    REQUIRE(record.type == 7);
+    REQUIRE(record.length == 9);
+    REQUIRE(record.timestamp > 0);
+    REQUIRE(xchg_message_read_uint64(&received, &value));
+    REQUIRE(value == 42);
+
+    // receiving again without returning yields the same message
+
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_journal_record(&reader, &received, &record));
+    REQUIRE(record.sequence == 0);
+    REQUIRE(xchg_journal_return(&reader, &received));
+    REQUIRE_FALSE(xchg_journal_return(&reader, &received));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "message is invalid");
+
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_journal_record(&reader, &received, &record));
+    REQUIRE(record.sequence == 1);
+    REQUIRE(record.type == 8);
+    REQUIRE(record.length == 0);
+    REQUIRE(xchg_journal_return(&reader, &received));
+
+    // a message that was not prepared by the journal is rejected
+
+    char data[16] = {};
+    REQUIRE(xchg_message_init(&message, data, sizeof(data)));
+    REQUIRE_FALSE(xchg_journal_send(&writer, &message, 0));
+    REQUIRE(std::string(xchg_journal_strerror(&writer)) == "message is invalid");
+
+    // the two records so far take 40 and 24 bytes, and the next one needs 24 bytes of its own before its payload
+
+    REQUIRE(xchg_journal_prepare(&writer, &message));
+    REQUIRE(message.length == sizeof(first) - XCHG_RECORDING_HEADER_SIZE - 40 - 24 - sizeof(struct xchg_record));
+    REQUIRE(xchg_message_write_uint64(&message, 43));
+    REQUIRE(xchg_journal_send(&writer, &message, 0));
+
+    // fill the rest of the segment, which leaves no room for another record
+
+    REQUIRE(xchg_journal_prepare(&writer, &message));
+    while(xchg_message_write_uint8(&message, 0xff))
+    {
+    }
+    REQUIRE(xchg_journal_send(&writer, &message, 0));
+    REQUIRE_FALSE(xchg_journal_prepare(&writer, &message));
+    REQUIRE(std::string(xchg_journal_strerror(&writer)) == "journal segment is full");
+
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_journal_return(&reader, &received));
+
+    // a reader cannot roll over until the writer has sealed the segment and every message was received
+
+    REQUIRE_FALSE(xchg_journal_roll(&reader, second, sizeof(second)));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal segment is not finished");
+
+    REQUIRE(xchg_journal_roll(&writer, second, sizeof(second)));
+    REQUIRE(xchg_journal_prepare(&writer, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 44));
+    REQUIRE(xchg_journal_send(&writer, &message, 0));
+
+    REQUIRE_FALSE(xchg_journal_roll(&reader, second, sizeof(second)));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal segment is not finished");
+
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_journal_return(&reader, &received));
+    REQUIRE_FALSE(xchg_journal_receive(&reader, &received));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal segment is sealed");
+
+    REQUIRE_FALSE(xchg_journal_roll(&reader, first, sizeof(first)));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal segment is out of order");
+    REQUIRE(xchg_journal_roll(&reader, second, sizeof(second)));
+
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_journal_record(&reader, &received, &record));
+    REQUIRE(record.sequence == 4);
+    REQUIRE(xchg_message_read_uint64(&received, &value));
+    REQUIRE(value == 44);
+    REQUIRE(xchg_journal_return(&reader, &received));
+
+    uint64_t index = 0;
+    REQUIRE(xchg_journal_tell(&reader, &index, nullptr, nullptr));
+    REQUIRE(index == 1);
+
+    // a sealed segment is itself a complete recording
+
+    struct xchg_replayer replayer = {};
+    const char *payload = nullptr;
+    size_t nr_records = 0;
+    REQUIRE(xchg_replayer_init(&replayer, first, sizeof(first)));
+    while(xchg_replayer_read(&replayer, &record, &payload))
+    {
+        REQUIRE(record.sequence == nr_records);
+        nr_records += 1;
+    }
+    REQUIRE(nr_records == 4);
+}
+
+TEST_CASE("journal restart and seek", "[journal]")
+{
+    alignas(8) char first[512] = {};
+    alignas(8) char second[512] = {};
+
+    struct xchg_journal writer = {};
+    REQUIRE(xchg_journal_init(&writer, first, sizeof(first)));
+
+    struct xchg_message message = {};
+    size_t offsets[4] = {};
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_journal_tell(&writer, nullptr, &offsets[i], nullptr));
+        REQUIRE(xchg_journal_prepare(&writer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_journal_send(&writer, &message, 0));
+    }
+
+    // a segment which does not validate is reported rather than started afresh
+
+    struct xchg_journal restarted = {};
+    REQUIRE_FALSE(xchg_journal_init(&restarted, first, XCHG_RECORDING_HEADER_SIZE + 8));
+    REQUIRE(std::string(xchg_journal_strerror(&restarted)) == "recording size does not match recording header");
+
+    // a restarted writer continues the sequence after the last complete message
+
+    uint64_t sequence = 0;
+    REQUIRE(xchg_journal_init(&restarted, first, sizeof(first)));
+    REQUIRE(xchg_journal_tell(&restarted, nullptr, nullptr, &sequence));
+    REQUIRE(sequence == 4);
+
+    // but once the segment was rolled over, the writer must resume in the newest one
+
+    REQUIRE(xchg_journal_roll(&restarted, second, sizeof(second)));
+    REQUIRE(xchg_journal_init(&writer, first, sizeof(first)));
+    REQUIRE_FALSE(xchg_journal_prepare(&writer, &message));
+    REQUIRE(std::string(xchg_journal_strerror(&writer)) == "journal segment is sealed");
+    REQUIRE(xchg_journal_init(&writer, second, sizeof(second)));
+    REQUIRE(xchg_journal_tell(&writer, nullptr, nullptr, &sequence));
+    REQUIRE(sequence == 4);
+
+    struct xchg_journal reader = {};
+    struct xchg_message received = {};
+    struct xchg_record record = {};
+    uint64_t value = 0;
+
+    REQUIRE(xchg_journal_open(&reader, first, sizeof(first)));
+
+    REQUIRE(xchg_journal_seek(&reader, offsets[2], 2));
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_message_read_uint64(&received, &value));
+    REQUIRE(value == 2);
+    REQUIRE(xchg_journal_return(&reader, &received));
+
+    size_t offset = 0;
+    REQUIRE(xchg_journal_tell(&reader, nullptr, &offset, &sequence));
+    REQUIRE(offset == offsets[3]);
+    REQUIRE(sequence == 3);
+
+    REQUIRE(xchg_journal_seek(&reader, offsets[0], 0));
+    REQUIRE(xchg_journal_receive(&reader, &received));
+    REQUIRE(xchg_journal_record(&reader, &received, &record));
+    REQUIRE(record.sequence == 0);
+
+    // offsets which are not message boundaries, or whose sequence does not match, are rejected
+
+    REQUIRE_FALSE(xchg_journal_seek(&reader, offsets[1] + 8, 1));
+    REQUIRE(std::string(xchg_journal_strerror(&reader)) == "journal offset is invalid");
+    REQUIRE_FALSE(xchg_journal_seek(&reader, offsets[1], 2));
+    REQUIRE_FALSE(xchg_journal_seek(&reader, offsets[1] + 1, 1));
+    REQUIRE_FALSE(xchg_journal_seek(&reader, 0, 0));
+    REQUIRE_FALSE(xchg_journal_seek(&reader, sizeof(first), 0));
+
+    REQUIRE(xchg_journal_tell(&reader, nullptr, &offset, &sequence));
+    REQUIRE(offset == offsets[0]);
+    REQUIRE(sequence == 0);
+}
+
+TEST_CASE("journal restart across roll", "[journal]")
+{
+    alignas(8) char first[256] = {};
+    alignas(8) char second[256] = {};
+
+    struct xchg_journal writer = {};
+    REQUIRE(xchg_journal_init(&writer, first, sizeof(first)));
+
+    struct xchg_message message = {};
+    for(uint64_t i = 0; i < 3; i++)
+    {
+        REQUIRE(xchg_journal_prepare(&writer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_journal_send(&writer, &message, 0));
+    }
+
+    // the writer crashes after sealing the first segment but before the header of the second one exists
+
+    REQUIRE(xchg_journal_roll(&writer, second, sizeof(second)));
+    std::memset(second, 0, sizeof(second));
+
+    // restarted over the sealed segment, it can only roll over, which starts the second segment again
+
+    struct xchg_journal restarted = {};
+    REQUIRE(xchg_journal_init(&restarted, first, sizeof(first)));
+    REQUIRE_FALSE(xchg_journal_prepare(&restarted, &message));
+    REQUIRE(std::string(xchg_journal_strerror(&restarted)) == "journal segment is sealed");
+    REQUIRE(xchg_journal_roll(&restarted, second, sizeof(second)));
+
+    uint64_t index = 0;
+    uint64_t sequence = 0;
+    REQUIRE(xchg_journal_tell(&restarted, &index, nullptr, &sequence));
+    REQUIRE(index == 1);
+    REQUIRE(sequence == 3);
+
+    REQUIRE(xchg_journal_prepare(&restarted, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 3));
+    REQUIRE(xchg_journal_send(&restarted, &message, 0));
+
+    // a reader continues from the first segment into the second as if the writer had never stopped
+
+    struct xchg_journal reader = {};
+    REQUIRE(xchg_journal_open(&reader, first, sizeof(first)));
+
+    struct xchg_message received = {};
+    struct xchg_record record = {};
+    uint64_t value = 0;
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        if(i == 3)
+        {
+            REQUIRE_FALSE(xchg_journal_receive(&reader, &received));
+            REQUIRE(xchg_journal_roll(&reader, second, sizeof(second)));
+        }
+        REQUIRE(xchg_journal_receive(&reader, &received));
+        REQUIRE(xchg_journal_record(&reader, &received, &record));
+        REQUIRE(record.sequence == i);
+        REQUIRE(xchg_message_read_uint64(&received, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_journal_return(&reader, &received));
+    }
+}
+
+TEST_CASE("journal concurrent tail", "[journal]")
+{
+    constexpr size_t nr_segments = 8;
+    constexpr size_t sz_segment = 4096;
+    constexpr uint64_t nr_messages = 2000;
+
+    std::vector<uint64_t> storage(nr_segments * sz_segment / sizeof(uint64_t));
+    char *segments = reinterpret_cast<char *>(storage.data());
+
+    // segments are reused round-robin, so the writer waits for the reader to leave a segment before reusing it
+
+    std::atomic<size_t> reader_index(0);
+
+    struct xchg_journal writer = {};
+    REQUIRE(xchg_journal_init(&writer, segments, sz_segment));
+
+    struct xchg_journal reader = {};
+    REQUIRE(xchg_journal_open(&reader, segments, sz_segment));
+
+    std::thread producer([&]() {
+        uint64_t index = 0;
+        struct xchg_message message = {};
+
+        for(uint64_t i = 0; i < nr_messages; i++)
+        {
+            // a message which does not fit into the rest of the segment is abandoned and rebuilt in the next one
+
+            for(;;)
+            {
+                bool written = xchg_journal_prepare(&writer, &message) && xchg_message_write_uint64(&message, i);
+                for(uint64_t j = 0; written && j < i % 16; j++)
+                {
+                    written = xchg_message_write_uint8(&message, (uint8_t)j);
+                }
+
+                if(written)
+                {
+                    break;
+                }
+
+                while(index + 1 >= reader_index.load() + nr_segments)
+                {
+                    std::this_thread::yield();
+                }
+
+                index += 1;
+                xchg_journal_roll(&writer, segments + (index % nr_segments) * sz_segment, sz_segment);
+            }
+
+            xchg_journal_send(&writer, &message, (uint32_t)(i % 16));
+        }
+    });
+
+    bool ok = true;
+    uint64_t index = 0;
+    struct xchg_message message = {};
+    struct xchg_record record = {};
+
+    for(uint64_t i = 0; i < nr_messages;)
+    {
+        if(!xchg_journal_receive(&reader, &message))
+        {
+            // the writer seals a segment before it starts the next one, so rolling over is retried until then
+
+            if(std::string(xchg_journal_strerror(&reader)) == "journal segment is sealed" &&
+               xchg_journal_roll(&reader, segments + ((index + 1) % nr_segments) * sz_segment, sz_segment))
+            {
+                index += 1;
+                reader_index.store(index);
+            }
+            continue;
+        }
+
+        uint64_t value = 0;
+        bool valid = xchg_journal_record(&reader, &message, &record) && xchg_message_read_uint64(&message, &value);
+        valid = valid && record.sequence == i && record.type == i % 16 && record.length == 9 + 2 * (i % 16);
+        ok = xchg_journal_return(&reader, &message) && ok && valid && value == i;
+        i += 1;
+    }
+
+    producer.join();
+
+    REQUIRE(ok);
+    REQUIRE(index > 0);
+}
@@ -0,0 +1,102 @@
+#include <cstring>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("lanes create", "[lanes]")
+{
+    char control[272] = {};
+    char bulk[4112] = {};
+    char *buffers[] = { control, bulk };
+    size_t sizes[] = { sizeof(control), sizeof(bulk) };
+    size_t bad_sizes[] = { sizeof(control), sizeof(bulk) - 1 };
+
+    struct xchg_lanes lanes = {};
+    REQUIRE_FALSE(xchg_lanes_init(&lanes, 0, 0, 64, nullptr, nullptr, buffers, sizes));
+    REQUIRE(xchg_lanes_strerror(&lanes));
+    REQUIRE_FALSE(xchg_lanes_init(&lanes, 0, XCHG_LANES_MAX + 1, 64, nullptr, nullptr, buffers, sizes));
+    REQUIRE(xchg_lanes_strerror(&lanes));
+    REQUIRE_FALSE(xchg_lanes_init(&lanes, 0, 2, 64, nullptr, nullptr, buffers, bad_sizes));
+    REQUIRE(xchg_lanes_strerror(&lanes));
+    REQUIRE_FALSE(xchg_lanes_init(&lanes, 0, 2, 64, nullptr, nullptr, nullptr, nullptr));
+
+    REQUIRE(xchg_lanes_init(&lanes, 0, 2, 64, nullptr, nullptr, buffers, sizes));
+    REQUIRE_FALSE(xchg_lanes_strerror(&lanes));
+    REQUIRE(((uintptr_t)&lanes.lanes[1] - (uintptr_t)&lanes.lanes[0]) % 64 == 0);
+    REQUIRE(lanes.lanes[0].channel.egress.sz_data == 256);
+    REQUIRE(lanes.lanes[1].channel.egress.sz_data == 4096);
+
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_lanes_prepare(&lanes, &message, 2));
+    REQUIRE(xchg_lanes_strerror(&lanes));
+    REQUIRE_FALSE(xchg_lanes_receive(&lanes, &message, nullptr));
+    REQUIRE(xchg_lanes_strerror(&lanes));
+}
+
+TEST_CASE("lanes priority", "[lanes]")
+{
+    char control[272] = {};
+    char bulk[4112] = {};
+    char *buffers[] = { control, bulk };
+    size_t sizes[] = { sizeof(control), sizeof(bulk) };
+
+    struct xchg_lanes producer = {};
+    REQUIRE(xchg_lanes_init(&producer, xchg_channel_flag_length, 2, 64, nullptr, nullptr, buffers, sizes));
+    struct xchg_lanes consumer = {};
+    REQUIRE(xchg_lanes_init(&consumer, xchg_channel_flag_length, 2, 64, buffers, sizes, nullptr, nullptr));
+
+    struct xchg_message message = {};
+    for(uint64_t i = 0; i < 10; i++)
+    {
+        REQUIRE(xchg_lanes_prepare(&producer, &message, 1));
+        REQUIRE(xchg_message_write_uint64(&message, 100 + i));
+        REQUIRE(xchg_lanes_send(&producer, &message));
+    }
+
+    size_t priority = 0;
+    uint64_t value = 0;
+
+    REQUIRE(xchg_lanes_receive(&consumer, &message, &priority));
+    REQUIRE(priority == 1);
+    REQUIRE(xchg_message_read_uint64(&message, &value));
+    REQUIRE(value == 100);
+    REQUIRE(xchg_lanes_return(&consumer, &message));
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_lanes_prepare(&producer, &message, 0));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_lanes_send(&producer, &message));
+    }
+    REQUIRE_FALSE(xchg_lanes_prepare(&producer, &message, 0));
+    REQUIRE(xchg_lanes_strerror(&producer));
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_lanes_receive(&consumer, &message, &priority));
+        REQUIRE(priority == 0);
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_lanes_return(&consumer, &message));
+    }
+
+    for(uint64_t i = 1; i < 10; i++)
+    {
+        REQUIRE(xchg_lanes_receive(&consumer, &message, &priority));
+        REQUIRE(priority == 1);
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == 100 + i);
+        REQUIRE(xchg_lanes_return(&consumer, &message));
+    }
+
+    REQUIRE_FALSE(xchg_lanes_receive(&consumer, &message, &priority));
+    REQUIRE(xchg_lanes_strerror(&consumer));
+
+    char other[64] = {};
+    struct xchg_message stray = {};
+    REQUIRE(xchg_message_init(&stray, other, sizeof(other)));
+    REQUIRE_FALSE(xchg_lanes_send(&producer, &stray));
+    REQUIRE(xchg_lanes_strerror(&producer));
+    REQUIRE_FALSE(xchg_lanes_return(&consumer, &stray));
+    REQUIRE(xchg_lanes_strerror(&consumer));
+}
@@ -29,6 +29,9 @@ TEST_CASE("message navigation", "[message]")
     struct xchg_message message = {
         .data = (char *)"alex forster",
         .length = 12,
+        .position = 0,
+        .streaming = 0,
+        .error = nullptr,
     };
 
     REQUIRE_FALSE(xchg_message_seek(&message, 12));
@@ -39,7 +42,7 @@ TEST_CASE("message navigation", "[message]")
     REQUIRE(position == 5);
     REQUIRE(memcmp((char *)message.data + message.position, "forster", 7) == 0);
 
-    REQUIRE_FALSE(xchg_message_seek(&message, SIZE_T_MAX));
+    REQUIRE_FALSE(xchg_message_seek(&message, SIZE_MAX));
 }
 
 TEST_CASE("message peek", "[message]")
@@ -53,6 +56,7 @@ TEST_CASE("message peek", "[message]")
         .data = (char *)"\x54\x03\x00\x00\x00\x00\x00\x00\x44\x54\x01\x00\x00",
         .length = 13,
         .position = 0,
+        .streaming = 0,
         .error = nullptr,
     };
 
@@ -68,6 +72,7 @@ TEST_CASE("message peek", "[message]")
         .data = (char *)malloc(message2_size),
         .length = message2_size,
         .position = 0,
+        .streaming = 0,
         .error = nullptr,
     };
     bzero(message2.data, message2_size);
@@ -607,3 +612,118 @@ TEST_CASE("message read", "[message]")
         xchg_message_read_t_list<xchg_message_read_float64_list, double_t>(&message);
     }
 }
+
+TEST_CASE("message byte order", "[message]")
+{
+    char slab[512] = {};
+
+    struct xchg_message message = {};
+
+    SECTION("native")
+    {
+        REQUIRE(xchg_message_init(&message, slab, sizeof(slab)));
+        REQUIRE(xchg_message_write_byte_order(&message));
+        REQUIRE(message.position == 2);
+        REQUIRE(xchg_message_write_uint32(&message, 0x01020304));
+
+        REQUIRE(xchg_message_reset(&message));
+        REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+        REQUIRE(xchg_message_read_byte_order(&message));
+        REQUIRE(message.position == 2);
+        uint32_t value = 0;
+        REQUIRE(xchg_message_read_uint32(&message, &value));
+        REQUIRE(value == 0x01020304);
+
+        REQUIRE(xchg_message_reset(&message));
+        REQUIRE(xchg_message_read_uint32(&message, &value) == false);
+    }
+
+    SECTION("missing")
+    {
+        REQUIRE(xchg_message_init(&message, slab, sizeof(slab)));
+        REQUIRE(xchg_message_write_uint32(&message, 0x01020304));
+        REQUIRE(xchg_message_reset(&message));
+        REQUIRE_FALSE(xchg_message_read_byte_order(&message));
+        REQUIRE(xchg_message_strerror(&message));
+        REQUIRE(message.position == 0);
+
+        REQUIRE(xchg_message_init(&message, slab, 1));
+        REQUIRE_FALSE(xchg_message_write_byte_order(&message));
+        REQUIRE_FALSE(xchg_message_read_byte_order(&message));
+    }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    SECTION("foreign")
+    {
+        size_t n = 0;
+        auto put = [&](std::initializer_list<uint8_t> bytes) {
+            for(auto b : bytes)
+            {
+                slab[n++] = (char)b;
+            }
+        };
+
+        put({ 0xFE, 0xFF });
+        put({ 0x70, 0x01, 0x02, 0x03, 0x04 });
+        put({ 0x56, 0x03, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03 });
+        put({ 0x9A, 0x00, 0x28 });
+        for(uint8_t i = 0; i < 40; i++)
+        {
+            put({ 0, 0, 0, 0, 0, 0, 0, i });
+        }
+        put({ 0x21 });
+
+        REQUIRE(xchg_message_init(&message, slab, sizeof(slab)));
+        REQUIRE(xchg_message_read_byte_order(&message));
+        REQUIRE(message.position == 2);
+
+        uint32_t value = 0;
+        REQUIRE(xchg_message_read_uint32(&message, &value));
+        REQUIRE(value == 0x01020304);
+
+        const uint16_t *list16 = nullptr;
+        uint64_t sz_list16 = 0;
+        REQUIRE(xchg_message_read_uint16_list(&message, &list16, &sz_list16));
+        REQUIRE(sz_list16 == 3);
+        REQUIRE(list16[0] == 1);
+        REQUIRE(list16[1] == 2);
+        REQUIRE(list16[2] == 3);
+
+        const uint64_t *list64 = nullptr;
+        uint64_t sz_list64 = 0;
+        REQUIRE(xchg_message_read_uint64_list(&message, &list64, &sz_list64));
+        REQUIRE(sz_list64 == 40);
+        for(uint64_t i = 0; i < 40; i++)
+        {
+            uint64_t entry = 0;
+            memcpy(&entry, &list64[i], sizeof(entry));
+            REQUIRE(entry == i);
+        }
+
+        enum xchg_type type = xchg_type_invalid;
+        REQUIRE(xchg_message_read_null(&message, &type));
+        REQUIRE(type == xchg_type_int8);
+        REQUIRE(message.position == n);
+        REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+
+        REQUIRE(xchg_message_reset(&message));
+        REQUIRE(xchg_message_read_byte_order(&message));
+        REQUIRE(xchg_message_read_uint32(&message, &value));
+        REQUIRE(value == 0x01020304);
+    }
+
+    SECTION("foreign list length overflow")
+    {
+        // a uint64 list claiming 0x2000000000000000 entries, whose size in bytes wraps to zero
+
+        const uint8_t input[] = { 0xFE, 0xFF, 0x9E, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+        memcpy(slab, input, sizeof(input));
+
+        REQUIRE(xchg_message_init(&message, slab, sizeof(input)));
+        REQUIRE(xchg_message_read_byte_order(&message));
+        REQUIRE(message.position == 2);
+        REQUIRE(memcmp(slab + 2, input + 2, sizeof(input) - 2) == 0);
+        REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+    }
+#endif
+}
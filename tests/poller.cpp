@@ -0,0 +1,209 @@
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("poller create", "[poller]")
+{
+    alignas(64) char bitmap[XCHG_POLLER_SIZE + 1] = {};
+    char slab[4112] = {};
+
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, slab, sizeof(slab), nullptr, 0));
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel *channels[] = { &consumer };
+    struct xchg_channel *no_ingress[] = { &producer };
+
+    struct xchg_poller poller = {};
+    REQUIRE_FALSE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, XCHG_POLLER_SIZE - 1, channels, 1));
+    REQUIRE(xchg_poller_strerror(&poller));
+    REQUIRE_FALSE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap + 1, XCHG_POLLER_SIZE, channels, 1));
+    REQUIRE(xchg_poller_strerror(&poller));
+    REQUIRE_FALSE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, XCHG_POLLER_SIZE, channels, 0));
+    REQUIRE(xchg_poller_strerror(&poller));
+    REQUIRE_FALSE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, XCHG_POLLER_SIZE, no_ingress, 1));
+    REQUIRE(xchg_poller_strerror(&poller));
+    REQUIRE_FALSE(xchg_poller_init(&poller, (enum xchg_poller_policy)7, bitmap, XCHG_POLLER_SIZE, channels, 1));
+    REQUIRE(xchg_poller_strerror(&poller));
+    REQUIRE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, XCHG_POLLER_SIZE, channels, 1));
+    REQUIRE_FALSE(xchg_poller_strerror(&poller));
+
+    REQUIRE_FALSE(xchg_channel_set_notify(&producer, bitmap, XCHG_POLLER_SIZE, XCHG_POLLER_MAX));
+    REQUIRE(xchg_channel_strerror(&producer));
+    REQUIRE_FALSE(xchg_channel_set_notify(&producer, bitmap + 1, XCHG_POLLER_SIZE, 0));
+    REQUIRE(xchg_channel_strerror(&producer));
+    REQUIRE(xchg_channel_set_notify(&producer, bitmap, XCHG_POLLER_SIZE, 0));
+    REQUIRE(xchg_channel_set_notify(&producer, nullptr, 0, 0));
+    REQUIRE(producer.notify == nullptr);
+}
+
+TEST_CASE("poller receive", "[poller]")
+{
+    alignas(64) char bitmap[XCHG_POLLER_SIZE] = {};
+    char slabs[3][4112] = {};
+    struct xchg_channel producers[3] = {};
+    struct xchg_channel consumers[3] = {};
+    struct xchg_channel *channels[3] = {};
+
+    for(size_t i = 0; i < 3; i++)
+    {
+        REQUIRE(xchg_channel_init(&producers[i], 64, nullptr, 0, slabs[i], sizeof(slabs[i])));
+        REQUIRE(xchg_channel_init(&consumers[i], 64, slabs[i], sizeof(slabs[i]), nullptr, 0));
+        REQUIRE(xchg_channel_set_notify(&producers[i], bitmap, sizeof(bitmap), i));
+        channels[i] = &consumers[i];
+    }
+
+    struct xchg_poller poller = {};
+
+    SECTION("empty")
+    {
+        REQUIRE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, sizeof(bitmap), channels, 3));
+
+        struct xchg_channel *channel = nullptr;
+        struct xchg_message message = {};
+        REQUIRE_FALSE(xchg_poller_receive(&poller, &channel, &message));
+        REQUIRE(xchg_poller_strerror(&poller));
+
+        uint64_t bits = 0;
+        memcpy(&bits, bitmap, sizeof(bits));
+        REQUIRE(bits == 0);
+
+        REQUIRE(xchg_channel_prepare(&producers[1], &message));
+        REQUIRE(xchg_message_write_uint64(&message, 11));
+        REQUIRE(xchg_channel_send(&producers[1], &message));
+        memcpy(&bits, bitmap, sizeof(bits));
+        REQUIRE(bits == 2);
+
+        uint64_t value = 0;
+        REQUIRE(xchg_poller_receive(&poller, &channel, &message));
+        REQUIRE(channel == &consumers[1]);
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == 11);
+        REQUIRE(xchg_channel_return(channel, &message));
+
+        REQUIRE_FALSE(xchg_poller_receive(&poller, &channel, &message));
+        memcpy(&bits, bitmap, sizeof(bits));
+        REQUIRE(bits == 0);
+    }
+
+    SECTION("fair")
+    {
+        REQUIRE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, sizeof(bitmap), channels, 3));
+
+        struct xchg_channel *channel = nullptr;
+        struct xchg_message message = {};
+
+        const uint64_t sends[][2] = { { 0, 0 }, { 2, 20 }, { 0, 1 }, { 2, 21 }, { 0, 2 }, { 2, 22 }, { 1, 10 } };
+        for(const auto &send : sends)
+        {
+            REQUIRE(xchg_channel_prepare(&producers[send[0]], &message));
+            REQUIRE(xchg_message_write_uint64(&message, send[1]));
+            REQUIRE(xchg_channel_send(&producers[send[0]], &message));
+        }
+
+        // channels take turns, so the single message on channel 1 is not starved by the others
+
+        const uint64_t receives[][2] = { { 0, 0 }, { 1, 10 }, { 2, 20 }, { 0, 1 }, { 2, 21 }, { 0, 2 }, { 2, 22 } };
+        for(const auto &receive : receives)
+        {
+            uint64_t value = 0;
+            REQUIRE(xchg_poller_receive(&poller, &channel, &message));
+            REQUIRE(channel == &consumers[receive[0]]);
+            REQUIRE(xchg_message_read_uint64(&message, &value));
+            REQUIRE(value == receive[1]);
+            REQUIRE(xchg_channel_return(channel, &message));
+        }
+
+        REQUIRE_FALSE(xchg_poller_receive(&poller, &channel, &message));
+    }
+
+    SECTION("priority")
+    {
+        REQUIRE(xchg_poller_init(&poller, xchg_poller_policy_priority, bitmap, sizeof(bitmap), channels, 3));
+
+        struct xchg_channel *channel = nullptr;
+        struct xchg_message message = {};
+
+        const uint64_t sends[][2] = { { 2, 20 }, { 1, 10 }, { 2, 21 }, { 1, 11 } };
+        for(const auto &send : sends)
+        {
+            REQUIRE(xchg_channel_prepare(&producers[send[0]], &message));
+            REQUIRE(xchg_message_write_uint64(&message, send[1]));
+            REQUIRE(xchg_channel_send(&producers[send[0]], &message));
+        }
+
+        uint64_t value = 0;
+        REQUIRE(xchg_poller_receive(&poller, &channel, &message));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == 10);
+        REQUIRE(xchg_channel_return(channel, &message));
+
+        // a message on a higher priority channel overtakes everything already pending
+
+        REQUIRE(xchg_channel_prepare(&producers[0], &message));
+        REQUIRE(xchg_message_write_uint64(&message, 0));
+        REQUIRE(xchg_channel_send(&producers[0], &message));
+
+        for(uint64_t expected : { 0, 11, 20, 21 })
+        {
+            REQUIRE(xchg_poller_receive(&poller, &channel, &message));
+            REQUIRE(xchg_message_read_uint64(&message, &value));
+            REQUIRE(value == expected);
+            REQUIRE(xchg_channel_return(channel, &message));
+        }
+    }
+
+    SECTION("threads")
+    {
+        REQUIRE(xchg_poller_init(&poller, xchg_poller_policy_fair, bitmap, sizeof(bitmap), channels, 3));
+
+        const uint64_t nr_messages = 100000;
+
+        std::vector<std::thread> threads;
+        for(size_t i = 0; i < 3; i++)
+        {
+            threads.emplace_back([&producers, i, nr_messages]() {
+                for(uint64_t n = 0; n < nr_messages; n++)
+                {
+                    struct xchg_message message = {};
+                    while(!xchg_channel_prepare(&producers[i], &message))
+                    {
+                        std::this_thread::yield();
+                    }
+                    xchg_message_write_uint64(&message, n);
+                    xchg_channel_send(&producers[i], &message);
+                }
+            });
+        }
+
+        uint64_t expected[3] = {};
+        bool in_order = true;
+
+        for(uint64_t n = 0; n < nr_messages * 3;)
+        {
+            struct xchg_channel *channel = nullptr;
+            struct xchg_message message = {};
+            if(!xchg_poller_receive(&poller, &channel, &message))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            size_t index = (size_t)(channel - consumers);
+            uint64_t value = 0;
+            xchg_message_read_uint64(&message, &value);
+            in_order &= (value == expected[index]++);
+            xchg_channel_return(channel, &message);
+            n++;
+        }
+
+        for(auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(in_order);
+    }
+}
@@ -0,0 +1,225 @@
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("recorder create", "[recorder]")
+{
+    alignas(8) char buffer[256] = {};
+
+    struct xchg_replayer replayer = {};
+    REQUIRE_FALSE(xchg_replayer_init(&replayer, buffer, sizeof(buffer)));
+    REQUIRE(std::string(xchg_replayer_strerror(&replayer)) == "recording header is missing");
+
+    struct xchg_recorder recorder = {};
+    REQUIRE_FALSE(xchg_recorder_init(&recorder, buffer, XCHG_RECORDING_HEADER_SIZE));
+    REQUIRE(xchg_recorder_strerror(&recorder));
+    REQUIRE_FALSE(xchg_recorder_init(&recorder, buffer + 1, sizeof(buffer) - 1));
+    REQUIRE(xchg_recorder_strerror(&recorder));
+    REQUIRE(xchg_recorder_init(&recorder, buffer, sizeof(buffer)));
+    REQUIRE_FALSE(xchg_recorder_strerror(&recorder));
+
+    // an existing recording which fails validation is reported rather than started afresh
+
+    uint32_t version = 0;
+    std::memcpy(&version, buffer + 4, sizeof(version));
+    REQUIRE(version == XCHG_RECORDING_VERSION);
+    version += 1;
+    std::memcpy(buffer + 4, &version, sizeof(version));
+    REQUIRE_FALSE(xchg_recorder_init(&recorder, buffer, sizeof(buffer)));
+    REQUIRE(std::string(xchg_recorder_strerror(&recorder)) == "recording header version is unsupported");
+    version -= 1;
+    std::memcpy(buffer + 4, &version, sizeof(version));
+    REQUIRE(xchg_recorder_init(&recorder, buffer, sizeof(buffer)));
+
+    REQUIRE(xchg_replayer_init(&replayer, buffer, sizeof(buffer)));
+
+    struct xchg_record record = {};
+    const char *payload = nullptr;
+    REQUIRE_FALSE(xchg_replayer_read(&replayer, &record, &payload));
+    REQUIRE(std::string(xchg_replayer_strerror(&replayer)) == "recording has no more records");
+}
+
+TEST_CASE("recorder record and read", "[recorder]")
+{
+    alignas(8) char buffer[256] = {};
+    char data[64] = {};
+
+    struct xchg_recorder recorder = {};
+    REQUIRE(xchg_recorder_init(&recorder, buffer, sizeof(buffer)));
+
+    struct xchg_message message = {};
+    uint64_t value = 0;
+
+    for(uint64_t i = 0; i < 3; i++)
+    {
+        REQUIRE(xchg_message_init(&message, data, 9));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_recorder_record(&recorder, &message, (uint32_t)(10 + i)));
+    }
+
+    // each record takes 24 bytes of metadata plus 9 bytes of payload padded to 16, so a fourth does not fit
+
+    REQUIRE(xchg_message_init(&message, data, 64));
+    REQUIRE_FALSE(xchg_recorder_record(&recorder, &message, 0));
+    REQUIRE(std::string(xchg_recorder_strerror(&recorder)) == "recording is full");
+
+    // a restarted recorder appends after the existing records, even if it crashed after counting the last one but
+    // before publishing it
+
+    uint64_t nr_records = 0;
+    std::memcpy(&nr_records, buffer + 16, sizeof(nr_records));
+    REQUIRE(nr_records == 3);
+    nr_records += 1;
+    std::memcpy(buffer + 16, &nr_records, sizeof(nr_records));
+
+    struct xchg_recorder restarted = {};
+    REQUIRE(xchg_recorder_init(&restarted, buffer, sizeof(buffer)));
+    REQUIRE(xchg_message_init(&message, data, 9));
+    REQUIRE(xchg_message_write_uint64(&message, 3));
+    REQUIRE(xchg_recorder_record(&restarted, &message, 13));
+
+    struct xchg_replayer replayer = {};
+    REQUIRE(xchg_replayer_init(&replayer, buffer, sizeof(buffer)));
+
+    struct xchg_record record = {};
+    const char *payload = nullptr;
+    uint64_t timestamp = 0;
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_replayer_read(&replayer, &record, &payload));
+        REQUIRE(record.sequence == i);
+        REQUIRE(record.type == 10 + i);
+        REQUIRE(record.length == 9);
+        REQUIRE(record.timestamp >= timestamp);
+        timestamp = record.timestamp;
+
+        std::memcpy(data, payload, record.length);
+        REQUIRE(xchg_message_init(&message, data, record.length));
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+    }
+    REQUIRE_FALSE(xchg_replayer_read(&replayer, &record, &payload));
+
+    REQUIRE(xchg_replayer_rewind(&replayer));
+    REQUIRE(xchg_replayer_read(&replayer, &record, &payload));
+    REQUIRE(record.sequence == 0);
+}
+
+TEST_CASE("recorder drain and replay", "[recorder]")
+{
+    std::vector<char> buffer(4096);
+    char tap[16 + 256] = {};
+    char target[16 + 512] = {};
+
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init_ex(&producer, xchg_channel_flag_header, 64, nullptr, 0, tap, sizeof(tap)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init_ex(&consumer, xchg_channel_flag_header, 64, tap, sizeof(tap), nullptr, 0));
+
+    struct xchg_recorder recorder = {};
+    REQUIRE(xchg_recorder_init(&recorder, buffer.data(), buffer.size()));
+
+    struct xchg_message message = {};
+    size_t nr = 0;
+
+    for(uint64_t i = 0; i < 8; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send_typed(&producer, &message, (uint32_t)i));
+
+        if(i % 3 == 2)
+        {
+            REQUIRE(xchg_recorder_drain(&recorder, &consumer, &nr));
+            REQUIRE(nr == 3);
+        }
+    }
+    REQUIRE(xchg_recorder_drain(&recorder, &consumer, &nr));
+    REQUIRE(nr == 2);
+    REQUIRE_FALSE(xchg_channel_receive(&consumer, &message));
+
+    // the replay goes into a channel with a different layout, which only needs slots large enough for the payload
+
+    struct xchg_channel replay_producer = {};
+    REQUIRE(xchg_channel_init_ex(&replay_producer, xchg_channel_flag_header, 128, nullptr, 0, target, sizeof(target)));
+    struct xchg_channel replay_consumer = {};
+    REQUIRE(xchg_channel_init_ex(&replay_consumer, xchg_channel_flag_header, 128, target, sizeof(target), nullptr, 0));
+
+    struct xchg_replayer replayer = {};
+    REQUIRE(xchg_replayer_init(&replayer, buffer.data(), buffer.size()));
+
+    // the target ring only has room for four messages at a time
+
+    REQUIRE(xchg_replayer_send(&replayer, &replay_producer, 0, &nr));
+    REQUIRE(nr == 4);
+
+    uint64_t value = 0;
+    struct xchg_header header = {};
+
+    for(uint64_t i = 0; i < 8; i++)
+    {
+        if(i == 4)
+        {
+            REQUIRE_FALSE(xchg_replayer_send(&replayer, &replay_producer, 0, &nr));
+            REQUIRE(nr == 4);
+        }
+
+        REQUIRE(xchg_channel_receive(&replay_consumer, &message));
+        REQUIRE(xchg_channel_header(&replay_consumer, &message, &header));
+        REQUIRE(header.type == i);
+        REQUIRE(header.length == 9);
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i);
+        REQUIRE(xchg_channel_return(&replay_consumer, &message));
+    }
+
+    char small[16 + 256] = {};
+    struct xchg_channel too_small = {};
+    REQUIRE(xchg_channel_init(&too_small, 8, nullptr, 0, small, sizeof(small)));
+    REQUIRE(xchg_replayer_rewind(&replayer));
+    REQUIRE_FALSE(xchg_replayer_send(&replayer, &too_small, 0, &nr));
+    REQUIRE(std::string(xchg_replayer_strerror(&replayer)) == "recorded message is too large for channel");
+
+    REQUIRE(xchg_replayer_rewind(&replayer));
+    REQUIRE_FALSE(xchg_replayer_send(&replayer, &replay_producer, -1.0, &nr));
+    REQUIRE(std::string(xchg_replayer_strerror(&replayer)) == "replay speed is invalid");
+}
+
+TEST_CASE("recorder paced replay", "[recorder]")
+{
+    std::vector<char> buffer(1024);
+    char data[16] = {};
+    char target[16 + 512] = {};
+
+    struct xchg_recorder recorder = {};
+    REQUIRE(xchg_recorder_init(&recorder, buffer.data(), buffer.size()));
+
+    struct xchg_message message = {};
+    REQUIRE(xchg_message_init(&message, data, sizeof(data)));
+    REQUIRE(xchg_recorder_record(&recorder, &message, 0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    REQUIRE(xchg_recorder_record(&recorder, &message, 0));
+
+    struct xchg_channel channel = {};
+    REQUIRE(xchg_channel_init(&channel, 64, nullptr, 0, target, sizeof(target)));
+
+    struct xchg_replayer replayer = {};
+    REQUIRE(xchg_replayer_init(&replayer, buffer.data(), buffer.size()));
+
+    // at a thousandth of the original speed the second message is not due for two seconds, while at full speed the
+    // rest of the recording goes out at once
+
+    size_t nr = 0;
+    REQUIRE(xchg_replayer_send(&replayer, &channel, 0.001, &nr));
+    REQUIRE(nr == 1);
+    REQUIRE(xchg_replayer_send(&replayer, &channel, 0.001, &nr));
+    REQUIRE(nr == 0);
+    REQUIRE_FALSE(xchg_replayer_send(&replayer, &channel, 0, &nr));
+    REQUIRE(nr == 1);
+}
@@ -0,0 +1,263 @@
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+struct rpc_result
+{
+    size_t nr_calls;
+    uint64_t value;
+};
+
+static void rpc_complete(void *context, struct xchg_message *response)
+{
+    auto *result = (struct rpc_result *)context;
+    result->nr_calls += 1;
+    xchg_message_read_uint64(response, &result->value);
+}
+
+TEST_CASE("rpc create", "[rpc]")
+{
+    char requests[528] = {};
+    char responses[528] = {};
+
+    struct xchg_channel client_channel = {};
+    REQUIRE(xchg_channel_init(&client_channel, 64, responses, sizeof(responses), requests, sizeof(requests)));
+    struct xchg_channel egress_only = {};
+    REQUIRE(xchg_channel_init(&egress_only, 64, nullptr, 0, requests, sizeof(requests)));
+
+    struct xchg_rpc_call calls[4];
+
+    struct xchg_rpc rpc = {};
+    REQUIRE_FALSE(xchg_rpc_init(&rpc, &egress_only, calls, 4));
+    REQUIRE(xchg_rpc_strerror(&rpc));
+    REQUIRE_FALSE(xchg_rpc_init(&rpc, &client_channel, calls, 3));
+    REQUIRE(xchg_rpc_strerror(&rpc));
+    REQUIRE_FALSE(xchg_rpc_init(&rpc, &client_channel, nullptr, 4));
+    REQUIRE(xchg_rpc_strerror(&rpc));
+    REQUIRE_FALSE(xchg_rpc_init(&rpc, &client_channel, calls, 0));
+    REQUIRE(xchg_rpc_strerror(&rpc));
+
+    REQUIRE(xchg_rpc_init(&rpc, &client_channel, nullptr, 0));
+    REQUIRE_FALSE(xchg_rpc_strerror(&rpc));
+
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_rpc_prepare(&rpc, &message));
+    REQUIRE(xchg_rpc_strerror(&rpc));
+    REQUIRE_FALSE(xchg_rpc_dispatch(&rpc, nullptr));
+    REQUIRE(xchg_rpc_strerror(&rpc));
+
+    REQUIRE(xchg_rpc_init(&rpc, &client_channel, calls, 4));
+    REQUIRE_FALSE(xchg_rpc_strerror(&rpc));
+    REQUIRE(xchg_rpc_pending(&rpc) == 0);
+}
+
+TEST_CASE("rpc pipelined", "[rpc]")
+{
+    char requests[528] = {};
+    char responses[528] = {};
+
+    struct xchg_channel client_channel = {};
+    REQUIRE(xchg_channel_init(&client_channel, 64, responses, sizeof(responses), requests, sizeof(requests)));
+    struct xchg_channel server_channel = {};
+    REQUIRE(xchg_channel_init(&server_channel, 64, requests, sizeof(requests), responses, sizeof(responses)));
+
+    struct xchg_rpc_call calls[4];
+    struct xchg_rpc client = {};
+    REQUIRE(xchg_rpc_init(&client, &client_channel, calls, 4));
+    struct xchg_rpc server = {};
+    REQUIRE(xchg_rpc_init(&server, &server_channel, nullptr, 0));
+
+    struct rpc_result results[4] = {};
+    struct xchg_message message = {};
+    uint64_t id = 0;
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(xchg_rpc_prepare(&client, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_rpc_call(&client, &message, rpc_complete, &results[i], &id));
+        REQUIRE(id == i + 1);
+    }
+
+    REQUIRE(xchg_rpc_pending(&client) == 4);
+    REQUIRE_FALSE(xchg_rpc_prepare(&client, &message));
+    REQUIRE(xchg_rpc_strerror(&client));
+
+    size_t nr_completed = 1;
+    REQUIRE(xchg_rpc_dispatch(&client, &nr_completed));
+    REQUIRE(nr_completed == 0);
+
+    // answer out of order to show that responses are matched by id rather than position
+
+    std::vector<uint64_t> ids;
+    std::vector<uint64_t> arguments;
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        uint64_t argument = 0;
+        REQUIRE(xchg_rpc_receive(&server, &message, &id));
+        REQUIRE(xchg_message_read_uint64(&message, &argument));
+        REQUIRE(xchg_rpc_return(&server, &message));
+        ids.push_back(id);
+        arguments.push_back(argument);
+    }
+
+    for(size_t i = 4; i > 0; i--)
+    {
+        REQUIRE(xchg_rpc_reply_prepare(&server, &message, ids[i - 1]));
+        REQUIRE(xchg_message_write_uint64(&message, arguments[i - 1] * 100));
+        REQUIRE(xchg_rpc_reply(&server, &message));
+    }
+
+    REQUIRE(xchg_rpc_dispatch(&client, &nr_completed));
+    REQUIRE(nr_completed == 4);
+    REQUIRE(xchg_rpc_pending(&client) == 0);
+
+    for(uint64_t i = 0; i < 4; i++)
+    {
+        REQUIRE(results[i].nr_calls == 1);
+        REQUIRE(results[i].value == i * 100);
+    }
+
+    REQUIRE(xchg_rpc_prepare(&client, &message));
+    REQUIRE(xchg_rpc_call(&client, &message, rpc_complete, &results[0], &id));
+    REQUIRE(id == 5);
+
+    // a response to a call which is no longer in flight is discarded
+
+    REQUIRE(xchg_rpc_reply_prepare(&server, &message, 1));
+    REQUIRE(xchg_rpc_reply(&server, &message));
+    REQUIRE_FALSE(xchg_rpc_dispatch(&client, &nr_completed));
+    REQUIRE(xchg_rpc_strerror(&client));
+    REQUIRE(nr_completed == 0);
+    REQUIRE(xchg_rpc_pending(&client) == 1);
+}
+
+TEST_CASE("rpc corrupted response", "[rpc]")
+{
+    char requests[528] = {};
+    char responses[528] = {};
+
+    struct xchg_channel client_channel = {};
+    REQUIRE(xchg_channel_init_ex(&client_channel, xchg_channel_flag_checksum, 64,
+                                 responses, sizeof(responses), requests, sizeof(requests)));
+    struct xchg_channel server_channel = {};
+    REQUIRE(xchg_channel_init_ex(&server_channel, xchg_channel_flag_checksum, 64,
+                                 requests, sizeof(requests), responses, sizeof(responses)));
+
+    struct xchg_rpc_call calls[4];
+    struct xchg_rpc client = {};
+    REQUIRE(xchg_rpc_init(&client, &client_channel, calls, 4));
+    struct xchg_rpc server = {};
+    REQUIRE(xchg_rpc_init(&server, &server_channel, nullptr, 0));
+
+    struct rpc_result result = {};
+    struct xchg_message message = {};
+    uint64_t id = 0;
+
+    REQUIRE(xchg_rpc_prepare(&client, &message));
+    REQUIRE(xchg_message_write_uint64(&message, 1));
+    REQUIRE(xchg_rpc_call(&client, &message, rpc_complete, &result, &id));
+
+    REQUIRE(xchg_rpc_receive(&server, &message, &id));
+    REQUIRE(xchg_rpc_return(&server, &message));
+    REQUIRE(xchg_rpc_reply_prepare(&server, &message, id));
+    REQUIRE(xchg_message_write_uint64(&message, 100));
+    REQUIRE(xchg_rpc_reply(&server, &message));
+    responses[16 + 8] ^= 1;
+
+    // the corrupt response is consumed and its validation error reported, without completing the call
+
+    size_t nr_completed = 1;
+    REQUIRE_FALSE(xchg_rpc_dispatch(&client, &nr_completed));
+    REQUIRE(xchg_rpc_strerror(&client));
+    REQUIRE(std::string(xchg_rpc_strerror(&client)) == "message failed checksum verification");
+    REQUIRE(nr_completed == 0);
+    REQUIRE(result.nr_calls == 0);
+    REQUIRE(xchg_rpc_pending(&client) == 1);
+
+    REQUIRE(xchg_rpc_dispatch(&client, &nr_completed));
+    REQUIRE(nr_completed == 0);
+}
+
+TEST_CASE("rpc threads", "[rpc]")
+{
+    std::vector<char> requests(16 + 4096);
+    std::vector<char> responses(16 + 4096);
+
+    struct xchg_channel client_channel = {};
+    REQUIRE(xchg_channel_init(&client_channel, 64, responses.data(), responses.size(), requests.data(), requests.size()));
+    struct xchg_channel server_channel = {};
+    REQUIRE(xchg_channel_init(&server_channel, 64, requests.data(), requests.size(), responses.data(), responses.size()));
+
+    const uint64_t nr_calls = 100000;
+
+    std::thread thread([&server_channel, nr_calls]() {
+        struct xchg_rpc server = {};
+        xchg_rpc_init(&server, &server_channel, nullptr, 0);
+
+        for(uint64_t i = 0; i < nr_calls;)
+        {
+            struct xchg_message message = {};
+            uint64_t id = 0;
+            uint64_t argument = 0;
+            if(!xchg_rpc_receive(&server, &message, &id))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            xchg_message_read_uint64(&message, &argument);
+            xchg_rpc_return(&server, &message);
+
+            while(!xchg_rpc_reply_prepare(&server, &message, id))
+            {
+                std::this_thread::yield();
+            }
+            xchg_message_write_uint64(&message, argument + 1);
+            xchg_rpc_reply(&server, &message);
+            i++;
+        }
+    });
+
+    struct xchg_rpc_call calls[64];
+    struct xchg_rpc client = {};
+    REQUIRE(xchg_rpc_init(&client, &client_channel, calls, 64));
+
+    struct rpc_sum
+    {
+        size_t nr_calls;
+        uint64_t total;
+    } sum = {};
+
+    auto complete = [](void *context, struct xchg_message *response) {
+        auto *s = (struct rpc_sum *)context;
+        uint64_t value = 0;
+        xchg_message_read_uint64(response, &value);
+        s->nr_calls += 1;
+        s->total += value;
+    };
+
+    bool dispatched = true;
+    uint64_t sent = 0;
+    while(sum.nr_calls < nr_calls && dispatched)
+    {
+        struct xchg_message message = {};
+        while(sent < nr_calls && xchg_rpc_prepare(&client, &message))
+        {
+            xchg_message_write_uint64(&message, sent);
+            xchg_rpc_call(&client, &message, complete, &sum, nullptr);
+            sent++;
+        }
+        dispatched = xchg_rpc_dispatch(&client, nullptr);
+        std::this_thread::yield();
+    }
+
+    thread.join();
+
+    REQUIRE(dispatched);
+    REQUIRE(xchg_rpc_pending(&client) == 0);
+    REQUIRE(sum.total == (nr_calls * (nr_calls + 1)) / 2);
+}
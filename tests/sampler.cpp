@@ -0,0 +1,180 @@
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("sampler create", "[sampler]")
+{
+    struct xchg_sample samples[8] = {};
+
+    struct xchg_sampler sampler = {};
+    REQUIRE_FALSE(xchg_sampler_init(&sampler, samples, 0));
+    REQUIRE(xchg_sampler_strerror(&sampler));
+    REQUIRE_FALSE(xchg_sampler_init(&sampler, samples, 6));
+    REQUIRE(xchg_sampler_strerror(&sampler));
+    REQUIRE(xchg_sampler_init(&sampler, samples, 8));
+    REQUIRE_FALSE(xchg_sampler_strerror(&sampler));
+
+    char slab[16 + 256] = {};
+    struct xchg_channel channel = {};
+    REQUIRE(xchg_channel_init(&channel, 64, nullptr, 0, slab, sizeof(slab)));
+    REQUIRE_FALSE(xchg_channel_set_sampler(&channel, &sampler, 0));
+    REQUIRE(xchg_channel_strerror(&channel));
+    REQUIRE(xchg_channel_set_sampler(&channel, &sampler, 1));
+    REQUIRE(xchg_channel_set_sampler(&channel, nullptr, 0));
+
+    double ticks_per_ns = 0;
+    REQUIRE(xchg_sampler_calibrate(&ticks_per_ns));
+    REQUIRE(ticks_per_ns > 0);
+}
+
+TEST_CASE("sampler period", "[sampler]")
+{
+    struct xchg_sample samples[64] = {};
+    struct xchg_sampler sampler = {};
+    REQUIRE(xchg_sampler_init(&sampler, samples, 64));
+
+    char slab[16 + 256] = {};
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, slab, sizeof(slab)));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, slab, sizeof(slab), nullptr, 0));
+
+    // both ends of the channel are operated by this thread, so they may share one sampler
+
+    REQUIRE(xchg_channel_set_sampler(&producer, &sampler, 4));
+    REQUIRE(xchg_channel_set_sampler(&consumer, &sampler, 2));
+
+    struct xchg_message message = {};
+    for(uint64_t i = 0; i < 16; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i));
+        REQUIRE(xchg_channel_send(&producer, &message));
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+
+    auto prepare_send = std::make_unique<struct xchg_histogram>();
+    auto receive_return = std::make_unique<struct xchg_histogram>();
+    size_t nr_drained = 0;
+
+    REQUIRE(xchg_sampler_drain(&sampler, prepare_send.get(), receive_return.get(), &nr_drained));
+    REQUIRE(nr_drained == 4 + 8);
+    REQUIRE(prepare_send->count == 4);
+    REQUIRE(receive_return->count == 8);
+    REQUIRE(xchg_sampler_dropped(&sampler) == 0);
+
+    REQUIRE(xchg_sampler_drain(&sampler, prepare_send.get(), nullptr, &nr_drained));
+    REQUIRE(nr_drained == 0);
+
+    // samples beyond the capacity of the log are dropped rather than overwriting undrained ones
+
+    REQUIRE(xchg_channel_set_sampler(&producer, &sampler, 1));
+    REQUIRE(xchg_channel_set_sampler(&consumer, nullptr, 0));
+
+    for(uint64_t i = 0; i < 100; i++)
+    {
+        REQUIRE(xchg_channel_prepare(&producer, &message));
+        REQUIRE(xchg_channel_send(&producer, &message));
+        REQUIRE(xchg_channel_receive(&consumer, &message));
+        REQUIRE(xchg_channel_return(&consumer, &message));
+    }
+
+    REQUIRE(xchg_sampler_drain(&sampler, nullptr, nullptr, &nr_drained));
+    REQUIRE(nr_drained == 64);
+    REQUIRE(xchg_sampler_dropped(&sampler) == 36);
+}
+
+TEST_CASE("sampler concurrent drain", "[sampler]")
+{
+    std::vector<struct xchg_sample> samples(256);
+    struct xchg_sampler sampler = {};
+    REQUIRE(xchg_sampler_init(&sampler, samples.data(), samples.size()));
+
+    std::vector<char> slab(16 + (64 * 64));
+    struct xchg_channel producer = {};
+    REQUIRE(xchg_channel_init(&producer, 64, nullptr, 0, slab.data(), slab.size()));
+    struct xchg_channel consumer = {};
+    REQUIRE(xchg_channel_init(&consumer, 64, slab.data(), slab.size(), nullptr, 0));
+    REQUIRE(xchg_channel_set_sampler(&producer, &sampler, 8));
+    REQUIRE(xchg_channel_set_sampler(&consumer, &sampler, 8));
+
+    const uint64_t nr_messages = 100000;
+    auto histogram = std::make_unique<struct xchg_histogram>();
+
+    std::atomic<bool> done(false);
+
+    std::thread drainer([&]() {
+        while(!done.load())
+        {
+            xchg_sampler_drain(&sampler, histogram.get(), histogram.get(), nullptr);
+            std::this_thread::yield();
+        }
+        xchg_sampler_drain(&sampler, histogram.get(), histogram.get(), nullptr);
+    });
+
+    struct xchg_message message = {};
+    bool ok = true;
+    for(uint64_t i = 0; i < nr_messages && ok; i++)
+    {
+        ok = xchg_channel_prepare(&producer, &message) && xchg_message_write_uint64(&message, i) &&
+             xchg_channel_send(&producer, &message) && xchg_channel_receive(&consumer, &message) &&
+             xchg_channel_return(&consumer, &message);
+    }
+
+    done.store(true);
+    drainer.join();
+    REQUIRE(ok);
+    REQUIRE(histogram->count + xchg_sampler_dropped(&sampler) == (nr_messages / 8) * 2);
+}
+
+TEST_CASE("histogram percentile", "[sampler]")
+{
+    auto histogram = std::make_unique<struct xchg_histogram>();
+    uint64_t value = 0;
+
+    REQUIRE_FALSE(xchg_histogram_percentile(histogram.get(), 50.0, &value));
+
+    // the samples are fed in through a sampler, since recording is internal to the library
+
+    struct xchg_sample samples[1024] = {};
+    struct xchg_sampler sampler = {};
+    REQUIRE(xchg_sampler_init(&sampler, samples, 1024));
+
+    for(uint64_t i = 1; i <= 1000; i++)
+    {
+        samples[i - 1].ticks = i * 1000;
+        samples[i - 1].kind = xchg_sample_prepare_send;
+    }
+    sampler.w = 1000;
+
+    REQUIRE(xchg_sampler_drain(&sampler, histogram.get(), nullptr, nullptr));
+    REQUIRE(histogram->count == 1000);
+    REQUIRE(histogram->max == 1000000);
+
+    REQUIRE_FALSE(xchg_histogram_percentile(histogram.get(), 100.5, &value));
+    REQUIRE(xchg_histogram_percentile(histogram.get(), 50.0, &value));
+    REQUIRE(value >= 500000);
+    REQUIRE(value <= 500000 + (500000 / 32));
+    REQUIRE(xchg_histogram_percentile(histogram.get(), 99.0, &value));
+    REQUIRE(value >= 990000);
+    REQUIRE(value <= 990000 + (990000 / 32));
+    REQUIRE(xchg_histogram_percentile(histogram.get(), 100.0, &value));
+    REQUIRE(value == 1000000);
+    REQUIRE(xchg_histogram_percentile(histogram.get(), 0.0, &value));
+    REQUIRE(value >= 1000);
+    REQUIRE(value <= 1000 + (1000 / 32));
+
+    auto merged = std::make_unique<struct xchg_histogram>();
+    REQUIRE(xchg_histogram_merge(merged.get(), histogram.get()));
+    REQUIRE(xchg_histogram_merge(merged.get(), histogram.get()));
+    REQUIRE(merged->count == 2000);
+    REQUIRE(xchg_histogram_percentile(merged.get(), 50.0, &value));
+    REQUIRE(value >= 500000);
+    REQUIRE(value <= 500000 + (500000 / 32));
+}
@@ -0,0 +1,117 @@
+#include <cstring>
+#include <thread>
+
+#include "catch.hpp"
+#include "xchg.h"
+
+TEST_CASE("snapshot create", "[snapshot]")
+{
+    alignas(64) char buffer[128] = {};
+
+    struct xchg_snapshot snapshot = {};
+    REQUIRE_FALSE(xchg_snapshot_init(&snapshot, buffer, 64));
+    REQUIRE(xchg_snapshot_strerror(&snapshot));
+    REQUIRE_FALSE(xchg_snapshot_init(&snapshot, buffer + 1, 127));
+    REQUIRE(xchg_snapshot_strerror(&snapshot));
+    REQUIRE(xchg_snapshot_init(&snapshot, buffer, sizeof(buffer)));
+    REQUIRE_FALSE(xchg_snapshot_strerror(&snapshot));
+    REQUIRE(snapshot.sz_message == 64);
+
+    char copy[64];
+    struct xchg_message message = {};
+    REQUIRE_FALSE(xchg_snapshot_read(&snapshot, &message, copy, sizeof(copy), nullptr));
+    REQUIRE(xchg_snapshot_strerror(&snapshot));
+    REQUIRE_FALSE(xchg_snapshot_read(&snapshot, &message, copy, sizeof(copy) - 1, nullptr));
+    REQUIRE(xchg_snapshot_strerror(&snapshot));
+}
+
+TEST_CASE("snapshot publish", "[snapshot]")
+{
+    alignas(64) char buffer[128] = {};
+
+    struct xchg_snapshot writer = {};
+    REQUIRE(xchg_snapshot_init(&writer, buffer, sizeof(buffer)));
+    struct xchg_snapshot reader = {};
+    REQUIRE(xchg_snapshot_init(&reader, buffer, sizeof(buffer)));
+
+    char copy[64];
+    uint64_t version = 0;
+    uint64_t value = 0;
+    struct xchg_message message = {};
+
+    for(uint64_t i = 1; i <= 3; i++)
+    {
+        REQUIRE(xchg_snapshot_prepare(&writer, &message));
+        REQUIRE_FALSE(xchg_snapshot_prepare(&writer, &message));
+        REQUIRE(xchg_message_write_uint64(&message, i * 10));
+
+        struct xchg_message torn = {};
+        REQUIRE_FALSE(xchg_snapshot_read(&reader, &torn, copy, sizeof(copy), &version));
+        REQUIRE(xchg_snapshot_strerror(&reader));
+
+        REQUIRE(xchg_snapshot_publish(&writer, &message));
+        REQUIRE_FALSE(xchg_snapshot_publish(&writer, &message));
+
+        REQUIRE(xchg_snapshot_read(&reader, &message, copy, sizeof(copy), &version));
+        REQUIRE(version == i);
+        REQUIRE(message.data == copy);
+        REQUIRE(message.length == 9);
+        REQUIRE(xchg_message_read_uint64(&message, &value));
+        REQUIRE(value == i * 10);
+        REQUIRE_FALSE(xchg_message_peek(&message, nullptr, nullptr, nullptr, nullptr));
+    }
+}
+
+TEST_CASE("snapshot threads", "[snapshot]")
+{
+    alignas(64) char buffer[256] = {};
+
+    struct xchg_snapshot writer = {};
+    REQUIRE(xchg_snapshot_init(&writer, buffer, sizeof(buffer)));
+    struct xchg_snapshot reader = {};
+    REQUIRE(xchg_snapshot_init(&reader, buffer, sizeof(buffer)));
+
+    const uint64_t nr_updates = 200000;
+
+    std::thread thread([&writer, nr_updates]() {
+        for(uint64_t i = 1; i <= nr_updates; i++)
+        {
+            struct xchg_message message = {};
+            xchg_snapshot_prepare(&writer, &message);
+            for(uint64_t j = 0; j < 8; j++)
+            {
+                xchg_message_write_uint64(&message, i);
+            }
+            xchg_snapshot_publish(&writer, &message);
+        }
+    });
+
+    bool consistent = true;
+    uint64_t last = 0;
+
+    while(last < nr_updates)
+    {
+        char copy[192];
+        uint64_t version = 0;
+        struct xchg_message message = {};
+        if(!xchg_snapshot_read(&reader, &message, copy, sizeof(copy), &version))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t first = 0;
+        xchg_message_read_uint64(&message, &first);
+        for(uint64_t j = 1; j < 8; j++)
+        {
+            uint64_t value = 0;
+            xchg_message_read_uint64(&message, &value);
+            consistent &= (value == first);
+        }
+        consistent &= (first == version) && (first >= last);
+        last = first;
+    }
+
+    thread.join();
+
+    REQUIRE(consistent);
+}
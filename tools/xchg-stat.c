@@ -0,0 +1,432 @@
+/* xchg-stat.c
+ * Copyright (c) 2019 Alex Forster
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xchg.h"
+
+// attaches read-only to a ring set up by xchg_channel_create and reports its occupancy, rates and lag over time,
+// optionally decoding the messages which are still waiting for the consumer. Nothing is ever written to the ring,
+// so the producer and consumer are never disturbed
+
+static const char *usage =
+    "usage: xchg-stat [-i interval_ms] [-c count] [-n nr_messages] [-o offset] [-s size] ring\n"
+    "\n"
+    "  ring            path of a file or shm object holding the ring, e.g. /dev/shm/name or /name\n"
+    "  -i interval_ms  time between samples, default 1000\n"
+    "  -c count        number of samples to take, default 0 which samples until interrupted\n"
+    "  -n nr_messages  decode up to this many pending messages before sampling, default 0\n"
+    "  -o offset       offset, in bytes, of the ring within the file, default 0\n"
+    "  -s size         size, in bytes, of the ring, default the rest of the file\n";
+
+static const char *type_names[] = {
+    "invalid", "bool", "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "uint64", "float32", "float64",
+};
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+static const char *process_state(uint64_t pid)
+{
+    if(pid == 0)
+    {
+        return "detached";
+    }
+
+    return kill((pid_t)pid, 0) == 0 || errno == EPERM ? "alive" : "exited";
+}
+
+static int open_ring(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+
+    // a name with only a leading slash may also be a posix shm object on systems which do not expose /dev/shm
+
+    if(fd < 0 && path[0] == '/' && strchr(path + 1, '/') == NULL)
+    {
+        fd = shm_open(path, O_RDONLY, 0);
+    }
+
+    return fd;
+}
+
+static void print_value(struct xchg_message *message, enum xchg_type type)
+{
+    switch(type)
+    {
+    case xchg_type_bool:
+    {
+        bool value = false;
+        xchg_message_read_bool(message, &value);
+        printf("%s", value ? "true" : "false");
+        break;
+    }
+    case xchg_type_int8:
+    {
+        int8_t value = 0;
+        xchg_message_read_int8(message, &value);
+        printf("%" PRId8, value);
+        break;
+    }
+    case xchg_type_uint8:
+    {
+        uint8_t value = 0;
+        xchg_message_read_uint8(message, &value);
+        printf("%" PRIu8, value);
+        break;
+    }
+    case xchg_type_int16:
+    {
+        int16_t value = 0;
+        xchg_message_read_int16(message, &value);
+        printf("%" PRId16, value);
+        break;
+    }
+    case xchg_type_uint16:
+    {
+        uint16_t value = 0;
+        xchg_message_read_uint16(message, &value);
+        printf("%" PRIu16, value);
+        break;
+    }
+    case xchg_type_int32:
+    {
+        int32_t value = 0;
+        xchg_message_read_int32(message, &value);
+        printf("%" PRId32, value);
+        break;
+    }
+    case xchg_type_uint32:
+    {
+        uint32_t value = 0;
+        xchg_message_read_uint32(message, &value);
+        printf("%" PRIu32, value);
+        break;
+    }
+    case xchg_type_int64:
+    {
+        int64_t value = 0;
+        xchg_message_read_int64(message, &value);
+        printf("%" PRId64, value);
+        break;
+    }
+    case xchg_type_uint64:
+    {
+        uint64_t value = 0;
+        xchg_message_read_uint64(message, &value);
+        printf("%" PRIu64, value);
+        break;
+    }
+    case xchg_type_float32:
+    {
+        float_t value = 0;
+        xchg_message_read_float32(message, &value);
+        printf("%g", (double)value);
+        break;
+    }
+    case xchg_type_float64:
+    {
+        double_t value = 0;
+        xchg_message_read_float64(message, &value);
+        printf("%g", (double)value);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// lists are summarized by their type and length rather than printed, since they are usually opaque payloads
+
+static bool skip_list(struct xchg_message *message, enum xchg_type type, bool null)
+{
+    if(null)
+    {
+        return xchg_message_read_null_list(message, &type);
+    }
+
+    const void *list = NULL;
+    uint64_t sz_list = 0;
+
+    switch(type)
+    {
+    case xchg_type_bool:
+        return xchg_message_read_bool_list(message, (const bool **)&list, &sz_list);
+    case xchg_type_int8:
+        return xchg_message_read_int8_list(message, (const int8_t **)&list, &sz_list);
+    case xchg_type_uint8:
+        return xchg_message_read_uint8_list(message, (const uint8_t **)&list, &sz_list);
+    case xchg_type_int16:
+        return xchg_message_read_int16_list(message, (const int16_t **)&list, &sz_list);
+    case xchg_type_uint16:
+        return xchg_message_read_uint16_list(message, (const uint16_t **)&list, &sz_list);
+    case xchg_type_int32:
+        return xchg_message_read_int32_list(message, (const int32_t **)&list, &sz_list);
+    case xchg_type_uint32:
+        return xchg_message_read_uint32_list(message, (const uint32_t **)&list, &sz_list);
+    case xchg_type_int64:
+        return xchg_message_read_int64_list(message, (const int64_t **)&list, &sz_list);
+    case xchg_type_uint64:
+        return xchg_message_read_uint64_list(message, (const uint64_t **)&list, &sz_list);
+    case xchg_type_float32:
+        return xchg_message_read_float32_list(message, (const float_t **)&list, &sz_list);
+    case xchg_type_float64:
+        return xchg_message_read_float64_list(message, (const double_t **)&list, &sz_list);
+    default:
+        return false;
+    }
+}
+
+static void decode_pending(struct xchg_statistics *statistics, const char *ring, size_t nr_messages)
+{
+    char *buffer = malloc(statistics->sz_message);
+    if(buffer == NULL)
+    {
+        return;
+    }
+
+    for(uint64_t sequence = statistics->read_sequence;
+        sequence < statistics->write_sequence && sequence - statistics->read_sequence < nr_messages;
+        sequence++)
+    {
+        size_t length = 0;
+
+        if(!xchg_statistics_peek(statistics, ring, sequence, buffer, statistics->sz_message, &length))
+        {
+            printf("#%" PRIu64 ": %s\n", sequence, xchg_statistics_strerror(statistics));
+            break;
+        }
+
+        printf("#%" PRIu64 ":", sequence);
+
+        // an empty message has nothing to decode, and cannot back an xchg_message at all
+
+        struct xchg_message message = { 0 };
+
+        if(length == 0 || !xchg_message_init(&message, buffer, length))
+        {
+            printf("\n");
+            continue;
+        }
+
+        enum xchg_type type = xchg_type_invalid;
+        bool null = false;
+        bool list = false;
+        uint64_t sz_list = 0;
+
+        // slots without a stored length are decoded until the first byte which is not a valid value, since the
+        // rest of the slot may be left over from earlier messages
+
+        while(xchg_message_peek(&message, &type, &null, &list, &sz_list))
+        {
+            if(list)
+            {
+                printf(" %s[%" PRIu64 "]%s", type_names[type], sz_list, null ? "=null" : "");
+                skip_list(&message, type, null);
+            }
+            else if(null)
+            {
+                printf(" %s=null", type_names[type]);
+                xchg_message_read_null(&message, &type);
+            }
+            else
+            {
+                printf(" %s=", type_names[type]);
+                print_value(&message, type);
+            }
+        }
+
+        printf("\n");
+    }
+
+    free(buffer);
+}
+
+static void print_header(const struct xchg_statistics *statistics)
+{
+    printf("ring: %zu bytes in %zu slots of %zu bytes, flags 0x%" PRIx32 "\n",
+           statistics->sz_data, statistics->sz_data / statistics->sz_message, statistics->sz_message,
+           statistics->flags);
+    printf("producer: pid %" PRIu64 " (%s)\n", statistics->producer_pid, process_state(statistics->producer_pid));
+    printf("consumer: pid %" PRIu64 " (%s)\n", statistics->consumer_pid, process_state(statistics->consumer_pid));
+}
+
+int main(int argc, char **argv)
+{
+    long interval_ms = 1000;
+    long count = 0;
+    size_t nr_messages = 0;
+    off_t offset = 0;
+    size_t sz_ring = 0;
+
+    int opt;
+    while((opt = getopt(argc, argv, "i:c:n:o:s:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'i':
+            interval_ms = strtol(optarg, NULL, 0);
+            break;
+        case 'c':
+            count = strtol(optarg, NULL, 0);
+            break;
+        case 'n':
+            nr_messages = (size_t)strtoull(optarg, NULL, 0);
+            break;
+        case 'o':
+            offset = (off_t)strtoll(optarg, NULL, 0);
+            break;
+        case 's':
+            sz_ring = (size_t)strtoull(optarg, NULL, 0);
+            break;
+        default:
+            fputs(usage, stderr);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if(optind + 1 != argc || interval_ms <= 0 || count < 0 || offset < 0)
+    {
+        fputs(usage, stderr);
+        return 2;
+    }
+
+    int fd = open_ring(argv[optind]);
+    struct stat st;
+
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "xchg-stat: %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+
+    if(sz_ring == 0)
+    {
+        sz_ring = st.st_size > offset ? (size_t)(st.st_size - offset) : 0;
+    }
+
+    // mappings must start on a page boundary, so the ring is reached through whatever part of a page precedes it
+
+    size_t sz_page = (size_t)sysconf(_SC_PAGESIZE);
+    off_t map_offset = offset & ~(off_t)(sz_page - 1);
+    size_t slack = (size_t)(offset - map_offset);
+
+    char *mapping = sz_ring != 0 ? mmap(NULL, sz_ring + slack, PROT_READ, MAP_SHARED, fd, map_offset) : MAP_FAILED;
+    close(fd);
+
+    if(mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "xchg-stat: %s: %s\n", argv[optind], sz_ring == 0 ? "ring is empty" : strerror(errno));
+        return 1;
+    }
+
+    const char *ring = mapping + slack;
+    struct xchg_statistics previous = {};
+    struct xchg_statistics current = {};
+
+    if(!xchg_statistics_read(&previous, ring, sz_ring))
+    {
+        fprintf(stderr, "xchg-stat: %s: %s\n", argv[optind], xchg_statistics_strerror(&previous));
+        return 1;
+    }
+
+    print_header(&previous);
+
+    if(nr_messages != 0)
+    {
+        decode_pending(&previous, ring, nr_messages);
+    }
+
+    bool statistics = (previous.flags & xchg_channel_flag_statistics) != 0;
+
+    printf("%10s %10s %10s %12s %12s %10s %10s %10s %10s\n",
+           "pending", "occupancy", "high", "sent/s", "received/s", "full/s", "empty/s", "producer", "consumer");
+
+    uint64_t previous_ns = monotonic_ns();
+    struct timespec interval = { .tv_sec = interval_ms / 1000, .tv_nsec = (interval_ms % 1000) * 1000000 };
+
+    for(long i = 0; count == 0 || i < count; i++)
+    {
+        nanosleep(&interval, NULL);
+
+        if(!xchg_statistics_read(&current, ring, sz_ring))
+        {
+            fprintf(stderr, "xchg-stat: %s: %s\n", argv[optind], xchg_statistics_strerror(&current));
+            return 1;
+        }
+
+        uint64_t now = monotonic_ns();
+        double elapsed = (double)(now - previous_ns) / 1e9;
+        size_t nr_slots = current.sz_data / current.sz_message;
+
+        // heartbeat ages show how long each end has been silent, which is the lag of an end that has stalled
+
+        char producer_age[32] = "-";
+        char consumer_age[32] = "-";
+
+        if(current.producer_heartbeat != 0)
+        {
+            snprintf(producer_age, sizeof(producer_age), "%.3fs", (double)(now - current.producer_heartbeat) / 1e9);
+        }
+
+        if(current.consumer_heartbeat != 0)
+        {
+            snprintf(consumer_age, sizeof(consumer_age), "%.3fs", (double)(now - current.consumer_heartbeat) / 1e9);
+        }
+
+        char high[32] = "-";
+        char full[32] = "-";
+        char empty[32] = "-";
+
+        if(statistics)
+        {
+            snprintf(high, sizeof(high), "%" PRIu64, current.nr_high_water);
+            snprintf(full, sizeof(full), "%.0f", (double)(current.nr_full - previous.nr_full) / elapsed);
+            snprintf(empty, sizeof(empty), "%.0f", (double)(current.nr_empty - previous.nr_empty) / elapsed);
+        }
+
+        printf("%10" PRIu64 " %9.1f%% %10s %12.0f %12.0f %10s %10s %10s %10s\n",
+               current.nr_pending, 100.0 * (double)current.nr_pending / (double)nr_slots, high,
+               (double)(current.write_sequence - previous.write_sequence) / elapsed,
+               (double)(current.read_sequence - previous.read_sequence) / elapsed,
+               full, empty, producer_age, consumer_age);
+        fflush(stdout);
+
+        previous = current;
+        previous_ns = now;
+    }
+
+    munmap(mapping, sz_ring + slack);
+    return 0;
+}